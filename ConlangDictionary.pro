@@ -6,37 +6,62 @@ TEMPLATE = app
 TARGET = 
 DEPENDPATH += .
 INCLUDEPATH += .
-QT += xml
 QT += sql
 
 # Input
-HEADERS += cdicdatabase.h \
+HEADERS += benchmark.h \
+           cdicdatabase.h \
            choosephonemesdialog.h \
            const.h \
+           dialogerrorsink.h \
            dictionary.h \
            earleyparser.h \
            editablequerymodel.h \
            editphonologydialog.h \
+           errorsink.h \
            featurebundlesdialog.h \
            mainwindow.h \
            managefeaturesdialog.h \
            morphemeupdatedialog.h \
+           phonologyanalyzer.h \
+           phonologyiterator.h \
            phonologypage.h \
            phonotacticspage.h \
+           queryprofiler.h \
+           reanalyzer.h \
+           settingscache.h \
            suprasegmentalspage.h \
-           wordpage.h
-SOURCES += cdicdatabase.cc \
+           textimport.h \
+           textmatcher.h \
+           wordlistmodel.h \
+           wordpage.h \
+           wordsearcher.h \
+           xmlimporter.h
+SOURCES += benchmark.cc \
+           cdicdatabase.cc \
            choosephonemesdialog.cc \
+           dialogerrorsink.cc \
            dictionary.cc \
            earleyparser.cc \
            editablequerymodel.cc \
            editphonologydialog.cc \
+           errorsink.cc \
            featurebundlesdialog.cc \
            main.cc \
            mainwindow.cc \
            managefeaturesdialog.cc \
            morphemeupdatedialog.cc \
+           phonologyanalyzer.cc \
+           phonologyiterator.cc \
            phonologypage.cc \
            phonotacticspage.cc \
+           queryprofiler.cc \
+           reanalyzer.cc \
+           settingscache.cc \
            suprasegmentalspage.cc \
-           wordpage.cc
+           textimport.cc \
+           textmatcher.cc \
+           wordlistmodel.cc \
+           wordpage.cc \
+           wordsearcher.cc \
+           xmlimporter.cc
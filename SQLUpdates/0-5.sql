@@ -0,0 +1,300 @@
+-- Statements to update the database from version 0.4 to version 0.5.
+
+-- Cached parsing grammar
+create table GrammarRule
+  (id integer primary key not null,
+   lhs text not null,
+   rhs text not null,
+   context text not null default "");
+
+-- Word substring index
+create table WordGram
+  (wordID int not null,
+   pos int not null,
+   gram text not null,
+   primary key (wordID, pos),
+   foreign key (wordID) references Word(id) on delete cascade);
+
+create index WordGramIndex on WordGram(gram);
+
+-- Cached word representations
+create table WordRepresentation
+  (wordID integer primary key not null,
+   representation text not null,
+   foreign key (wordID) references Word(id) on delete cascade);
+
+create trigger RepresentationPhonemeUpdate
+  after update of name on Phoneme for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from Onset where phonemeID == new.id
+                       union select wordID from Peak where phonemeID == new.id
+                       union select wordID from Coda where phonemeID == new.id);
+  end;
+
+create trigger RepresentationPhonemeDelete
+  before delete on Phoneme for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from Onset where phonemeID == old.id
+                       union select wordID from Peak where phonemeID == old.id
+                       union select wordID from Coda where phonemeID == old.id);
+  end;
+
+create trigger RepresentationSupraUpdate
+  after update of repType, repText on Suprasegmental for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from SyllableSupra where supraID == new.id
+                       union select wordID from OnsetSupra where supraID == new.id
+                       union select wordID from PeakSupra where supraID == new.id
+                       union select wordID from CodaSupra where supraID == new.id);
+  end;
+
+create trigger RepresentationSupraDelete
+  before delete on Suprasegmental for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from SyllableSupra where supraID == old.id
+                       union select wordID from OnsetSupra where supraID == old.id
+                       union select wordID from PeakSupra where supraID == old.id
+                       union select wordID from CodaSupra where supraID == old.id);
+  end;
+
+-- Materialized class membership
+drop view PhonClassList;
+
+drop view WordClassList;
+
+-- Which phonemes are of which classes, kept up to date by the triggers below
+create table ClassMemberPhon
+  (phonemeID int not null,
+   bundleID int not null,
+   primary key (phonemeID, bundleID) on conflict ignore,
+   foreign key (phonemeID) references Phoneme(id) on delete cascade,
+   foreign key (bundleID) references NaturalClassPhon(bundleID) on delete cascade);
+
+create index ClassMemberPhonIndex on ClassMemberPhon(bundleID);
+
+-- A new phoneme has no features, so it is only in classes that ask for none
+create trigger ClassMemberPhonAdd
+  after insert on Phoneme for each row
+  begin
+    insert into ClassMemberPhon
+      select new.id, bundleID from NaturalClassPhon
+      where not exists (select * from FeatureBundlePhon where id == bundleID);
+  end;
+
+create trigger ClassMemberPhonClassAdd
+  after insert on NaturalClassPhon for each row
+  begin
+    insert into ClassMemberPhon select id, new.bundleID from Phoneme;
+  end;
+
+-- Gaining a feature can only add the classes that ask for it...
+create trigger ClassMemberPhonFeatureInsert
+  after insert on PhonemeFeatureSet for each row
+  begin
+    insert into ClassMemberPhon
+      select new.phonemeID, b.id from FeatureBundlePhon as b
+      where b.feature == new.feature and b.value == new.value and
+        not exists (select feature, value from FeatureBundlePhon where id == b.id
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == new.phonemeID);
+  end;
+
+-- ...and losing one can only remove them
+create trigger ClassMemberPhonFeatureDelete
+  after delete on PhonemeFeatureSet for each row
+  begin
+    delete from ClassMemberPhon
+      where phonemeID == old.phonemeID and
+        bundleID in (select id from FeatureBundlePhon where feature == old.feature and value == old.value);
+  end;
+
+create trigger ClassMemberPhonFeatureUpdate
+  after update on PhonemeFeatureSet for each row
+  begin
+    delete from ClassMemberPhon where phonemeID in (old.phonemeID, new.phonemeID);
+    insert into ClassMemberPhon
+      select Phoneme.id, bundleID from Phoneme, NaturalClassPhon
+      where Phoneme.id in (old.phonemeID, new.phonemeID) and
+        not exists (select feature, value from FeatureBundlePhon where id == bundleID
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+  end;
+
+-- Likewise, a class asking for another feature can only lose members...
+create trigger ClassMemberPhonBundleInsert
+  after insert on FeatureBundlePhon for each row
+  begin
+    delete from ClassMemberPhon
+      where bundleID == new.id and
+        not exists (select * from PhonemeFeatureSet
+                    where phonemeID == ClassMemberPhon.phonemeID and feature == new.feature and value == new.value);
+  end;
+
+-- ...and asking for one fewer can only gain them
+create trigger ClassMemberPhonBundleDelete
+  after delete on FeatureBundlePhon for each row
+  begin
+    insert into ClassMemberPhon
+      select Phoneme.id, old.id from Phoneme
+      where exists (select * from NaturalClassPhon where bundleID == old.id) and
+        not exists (select feature, value from FeatureBundlePhon where id == old.id
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+  end;
+
+create trigger ClassMemberPhonBundleUpdate
+  after update on FeatureBundlePhon for each row
+  begin
+    delete from ClassMemberPhon where bundleID in (old.id, new.id);
+    insert into ClassMemberPhon
+      select Phoneme.id, bundleID from Phoneme, NaturalClassPhon
+      where bundleID in (old.id, new.id) and
+        not exists (select feature, value from FeatureBundlePhon where id == bundleID
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+  end;
+
+insert into ClassMemberPhon
+  select Phoneme.id, bundleID from Phoneme, NaturalClassPhon
+  where not exists (select feature, value from FeatureBundlePhon where id == bundleID
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+
+create view PhonClassList as
+  select phonemeID as id, name as class
+  from ClassMemberPhon, NaturalClassPhon
+  where ClassMemberPhon.bundleID == NaturalClassPhon.bundleID;
+
+-- Which words are of which classes, kept up to date by the triggers below
+create table ClassMemberWord
+  (wordID int not null,
+   bundleID int not null,
+   primary key (wordID, bundleID) on conflict ignore,
+   foreign key (wordID) references Word(id) on delete cascade,
+   foreign key (bundleID) references NaturalClassWord(bundleID) on delete cascade);
+
+create index ClassMemberWordIndex on ClassMemberWord(bundleID);
+
+-- A new word has no features, so it is only in classes that ask for none
+create trigger ClassMemberWordAdd
+  after insert on Word for each row
+  begin
+    insert into ClassMemberWord
+      select new.id, bundleID from NaturalClassWord
+      where not exists (select * from FeatureBundleWord where id == bundleID);
+  end;
+
+create trigger ClassMemberWordClassAdd
+  after insert on NaturalClassWord for each row
+  begin
+    insert into ClassMemberWord select id, new.bundleID from Word;
+  end;
+
+-- Gaining a feature can only add the classes that ask for it...
+create trigger ClassMemberWordFeatureInsert
+  after insert on WordFeatureSet for each row
+  begin
+    insert into ClassMemberWord
+      select new.wordID, b.id from FeatureBundleWord as b
+      where b.feature == new.feature and b.value == new.value and
+        not exists (select feature, value from FeatureBundleWord where id == b.id
+                    except
+                    select feature, value from WordFeatureSet where wordID == new.wordID);
+  end;
+
+-- ...and losing one can only remove them
+create trigger ClassMemberWordFeatureDelete
+  after delete on WordFeatureSet for each row
+  begin
+    delete from ClassMemberWord
+      where wordID == old.wordID and
+        bundleID in (select id from FeatureBundleWord where feature == old.feature and value == old.value);
+  end;
+
+create trigger ClassMemberWordFeatureUpdate
+  after update on WordFeatureSet for each row
+  begin
+    delete from ClassMemberWord where wordID in (old.wordID, new.wordID);
+    insert into ClassMemberWord
+      select Word.id, bundleID from Word, NaturalClassWord
+      where Word.id in (old.wordID, new.wordID) and
+        not exists (select feature, value from FeatureBundleWord where id == bundleID
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+  end;
+
+-- Likewise, a class asking for another feature can only lose members...
+create trigger ClassMemberWordBundleInsert
+  after insert on FeatureBundleWord for each row
+  begin
+    delete from ClassMemberWord
+      where bundleID == new.id and
+        not exists (select * from WordFeatureSet
+                    where wordID == ClassMemberWord.wordID and feature == new.feature and value == new.value);
+  end;
+
+-- ...and asking for one fewer can only gain them
+create trigger ClassMemberWordBundleDelete
+  after delete on FeatureBundleWord for each row
+  begin
+    insert into ClassMemberWord
+      select Word.id, old.id from Word
+      where exists (select * from NaturalClassWord where bundleID == old.id) and
+        not exists (select feature, value from FeatureBundleWord where id == old.id
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+  end;
+
+create trigger ClassMemberWordBundleUpdate
+  after update on FeatureBundleWord for each row
+  begin
+    delete from ClassMemberWord where bundleID in (old.id, new.id);
+    insert into ClassMemberWord
+      select Word.id, bundleID from Word, NaturalClassWord
+      where bundleID in (old.id, new.id) and
+        not exists (select feature, value from FeatureBundleWord where id == bundleID
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+  end;
+
+insert into ClassMemberWord
+  select Word.id, bundleID from Word, NaturalClassWord
+  where not exists (select feature, value from FeatureBundleWord where id == bundleID
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+
+create view WordClassList as
+  select wordID as id, name as class
+  from ClassMemberWord, NaturalClassWord
+  where ClassMemberWord.bundleID == NaturalClassWord.bundleID;
+
+-- Name and full text search indexes
+create index WordNameIndex on Word(name);
+
+create virtual table WordText using fts4(definition);
+
+create trigger WordTextInsert
+  after insert on Word for each row
+  begin
+    insert into WordText (docid, definition) values (new.id, new.definition);
+  end;
+
+create trigger WordTextUpdate
+  after update of definition on Word for each row
+  begin
+    update WordText set definition = new.definition where docid == new.id;
+  end;
+
+create trigger WordTextDelete
+  after delete on Word for each row
+  begin
+    delete from WordText where docid == old.id;
+  end;
+
+insert into WordText (docid, definition) select id, definition from Word;
+
+update Settings set value = "0.5" where name == "VersionNumber";
\ No newline at end of file
@@ -0,0 +1,729 @@
+#include <QTextStream>
+#include <QTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QXmlStreamWriter>
+
+#include "const.h"
+
+#include "benchmark.h"
+#include "cdicdatabase.h"
+#include "phonologyiterator.h"
+#include "phonologyanalyzer.h"
+#include "earleyparser.h"
+#include "wordlistmodel.h"
+
+// Words set one at a time, each in its own transaction as on the word page
+#define SET_PHONOLOGY_WORDS 500
+
+Benchmark::Benchmark (QTextStream *o)  {
+  out = o;
+  runs = 10;
+  tsv = false;
+}
+
+// Arguments are dictionaries and ConlangML files, and "--tsv" for results
+// as tab-separated rows
+void Benchmark::run (QStringList args)  {
+  QStringList files;
+
+  for (int x = 0; x < args.size (); x++)  {
+    if (args[x] == "--tsv")
+      tsv = true;
+    else files.append (args[x]);
+  }
+
+  if (files.isEmpty ())
+    files << "test.cdic" << "adeyan.cdic";
+
+  if (tsv)
+    *out << "benchmark\tsubject\tmetric\tvalue\tunit" << endl;
+
+  for (int x = 0; x < files.size (); x++)  {
+    // ConlangML files are imported; anything else is taken as a dictionary
+    if (files[x].endsWith (".xml", Qt::CaseInsensitive))  {
+      xmlImport (files[x]);
+      continue;
+    }
+
+    grammarBuild (files[x]);
+    representationBuild (files[x]);
+    phonologyScan (files[x]);
+    earleyParse (files[x]);
+    wordParse (files[x]);
+    textExport (files[x]);
+  }
+
+  syntheticGrammarBuild (200, 30);
+  syntheticXMLImport (100000);
+  syntheticTextImport (50000);
+}
+
+void Benchmark::grammarBuild (QString filename)  {
+  QString copy = scratchCopy (filename);
+
+  if (copy == "")  {
+    failure ("grammar", filename, "cannot read file");
+    return;
+  }
+
+  CDICDatabase db;
+
+  if (db.open (copy))
+    timeGrammar (db, QFileInfo (filename).fileName ());
+
+  db.close ();
+  QFile::remove (copy);
+}
+
+// Best and mean time to rebuild every cached word representation
+void Benchmark::representationBuild (QString filename)  {
+  QString copy = scratchCopy (filename);
+  QString label = QFileInfo (filename).fileName ();
+
+  if (copy == "")  {
+    failure ("representations", filename, "cannot read file");
+    return;
+  }
+
+  CDICDatabase db;
+
+  if (db.open (copy))  {
+    int best = -1;
+    int total = 0;
+
+    for (int x = 0; x < runs; x++)  {
+      QTime timer;
+      timer.start ();
+
+      db.transaction ();
+      db.rebuildRepresentations ();
+      db.commit ();
+
+      int elapsed = timer.elapsed ();
+      total += elapsed;
+
+      if (best < 0 || elapsed < best)
+        best = elapsed;
+    }
+
+    record ("representations", label, "words", db.getNumberOfWords ());
+    record ("representations", label, "best", best, "ms");
+    record ("representations", label, "mean", (double)total / runs, "ms");
+  }
+
+  db.close ();
+  QFile::remove (copy);
+}
+
+// One pass over every word's phonology, against loading each word on its own
+void Benchmark::phonologyScan (QString filename)  {
+  QString copy = scratchCopy (filename);
+  CDICDatabase db;
+
+  if (copy == "" || !db.open (copy))  {
+    failure ("phonologies", filename, "cannot read file");
+    QFile::remove (copy);
+    return;
+  }
+
+  QTime timer;
+  timer.start ();
+
+  int syllables = 0;
+  PhonologyIterator *phonologies = db.getPhonologies ();
+
+  while (phonologies->next ())
+    syllables += phonologies->phonology ().size ();
+
+  delete phonologies;
+
+  int bulk = timer.elapsed ();
+
+  timer.start ();
+
+  QList<int> ids = db.getAllWordIDs ();
+  for (int x = 0; x < ids.size (); x++)
+    db.getPhonology (ids[x]);
+
+  int single = timer.elapsed ();
+
+  QString label = QFileInfo (filename).fileName ();
+  record ("phonologies", label, "syllables", syllables);
+  record ("phonologies", label, "one pass", bulk, "ms");
+  record ("phonologies", label, "word by word", single, "ms");
+
+  db.close ();
+  QFile::remove (copy);
+}
+
+// Time and peak memory of importing into a new, empty dictionary
+void Benchmark::xmlImport (QString filename, QString label)  {
+  if (label == "")
+    label = QFileInfo (filename).fileName ();
+
+  QString dictionary = QDir::temp ().filePath ("cdic-benchmark-import.cdic");
+  QFile::remove (dictionary);
+
+  CDICDatabase db;
+
+  if (!db.open (dictionary))  {
+    failure ("xml import", label, "cannot create dictionary");
+    return;
+  }
+
+  resetPeakMemory ();
+  long before = peakMemory ();
+
+  QTime timer;
+  timer.start ();
+
+  bool loaded = db.loadFromXML (filename);
+
+  int elapsed = timer.elapsed ();
+  long peak = peakMemory ();
+
+  if (loaded)  {
+    record ("xml import", label, "words", db.getNumberOfWords ());
+    record ("xml import", label, "file size", QFileInfo (filename).size () / 1024, "kB");
+    record ("xml import", label, "time", elapsed, "ms");
+    record ("xml import", label, "peak memory before", before, "kB");
+    record ("xml import", label, "peak memory", peak, "kB");
+  }
+  else failure ("xml import", label, "failed");
+
+  db.close ();
+  QFile::remove (dictionary);
+}
+
+void Benchmark::syntheticXMLImport (int words)  {
+  QString filename = QDir::temp ().filePath ("cdic-benchmark.xml");
+
+  if (createSyntheticXML (filename, words))
+    xmlImport (filename, QString ("synthetic %1 words").arg (words));
+
+  QFile::remove (filename);
+}
+
+// Lines of "word,class,definition" into a new, empty dictionary
+void Benchmark::syntheticTextImport (int lines)  {
+  QString filename = QDir::temp ().filePath ("cdic-benchmark.csv");
+  QString dictionary = QDir::temp ().filePath ("cdic-benchmark-import.cdic");
+  QFile::remove (dictionary);
+
+  QFile file (filename);
+
+  QString label = QString ("synthetic %1 lines").arg (lines);
+
+  if (!file.open (QIODevice::WriteOnly | QIODevice::Text))  {
+    failure ("text import", label, "cannot write " + filename);
+    return;
+  }
+
+  QTextStream text (&file);
+  for (int x = 0; x < lines; x++)
+    text << "word" << x << "," << (x % 2 ? "noun" : "verb") << ",definition "
+         << x << endl;
+
+  file.close ();
+
+  CDICDatabase db;
+
+  if (db.open (dictionary))  {
+    QTime timer;
+    timer.start ();
+
+    db.loadFromText (filename, "/w,/c,/d");
+
+    record ("text import", label, "time", timer.elapsed (), "ms");
+    record ("text import", label, "words", db.getNumberOfWords ());
+
+    timeSearches (db, QString ("synthetic %1 words").arg (lines));
+    timeExport (db, QString ("synthetic %1 words").arg (lines));
+  }
+
+  db.close ();
+  QFile::remove (dictionary);
+  QFile::remove (filename);
+}
+
+// Best and mean time for the parser alone to chart every word, already
+// tokenized, and the mean for the longest tenth of the words, where the
+// chart columns are biggest
+void Benchmark::earleyParse (QString filename)  {
+  QString copy = scratchCopy (filename);
+  QString label = QFileInfo (filename).fileName ();
+  CDICDatabase db;
+
+  if (copy == "" || !db.open (copy))  {
+    failure ("earley parse", filename, "cannot read file");
+    QFile::remove (copy);
+    return;
+  }
+
+  EarleyParser parser;
+  parser.setRules (db.getParsingGrammar ());
+  parser.setIgnored (db.getValue (IGNORED_CHARACTERS));
+
+  // tokenized words by their length
+  QMultiMap<int, QVector<int> > byLength;
+  QMap<int, QString> words = db.getWordNames ();
+
+  for (QMap<int, QString>::iterator w = words.begin (); w != words.end (); w++)  {
+    QVector<int> tokens = parser.tokenize (w.value ());
+    byLength.insert (tokens.size (), tokens);
+  }
+
+  db.close ();
+  QFile::remove (copy);
+
+  if (byLength.isEmpty ())  {
+    failure ("earley parse", filename, "no words");
+    return;
+  }
+
+  QList< QVector<int> > inputs = byLength.values ();
+  int firstLong = inputs.size () - qMax (inputs.size () / 10, 1);
+
+  int best = -1;
+  int total = 0;
+  int longTotal = 0;
+
+  for (int x = 0; x < runs; x++)  {
+    QTime timer;
+    timer.start ();
+
+    for (int y = 0; y < firstLong; y++)
+      parser.parse (inputs[y]);
+
+    int shortElapsed = timer.elapsed ();
+
+    for (int y = firstLong; y < inputs.size (); y++)
+      parser.parse (inputs[y]);
+
+    int elapsed = timer.elapsed ();
+    total += elapsed;
+    longTotal += elapsed - shortElapsed;
+
+    if (best < 0 || elapsed < best)
+      best = elapsed;
+  }
+
+  record ("earley parse", label, "words", inputs.size ());
+  record ("earley parse", label, "longest word", byLength.lastKey (), "symbols");
+  record ("earley parse", label, "best", best, "ms");
+  record ("earley parse", label, "mean", (double)total / runs, "ms");
+  record ("earley parse", label, "per word", 1000.0 * total / runs / inputs.size (), "us");
+  record ("earley parse", label, "per long word",
+          1000.0 * longTotal / runs / (inputs.size () - firstLong), "us");
+}
+
+// Parsing every word, then saving and showing the phonology of some of them
+// one at a time, as the word page does
+void Benchmark::wordParse (QString filename)  {
+  QString copy = scratchCopy (filename);
+  QString label = QFileInfo (filename).fileName ();
+  CDICDatabase db;
+
+  if (copy == "" || !db.open (copy))  {
+    failure ("parse", filename, "cannot read file");
+    QFile::remove (copy);
+    return;
+  }
+
+  PhonologyAnalyzer analyzer;
+  QTime timer;
+  timer.start ();
+
+  analyzer.load (db);
+
+  record ("parse", label, "analyzer load", timer.elapsed (), "ms");
+
+  QMap<int, QString> words = db.getWordNames ();
+  QList< QPair<int, QList<Syllable> > > phonologies;
+
+  timer.start ();
+
+  for (QMap<int, QString>::iterator w = words.begin (); w != words.end (); w++)
+    phonologies.append (qMakePair (w.key (), analyzer.analyze (w.value ())));
+
+  int elapsed = timer.elapsed ();
+
+  record ("parse", label, "words", words.size ());
+  record ("parse", label, "time", elapsed, "ms");
+  if (!words.isEmpty ())
+    record ("parse", label, "per word", 1000.0 * elapsed / words.size (), "us");
+
+  int count = qMin (phonologies.size (), SET_PHONOLOGY_WORDS);
+
+  timer.start ();
+
+  for (int x = 0; x < count; x++)
+    db.setPhonology (phonologies[x].first, phonologies[x].second);
+
+  elapsed = timer.elapsed ();
+
+  if (count > 0)
+    record ("setPhonology", label, "per word", (double)elapsed / count, "ms");
+
+  timer.start ();
+
+  for (int x = 0; x < count; x++)
+    db.getRepresentation (phonologies[x].first);
+
+  elapsed = timer.elapsed ();
+
+  if (count > 0)
+    record ("getRepresentation", label, "per word", 1000.0 * elapsed / count, "us");
+
+  db.close ();
+  QFile::remove (copy);
+}
+
+void Benchmark::textExport (QString filename)  {
+  QString copy = scratchCopy (filename);
+  CDICDatabase db;
+
+  if (copy == "" || !db.open (copy))  {
+    failure ("text export", filename, "cannot read file");
+    QFile::remove (copy);
+    return;
+  }
+
+  timeExport (db, QFileInfo (filename).fileName ());
+
+  db.close ();
+  QFile::remove (copy);
+}
+
+// Saving every word with its class and phonology
+void Benchmark::timeExport (CDICDatabase &db, QString label)  {
+  QString filename = QDir::temp ().filePath ("cdic-benchmark-export.txt");
+
+  QTime timer;
+  timer.start ();
+
+  bool saved = db.saveToText (filename, "/w,/c,/p,/d");
+
+  if (saved)
+    record ("text export", label, "time", timer.elapsed (), "ms");
+  else failure ("text export", label, "failed");
+
+  QFile::remove (filename);
+}
+
+void Benchmark::syntheticGrammarBuild (int phonemes, int supras)  {
+  QString filename = QDir::temp ().filePath ("cdic-benchmark.cdic");
+  QFile::remove (filename);
+
+  CDICDatabase db;
+
+  if (createSyntheticDictionary (db, filename, phonemes, supras))
+    timeGrammar (db, QString ("synthetic %1 phonemes, %2 supras")
+                       .arg (phonemes).arg (supras));
+
+  db.close ();
+  QFile::remove (filename);
+}
+
+// Time for the word page to run each kind of search and show its first rows,
+// and to page through the whole list
+void Benchmark::timeSearches (CDICDatabase &db, QString label)  {
+  QStringList names;
+  QStringList searches;
+  QStringList languages;
+  QList<int> modes;
+
+  names << "all words" << "name contains" << "name starts with"
+        << "definition contains" << "definition starts with" << "class";
+  searches << "" << "rd12" << "word12" << "tion 12" << "defin 12" << "";
+  languages << "" << "" << "" << "English" << "English" << "";
+  modes << SEARCH_SUBSTRING << SEARCH_SUBSTRING << SEARCH_PREFIX << SEARCH_SUBSTRING
+        << SEARCH_PREFIX << SEARCH_SUBSTRING;
+
+  WordListModel *model = db.getWordListModel ();
+  if (!model) return;
+
+  for (int x = 0; x < names.size (); x++)  {
+    QTime timer;
+    timer.start ();
+
+    db.searchWordList (model, searches[x], (names[x] == "class" ? "noun" : ""),
+                       languages[x], modes[x]);
+
+    record ("search", label, names[x], timer.elapsed (), "ms");
+  }
+
+  db.searchWordList (model, "", "", "");
+
+  QTime timer;
+  timer.start ();
+
+  while (model->canFetchMore ())
+    model->fetchMore ();
+
+  record ("search", label, "paging through all words", timer.elapsed (), "ms");
+
+  delete model;
+}
+
+// Reports the best and mean time of a full, uncached grammar build
+void Benchmark::timeGrammar (CDICDatabase &db, QString label)  {
+  int best = -1;
+  int total = 0;
+  int rules = 0;
+
+  for (int x = 0; x < runs; x++)  {
+    QTime timer;
+    timer.start ();
+
+    rules = db.buildParsingGrammar ().size ();
+
+    int elapsed = timer.elapsed ();
+    total += elapsed;
+
+    if (best < 0 || elapsed < best)
+      best = elapsed;
+  }
+
+  record ("grammar", label, "rules", rules);
+  record ("grammar", label, "best", best, "ms");
+  record ("grammar", label, "mean", (double)total / runs, "ms");
+
+  // the grammar as the analyzer gets it, from the cache
+  db.cacheParsingGrammar ();
+
+  QTime timer;
+  timer.start ();
+
+  for (int x = 0; x < runs; x++)
+    db.getParsingGrammar ();
+
+  record ("grammar", label, "cached mean", (double)timer.elapsed () / runs, "ms");
+}
+
+// One measurement, as "benchmark subject: metric value unit", or with --tsv
+// as a row of a table that runs on different commits can be compared with
+void Benchmark::record (QString benchmark, QString subject, QString metric,
+                        double value, QString unit)  {
+  if (tsv)
+    *out << benchmark << '\t' << subject << '\t' << metric << '\t' << value
+         << '\t' << unit << endl;
+  else *out << benchmark << " " << subject << ": " << metric << " " << value
+            << (unit == "" ? "" : " ") << unit << endl;
+}
+
+// Comment lines in a table, so they are easy to skip
+void Benchmark::failure (QString benchmark, QString subject, QString message)  {
+  *out << (tsv ? "# " : "") << benchmark << " " << subject << ": " << message << endl;
+}
+
+// Phonemes p0, p1... spelled with one or two letters, all legal everywhere;
+// supras cycle through every domain and spelling type.
+bool Benchmark::createSyntheticDictionary (CDICDatabase &db, QString filename,
+                                           int phonemes, int supras)  {
+  if (!db.open (filename))
+    return false;
+
+  QStringList names;
+
+  for (int x = 0; x < phonemes; x++)  {
+    QString name = QString ("p%1").arg (x);
+    names.append (name);
+    db.addPhoneme (name);
+
+    QString spelling = (QString)QChar ('a' + x % 26);
+    if (x >= 26)
+      spelling += QChar ('a' + (x / 26) % 26);
+
+    db.setSpellings (name, spelling);
+  }
+
+  db.addNaturalClass (PHONEME, "All");
+
+  for (int loc = ONSET; loc <= CODA; loc++)
+    db.addSequence (loc, QList<QStringList> () << QStringList ("All"));
+
+  QSqlQuery query (QSqlDatabase::database ());
+  query.prepare ((QString)"insert into Suprasegmental (name, domain, spellType, spellText) " +
+                 "values (:name, :domain, :type, :text)");
+
+  for (int x = 0; x < supras; x++)  {
+    QString name = QString ("s%1").arg (x);
+
+    query.bindValue (":name", name);
+    query.bindValue (":domain", x % 2 ? SUPRA_DOMAIN_SYLL : SUPRA_DOMAIN_PHON);
+    query.bindValue (":type", x % (TYPE_DOUBLED + 1));
+    query.bindValue (":text", (QString)QChar ('0' + x % 10));
+    query.exec ();
+
+    QStringList applies;
+    for (int p = x % 2; p < names.size (); p += 2)
+      applies.append (names[p]);
+
+    db.setSupraApplies (name, applies);
+  }
+
+  query.finish ();
+
+  return true;
+}
+
+// Twenty phonemes and a stress mark; words of one to four CV or CVC
+// syllables, chosen by a fixed sequence so every run imports the same file
+bool Benchmark::createSyntheticXML (QString filename, int words)  {
+  QFile file (filename);
+
+  if (!file.open (QIODevice::WriteOnly))
+    return false;
+
+  QStringList consonants;
+  consonants << "p" << "t" << "k" << "b" << "d" << "g" << "m" << "n" << "s"
+             << "z" << "l" << "r" << "w" << "j" << "f";
+  QStringList vowels;
+  vowels << "a" << "e" << "i" << "o" << "u";
+
+  QXmlStreamWriter xml (&file);
+  xml.setAutoFormatting (true);
+  xml.writeStartDocument ();
+  xml.writeStartElement ("ConlangML");
+  xml.writeAttribute ("name", "Synthetic");
+
+  QStringList phonemes = vowels + consonants;
+
+  xml.writeStartElement ("inventory");
+  xml.writeTextElement ("alphabet", phonemes.join (" "));
+
+  for (int x = 0; x < phonemes.size (); x++)  {
+    xml.writeStartElement ("phonemeDef");
+    xml.writeAttribute ("name", phonemes[x]);
+    xml.writeTextElement ("orthography", phonemes[x]);
+    xml.writeEndElement ();
+  }
+
+  xml.writeEndElement ();
+
+  xml.writeStartElement ("suprasegmentals");
+  xml.writeStartElement ("supraDef");
+  xml.writeAttribute ("name", "stress");
+  xml.writeAttribute ("domain", QString::number (SUPRA_DOMAIN_SYLL));
+  xml.writeTextElement ("applies", vowels.join (" "));
+  xml.writeStartElement ("spelling");
+  xml.writeAttribute ("type", "0");
+  xml.writeCharacters ("Acute Accent");
+  xml.writeEndElement ();
+  xml.writeStartElement ("representation");
+  xml.writeAttribute ("type", "1");
+  xml.writeCharacters ("'");
+  xml.writeEndElement ();
+  xml.writeEndElement ();
+  xml.writeEndElement ();
+
+  xml.writeStartElement ("wordList");
+
+  unsigned int seed = 1;
+
+  for (int w = 0; w < words; w++)  {
+    QStringList syllables;
+    QList<QStringList> segments;
+
+    seed = seed * 1103515245 + 12345;
+    int syllCount = 1 + (seed >> 16) % 4;
+
+    for (int syll = 0; syll < syllCount; syll++)  {
+      QStringList segment;
+
+      for (int p = 0; p < 3; p++)  {
+        seed = seed * 1103515245 + 12345;
+        int r = (seed >> 16) % 75;
+
+        if (p == 1)
+          segment.append (vowels[r % vowels.size ()]);
+        else if (p == 0 || r % 3 == 0)
+          segment.append (consonants[r % consonants.size ()]);
+        else segment.append ("");
+      }
+
+      syllables.append (segment.join (""));
+      segments.append (segment);
+    }
+
+    xml.writeStartElement ("wordDef");
+    xml.writeAttribute ("name", syllables.join (""));
+    xml.writeAttribute ("type", w % 2 ? "noun" : "verb");
+    xml.writeTextElement ("definition", QString ("word %1").arg (w));
+    xml.writeStartElement ("phonology");
+
+    for (int syll = 0; syll < segments.size (); syll++)  {
+      xml.writeStartElement ("syllable");
+      if (syll == 0)
+        xml.writeAttribute ("bSupra", "stress");
+
+      QStringList parts;
+      parts << "onset" << "peak" << "coda";
+
+      for (int p = 0; p < 3; p++)  {
+        if (segments[syll][p] == "") continue;
+
+        xml.writeStartElement (parts[p]);
+        xml.writeEmptyElement ("phoneme");
+        xml.writeAttribute ("name", segments[syll][p]);
+        xml.writeEndElement ();
+      }
+
+      xml.writeEndElement ();
+    }
+
+    xml.writeEndElement ();
+    xml.writeEndElement ();
+  }
+
+  xml.writeEndDocument ();
+  file.close ();
+
+  return true;
+}
+
+// Peak resident memory in kB, from Linux's /proc; -1 elsewhere
+long Benchmark::peakMemory ()  {
+  QFile status ("/proc/self/status");
+
+  if (!status.open (QIODevice::ReadOnly))
+    return -1;
+
+  QStringList lines = QString (status.readAll ()).split ('\n');
+  status.close ();
+
+  for (int x = 0; x < lines.size (); x++)
+    if (lines[x].startsWith ("VmHWM:"))
+      return lines[x].section (' ', 1, -1, QString::SectionSkipEmpty)
+                     .section (' ', 0, 0).toLong ();
+
+  return -1;
+}
+
+// So that peakMemory measures from here on, not from program start
+void Benchmark::resetPeakMemory ()  {
+  QFile clearRefs ("/proc/self/clear_refs");
+
+  if (clearRefs.open (QIODevice::WriteOnly))  {
+    clearRefs.write ("5");
+    clearRefs.close ();
+  }
+}
+
+// Works on a copy so that schema upgrades never touch the original
+QString Benchmark::scratchCopy (QString filename)  {
+  QString copy = QDir::temp ().filePath ("cdic-benchmark-" +
+                                         QFileInfo (filename).fileName ());
+
+  QFile::remove (copy);
+
+  if (!QFile::copy (filename, copy))
+    return "";
+
+  return copy;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+
+class QTextStream;
+class CDICDatabase;
+
+// Timing harness for the slow paths of the dictionary backend.  Run with
+// "cdic-cli benchmark [--tsv] [dictionary or .xml file...]" or
+// "ConlangDictionary --benchmark ..." from the source directory, since new
+// dictionaries are created from schema.sql.  With --tsv, results are
+// tab-separated rows of benchmark, subject, metric, value and unit.
+class Benchmark  {
+  public:
+    Benchmark (QTextStream*);
+
+    void run (QStringList);
+
+    void grammarBuild (QString);
+    void syntheticGrammarBuild (int, int);
+    void representationBuild (QString);
+    void phonologyScan (QString);
+    void xmlImport (QString, QString = QString ());
+    void syntheticXMLImport (int);
+    void syntheticTextImport (int);
+    void earleyParse (QString);
+    void wordParse (QString);
+    void textExport (QString);
+
+  private:
+    void timeGrammar (CDICDatabase&, QString);
+    void timeSearches (CDICDatabase&, QString);
+    void timeExport (CDICDatabase&, QString);
+    void record (QString, QString, QString, double, QString = QString ());
+    void failure (QString, QString, QString);
+    bool createSyntheticDictionary (CDICDatabase&, QString, int, int);
+    bool createSyntheticXML (QString, int);
+    long peakMemory ();
+    void resetPeakMemory ();
+    QString scratchCopy (QString);
+
+    QTextStream *out;
+    int runs;
+    bool tsv;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+######################################################################
+# cdic-cli, the command line tool for bulk jobs; see commandline.h.
+# Build with "qmake cdic-cli.pro && make -f Makefile.cli".
+######################################################################
+
+TEMPLATE = app
+TARGET = cdic-cli
+DEPENDPATH += .
+INCLUDEPATH += .
+QT -= gui
+QT += sql
+CONFIG += console
+CONFIG -= app_bundle
+MAKEFILE = Makefile.cli
+OBJECTS_DIR = cli
+MOC_DIR = cli
+
+# Input
+HEADERS += benchmark.h \
+           cdicdatabase.h \
+           commandline.h \
+           const.h \
+           earleyparser.h \
+           editablequerymodel.h \
+           errorsink.h \
+           phonologyanalyzer.h \
+           phonologyiterator.h \
+           queryprofiler.h \
+           reanalyzer.h \
+           settingscache.h \
+           textmatcher.h \
+           wordlistmodel.h \
+           xmlimporter.h
+SOURCES += benchmark.cc \
+           cdicdatabase.cc \
+           climain.cc \
+           commandline.cc \
+           earleyparser.cc \
+           editablequerymodel.cc \
+           errorsink.cc \
+           phonologyanalyzer.cc \
+           phonologyiterator.cc \
+           queryprofiler.cc \
+           reanalyzer.cc \
+           settingscache.cc \
+           textmatcher.cc \
+           wordlistmodel.cc \
+           xmlimporter.cc
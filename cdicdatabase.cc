@@ -1,48 +1,71 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlRecord>
 #include <QSqlQueryModel>
 #include <QSqlTableModel>
 
-#include <QDomDocument>
-#include <QDomElement>
 
 #include <QFile>
 #include <QTextStream>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QSet>
+#include <QVector>
 
-#include <QMessageBox>
+#include <QThread>
+#include <QMutexLocker>
 
 #include <iostream>
 using namespace std;
 
 #include "cdicdatabase.h"
-#include "mainwindow.h"
+#include "errorsink.h"
 #include "editablequerymodel.h"
+#include "phonologyiterator.h"
+#include "xmlimporter.h"
+#include "textmatcher.h"
+#include "wordlistmodel.h"
+#include "queryprofiler.h"
 
-#define QUERY_ERROR(v) QMessageBox::warning (NULL, "Database Error", v.executedQuery () + "\n" + v.lastError ().text ());
-#define DATA_ERROR(m) QMessageBox::warning (NULL, "Database Error", m);
+#define QUERY_ERROR(v) reportError (v.executedQuery () + "\n" + v.lastError ().text ());
+#define DATA_ERROR(m) reportError (m);
 
-CDICDatabase::CDICDatabase ()  {
+// Separates the right-hand side symbols of a rule in the grammar cache
+#define RHS_SEPARATOR QChar (0x1f)
+
+ErrorSink *CDICDatabase::errorSink = NULL;
+QHash<QThread*, ErrorSink*> CDICDatabase::threadErrorSinks;
+QMutex CDICDatabase::errorSinkMutex;
 
+CDICDatabase::CDICDatabase ()  {
+  settings = QSharedPointer<SettingsCache> (new SettingsCache);
 }
 
 CDICDatabase::CDICDatabase (QString name)  {
+  settings = QSharedPointer<SettingsCache> (new SettingsCache);
   open (name);
 }
 
-bool CDICDatabase::open (QString name)  {
+// Opens on the default connection unless another is named; background
+// threads need a connection of their own.  The connection uses the given
+// SQLite profile, or else the one saved in the dictionary.
+bool CDICDatabase::open (QString name, QString connection, QString p)  {
   if (db.isOpen ())
     db.close ();
   
-  if (db.connectionName ().isEmpty ())
-    db = QSqlDatabase::addDatabase ("QSQLITE");
+  if (db.connectionName ().isEmpty ())  {
+    if (connection.isEmpty ())
+      db = QSqlDatabase::addDatabase ("QSQLITE");
+    else db = QSqlDatabase::addDatabase ("QSQLITE", connection);
+  }
   
   if (QFile::exists (name))  {
     db.setHostName ("localhost");
     db.setDatabaseName (name);
     
     if (!db.open ())
-      QMessageBox::warning (NULL, "Database Error", db.lastError ().text ());
+      DATA_ERROR(db.lastError ().text ())
   }
   
   else  {
@@ -50,54 +73,79 @@ bool CDICDatabase::open (QString name)  {
     db.setDatabaseName (name);
     
     if (!db.open ())
-      QMessageBox::warning (NULL, "Database Error", db.lastError ().text ());
+      DATA_ERROR(db.lastError ().text ())
     
     else  {
       db.transaction ();
       if (readSQLFile ("schema.sql"))
         db.commit ();
       else   {
-        QMessageBox::warning (NULL, "Database Error", "Could not read schema");
+        DATA_ERROR("Could not read schema")
         db.rollback ();
       }
     }
   }
   
   if (db.isOpen ())  {
-    if (getValue (VERSION_NUMBER) == "0.3")  {
-      db.transaction ();
-      if (readSQLFile ("SQLUpdates/0-4.sql"))
-        db.commit ();
-      else  {
-        QMessageBox::warning (NULL, "Database Error", "Could not read 0.4 schema");
-        db.rollback ();
-      }
-    }
-    
     QSqlQuery query (db);
     
-    if (!query.exec ("pragma foreign_keys = ON"))
+    if (!exec (query, "pragma foreign_keys = ON"))
       QUERY_ERROR(query)
       
-    query.finish ();
+    finish (query);
       
-    if (!query.exec ("pragma recursive_triggers = ON"))
+    if (!exec (query, "pragma recursive_triggers = ON"))
       QUERY_ERROR(query)
     
-    query.finish ();
+    finish (query);
     
-    if (!query.exec ("pragma case_sensitive_like = ON"))
+    if (!exec (query, "pragma case_sensitive_like = ON"))
       QUERY_ERROR(query)
       
-    query.finish ();
+    finish (query);
+    
+    loadSettings ();
+    
+    profile = p;
+    applyProfile (profile.isEmpty () ? savedProfile () : profile, true);
+    
+    // upgrades run after the pragmas above; they change settings behind the
+    // cache
+    if (getValue (VERSION_NUMBER) == "0.3")  {
+      db.transaction ();
+      if (readSQLFile ("SQLUpdates/0-4.sql"))
+        db.commit ();
+      else  {
+        DATA_ERROR("Could not read 0.4 schema")
+        db.rollback ();
+      }
+      
+      loadSettings ();
+    }
+    
+    if (getValue (VERSION_NUMBER) == "0.4")  {
+      db.transaction ();
+      if (readSQLFile ("SQLUpdates/0-5.sql") && reindexWords ())
+        db.commit ();
+      else  {
+        DATA_ERROR("Could not read 0.5 schema")
+        db.rollback ();
+      }
+      
+      loadSettings ();
+    }
   }
   
+  else settings->clear ();
+  
   return db.isOpen ();
 }
 
 void CDICDatabase::close ()  {
   if (db.isOpen ())
     db.close ();
+  
+  settings->clear ();
 }
 
 void CDICDatabase::clear ()  {
@@ -126,12 +174,96 @@ void CDICDatabase::transaction ()  {
   db.transaction ();
 }
 
+// Settings written during the transaction are read back as they were
 void CDICDatabase::rollback ()  {
   db.rollback ();
+  loadSettings ();
 }
 
-void CDICDatabase::commit ()  {
-  db.commit ();
+// A commit that fails, as on a deferred foreign key, is rolled back rather
+// than left open
+bool CDICDatabase::commit ()  {
+  if (db.commit ()) return true;
+  
+  DATA_ERROR("Could not save changes.\n" + db.lastError ().text ())
+  rollback ();
+  
+  return false;
+}
+
+// For writes that may be part of a caller's transaction: starts one if the
+// caller has none, setting own, and otherwise joins the caller's.  False if
+// no transaction could be had at all.
+bool CDICDatabase::joinTransaction (bool &own)  {
+  own = db.transaction ();
+  
+  // SQLite refuses to nest a transaction in one already open
+  if (own || db.lastError ().databaseText ().contains ("within a transaction"))
+    return true;
+  
+  DATA_ERROR("Could not start a transaction.\n" + db.lastError ().text ())
+  return false;
+}
+
+// Ends what joinTransaction started, if it started anything, and returns
+// whether the work was saved
+bool CDICDatabase::leaveTransaction (bool own, bool ok)  {
+  if (!own) return ok;
+  
+  if (ok) return commit ();
+  
+  rollback ();
+  return false;
+}
+
+// Starts a transaction for a bulk job, with the connection switched to the
+// bulk-load profile until endBulkLoad commits or rolls it back
+void CDICDatabase::beginBulkLoad ()  {
+  applyProfile (PROFILE_BULK_LOAD, false);
+  db.transaction ();
+  
+  // foreign keys are checked once, at the commit
+  QSqlQuery query (db);
+  
+  if (!exec (query, "pragma defer_foreign_keys = ON"))
+    QUERY_ERROR(query)
+  
+  finish (query);
+}
+
+// Foreign keys are checked at the commit, so it can fail; false if it did or
+// if the job failed
+bool CDICDatabase::endBulkLoad (bool ok)  {
+  if (ok)
+    ok = commit ();
+  else rollback ();
+  
+  applyProfile (profile.isEmpty () ? savedProfile () : profile, false);
+  
+  return ok;
+}
+
+// Saves the profile in the dictionary and switches to it, unless this
+// connection was opened with a profile of its own.  The journal mode only
+// changes the next time the dictionary is opened, since other connections
+// such as the word searcher's have the file open.
+void CDICDatabase::setProfile (QString p)  {
+  if (p != PROFILE_INTERACTIVE)
+    p = PROFILE_SAFE;
+  
+  setValue (SQLITE_PROFILE, p);
+  
+  if (profile.isEmpty ())
+    applyProfile (p, false);
+}
+
+// Safe or interactive; bulk-load is only ever used for the length of a job,
+// since without syncs a crash can corrupt the file
+QString CDICDatabase::savedProfile ()  {
+  if (getValue (SQLITE_PROFILE) == PROFILE_INTERACTIVE)
+    return PROFILE_INTERACTIVE;
+  
+  return PROFILE_SAFE;
 }
 
 QString CDICDatabase::currentDB ()  {
@@ -139,54 +271,60 @@ QString CDICDatabase::currentDB ()  {
   else return "";
 }
 
+// Streams the file in, so nothing like the whole document is held in memory;
+// a file that turns out to be broken halfway leaves the dictionary untouched
 bool CDICDatabase::loadFromXML (QString filename)  {
-  QDomDocument doc ("ConlangML");
   QFile file (filename);
 
   if (!file.open (QFile::ReadOnly))  {
-    QMessageBox::warning (NULL, "", "Cannot read file.");
+    DATA_ERROR("Cannot read file " + filename)
     return false;
   }
-
-  if (!doc.setContent (&file))  {
-    QMessageBox::warning (NULL, "", "Cannot read XML.");
+  
+  if (!db.isOpen ())  {
+    DATA_ERROR("Please open a dictionary to load into first.")
     file.close ();
     return false;
   }
   
-  if (!db.isOpen ())  {
-    QMessageBox::warning (NULL, "", "Please open a dictionary to load into first.");
+  beginBulkLoad ();
+  
+  XMLImporter importer (db);
+  
+  if (!importer.import (&file))  {
+    endBulkLoad (false);
     file.close ();
+    
+    if (importer.errorString () != "")
+      DATA_ERROR("Cannot read XML.\n" + importer.errorString ())
+    
     return false;
   }
 
   file.close ();
-  
-  db.transaction ();
 
-  QString languageName = doc.documentElement ().attribute ("name");
-  if (languageName != "")
-    setValue (LANGUAGE_NAME, languageName);
+  if (importer.languageName () != "")
+    setValue (LANGUAGE_NAME, importer.languageName ());
 
-  if (!doc.documentElement ().firstChildElement ("squareBrackets").isNull ())
-    setValue (SQUARE_BRACKETS, "true");
-  else setValue (SQUARE_BRACKETS, "false");
-
-  if (!loadInventory (doc.documentElement ().firstChildElement ("inventory")))
-    db.rollback ();
-
-  if (!loadSupras (doc.documentElement ().firstChildElement ("suprasegmentals")))
-    db.rollback ();
-    
-  if (!loadWordList (doc.documentElement ().firstChildElement ("wordList")))
-    db.rollback ();
+  setValue (SQUARE_BRACKETS, importer.squareBrackets () ? "true" : "false");
 
-  db.commit ();
+  if (!reindexWords ())  {
+    endBulkLoad (false);
+    return false;
+  }
 
-  return true;
+  return endBulkLoad (true);
 }
 
-bool CDICDatabase::loadFromText (QString filename, QString pattern)  {
+// Lines are matched on a separate thread, and written here in one 
+// transaction with statements prepared once.  Class names are looked up
+// before the first word.  The progress, if given, hears how far the file has
+// been read after each batch, and can cancel the import, which is then
+// rolled back.
+bool CDICDatabase::loadFromText (QString filename, QString pattern,
+                                 ImportProgress *progress)  {
+  if (!db.isOpen ()) return false;
+  
   int wordLoc = pattern.indexOf ("/w");
   int classLoc = pattern.indexOf ("/c");
   int definitionLoc = pattern.indexOf ("/d");
@@ -200,53 +338,107 @@ bool CDICDatabase::loadFromText (QString filename, QString pattern)  {
   QRegExp regExp (pattern);
 //  regExp.setMinimal (true);
 
-  QFile file (filename);
-  QTextStream in (&file);
-  if (getValue (USE_UNICODE) == "true")
-    in.setCodec ("UTF-8");
-  file.open (QIODevice::ReadOnly | QIODevice::Text);
-  QString line = "";
-
-  while (!in.atEnd ())  {
-    line = in.readLine ();
-
-    if (line == "") continue;
-
-    if (!regExp.exactMatch (line))
-      continue;
-    
-    int wordID = 1;
+  // class name -> the features and values it sets
+  QHash<QString, QList< QPair<QString, QString> > > classFeatures;
+  
+  QSqlQuery query (db);
+  
+  if (!exec (query, (QString)"select name, feature, value " +
+                    "from NaturalClassWord, FeatureBundleWord where id == bundleID"))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  while (next (query))
+    classFeatures[query.value (0).toString ()]
+      .append (qMakePair (query.value (1).toString (), query.value (2).toString ()));
+  
+  finish (query);
+  
+  TextMatcher matcher (filename, regExp, wordLoc, classLoc, definitionLoc,
+                       getFlag (USE_UNICODE));
+  
+  QMap<int, QString> words;
+  
+  QSqlQuery wordQuery (db);
+  QSqlQuery featureQuery (db);
+  
+  beginBulkLoad ();
+  
+  if (!wordQuery.prepare ("insert into Word values (null, ?, ?)"))  {
+    QUERY_ERROR(wordQuery)
+    endBulkLoad (false);
+    return false;
+  }
+  
+  if (!featureQuery.prepare ("insert into WordFeatureSet values (?, ?, ?)"))  {
+    QUERY_ERROR(featureQuery)
+    endBulkLoad (false);
+    return false;
+  }
+  
+  matcher.start ();
+  
+  while (true)  {
+    QList<TextMatch> matches = matcher.takeMatches ();
     
-    QSqlQuery query (db);
-    query.prepare ("select max(id) from Word");
+    if (matches.isEmpty ()) break;
     
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      continue;
+    for (int x = 0; x < matches.size (); x++)  {
+      wordQuery.bindValue (0, matches[x].word);
+      wordQuery.bindValue (1, matches[x].definition);
+      
+      if (!exec (wordQuery))  {
+        QUERY_ERROR(wordQuery)
+        continue;
+      }
+      
+      int wordID = wordQuery.lastInsertId ().toInt ();
+      words[wordID] = matches[x].word;
+      
+      const QList< QPair<QString, QString> > &features = 
+        classFeatures[matches[x].className];
+      
+      for (int f = 0; f < features.size (); f++)  {
+        featureQuery.bindValue (0, wordID);
+        featureQuery.bindValue (1, features[f].first);
+        featureQuery.bindValue (2, features[f].second);
+        
+        if (!exec (featureQuery))
+          QUERY_ERROR(featureQuery)
+      }
     }
     
-    if (query.next ())
-      if (query.value (0).toInt () >= 1)
-        wordID = query.value (0).toInt () + 1;
-    query.finish ();
-    
-    query.prepare ("insert into Word values (NULL, :name, :def)");
-    query.bindValue (":name", regExp.cap (wordLoc));
-    query.bindValue (":def", regExp.cap (definitionLoc));
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      continue;
+    if (progress && !progress->progress (matcher.percentRead ()))  {
+      matcher.cancel ();
+      matcher.wait ();
+      
+      finish (wordQuery);
+      finish (featureQuery);
+      
+      endBulkLoad (false);
+      return false;
     }
-    
-    query.finish ();
-    
-    assignNaturalClass (regExp.cap (classLoc), wordID);
-  };
+  }
   
-  return true;
+  matcher.wait ();
+  
+  finish (wordQuery);
+  finish (featureQuery);
+  
+  if (matcher.failed ())  {
+    endBulkLoad (false);
+    DATA_ERROR("Cannot read file " + filename)
+    return false;
+  }
+  
+  if (!indexWords (words))  {
+    endBulkLoad (false);
+    return false;
+  }
+  
+  return endBulkLoad (true);
 }
 
 bool CDICDatabase::loadLexique (QString filename, QStringList params)  {
@@ -266,15 +458,7 @@ bool CDICDatabase::loadFeatures (int domain, QString filename)  {
     return false;
   }
   
-  QString domainName = (domain == PHONEME ? "Phoneme" : (domain == WORD ? "Word" : "Morpheme"));
-  
-  if (QMessageBox::warning (NULL, "Load Features", (QString)"This will delete all existing " + 
-                             domainName + " features.  Continue?",
-                             QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::No)
-    return false;
-  
-  
-  db.transaction ();
+  beginBulkLoad ();
     
   QSqlQuery query (db);
   
@@ -283,65 +467,65 @@ bool CDICDatabase::loadFeatures (int domain, QString filename)  {
   
   query.prepare ("delete from " + tableName);
     
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
-    db.rollback ();
+    finish (query);
+    endBulkLoad (false);
     return false;
   }
     
-  query.finish ();
+  finish (query);
     
   tableName = (domain == PHONEME ? "NaturalClassPhon" : 
                (domain == WORD ? "NaturalClassWord" : "NaturalClassMorpheme"));
     
   query.prepare ("delete from " + tableName);
     
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
-    db.rollback ();
+    finish (query);
+    endBulkLoad (false);
     return false;
   }
     
-  query.finish ();
+  finish (query);
     
   tableName = (domain == PHONEME ? "PhonemeSubfeature" : 
                (domain == WORD ? "WordSubfeature" : "MorphemeSubfeature"));
     
   query.prepare ("delete from " + tableName);
     
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
-    db.rollback ();
+    finish (query);
+    endBulkLoad (false);
     return false;
   }
     
-  query.finish ();
+  finish (query);
     
   tableName = (domain == PHONEME ? "PhonemeFeatureDef" : 
                (domain == WORD ? "WordFeatureDef" : "MorphemeFeatureDef"));
     
   query.prepare ("delete from " + tableName);
     
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
-    db.rollback ();
+    finish (query);
+    endBulkLoad (false);
     return false;
   }
     
-  query.finish ();
+  finish (query);
   
   QSqlQuery fquery (featuresDB);
   fquery.prepare ("select name, parentName, parentValue, displayType from " + 
                   (QString)"FeatureDef");
   
-  if (!fquery.exec ())  {
+  if (!exec (fquery))  {
     QUERY_ERROR(fquery)
-    fquery.finish ();
-    db.rollback ();
+    finish (fquery);
+    endBulkLoad (false);
     return false;
   }
   
@@ -350,7 +534,7 @@ bool CDICDatabase::loadFeatures (int domain, QString filename)  {
   tableName = (domain == PHONEME ? "PhonemeFeatureDef" : 
                (domain == WORD ? "WordFeatureDef" : "MorphemeFeatureDef"));
   
-  while (fquery.next ())  {
+  while (next (fquery))  {
     query.prepare ("insert into " + tableName + " values (:n, NULL, NULL, :d)");
     query.bindValue (":n", fquery.value (0).toString ());
     query.bindValue (":d", fquery.value (3).toString ());
@@ -359,42 +543,42 @@ bool CDICDatabase::loadFeatures (int domain, QString filename)  {
     pv << fquery.value (1).toString () << fquery.value (2).toString ();
     parentValuePairs[fquery.value (0).toString ()] = pv;
     
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      db.rollback ();
+      finish (query);
+      endBulkLoad (false);
       return false;
     }
     
-    query.finish ();
+    finish (query);
   }
   
-  fquery.finish ();
+  finish (fquery);
   fquery.prepare ("select name, value from Subfeature");
   
-  if (!fquery.exec ())  {
+  if (!exec (fquery))  {
     QUERY_ERROR(fquery)
-    fquery.finish ();
-    db.rollback ();
+    finish (fquery);
+    endBulkLoad (false);
     return false;
   }
   
   tableName = (domain == PHONEME ? "PhonemeSubfeature" : 
                (domain == WORD ? "WordSubfeature" : "MorphemeSubfeature"));
   
-  while (fquery.next ())  {
+  while (next (fquery))  {
     query.prepare ("insert into " + tableName + " values (:n, :v)");
     query.bindValue (":n", fquery.value (0).toString ());
     query.bindValue (":v", fquery.value (1).toString ());
     
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      db.rollback ();
+      finish (query);
+      endBulkLoad (false);
       return false;
     }
     
-    query.finish ();
+    finish (query);
   }
   
   QMap< QString, QList<QString> >::const_iterator i = parentValuePairs.begin ();
@@ -408,120 +592,152 @@ bool CDICDatabase::loadFeatures (int domain, QString filename)  {
     query.bindValue (":pv", i.value ()[1]);
     query.bindValue (":n", i.key ());
     
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      db.rollback ();
+      finish (query);
+      endBulkLoad (false);
       return false;
     }
     
     ++i;
   }
   
-  fquery.finish ();
+  finish (fquery);
   fquery.prepare ("select bundleID, name from NaturalClass");
   
-  if (!fquery.exec ())  {
+  if (!exec (fquery))  {
     QUERY_ERROR(fquery)
-    fquery.finish ();
-    db.rollback ();
+    finish (fquery);
+    endBulkLoad (false);
     return false;
   }
   
   tableName = (domain == PHONEME ? "NaturalClassPhon" : 
                (domain == WORD ? "NaturalClassWord" : "NaturalClassMorpheme"));
   
-  while (fquery.next ())  {
+  while (next (fquery))  {
     query.prepare ("insert into " + tableName + " values (:id, :n)");
     query.bindValue (":id", fquery.value (0).toInt ());
     query.bindValue (":n", fquery.value (1).toString ());
     
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      db.rollback ();
+      finish (query);
+      endBulkLoad (false);
       return false;
     }
     
-    query.finish ();
+    finish (query);
   }
   
-  fquery.finish ();
+  finish (fquery);
   fquery.prepare ("select id, feature, value from FeatureBundle");
   
-  if (!fquery.exec ())  {
+  if (!exec (fquery))  {
     QUERY_ERROR(fquery)
-    fquery.finish ();
-    db.rollback ();
+    finish (fquery);
+    endBulkLoad (false);
     return false;
   }
   
   tableName = (domain == PHONEME ? "FeatureBundlePhon" : 
                (domain == WORD ? "FeatureBundleWord" : "FeatureBundleMorpheme"));
   
-  while (fquery.next ())  {
+  while (next (fquery))  {
     query.prepare ("insert into " + tableName + " values (:id, :f, :v)");
     query.bindValue (":id", fquery.value (0).toInt ());
     query.bindValue (":f", fquery.value (1).toString ());
     query.bindValue (":v", fquery.value (2).toString ());
     
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      db.rollback ();
+      finish (query);
+      endBulkLoad (false);
       return false;
     }
     
-    query.finish ();
+    finish (query);
   }
   // copy features.sql tables into main tables
   
-  fquery.finish ();
+  finish (fquery);
   featuresDB.close ();
-  db.commit ();
   
-  return true;
+  return endBulkLoad (true);
 }
 
+// Everything comes from one query, and the pattern is split up once into the
+// literal text around its /w, /c, /d and /p fields.
 bool CDICDatabase::saveToText (QString filename, QString pattern)  {
-  QSqlQuery query (db);
-  query.prepare ("select id, name, definition from Word");
+  QStringList literals;
+  QList<int> fields;
+  QString fieldCodes = "wdcp";
+  QString literal = "";
+  
+  for (int x = 0; x < pattern.length (); x++)  {
+    if (pattern[x] == '/' && x + 1 < pattern.length () && 
+        fieldCodes.contains (pattern[x+1]))  {
+      literals.append (literal);
+      literal = "";
+      fields.append (fieldCodes.indexOf (pattern[++x]) + 1);
+    }
+    
+    else literal += pattern[x];
+  }
+  
+  literals.append (literal);
   
-  if (!query.exec ())  {
+  // whatever the representation cache is missing is worked out in a single
+  // pass, but not written back, since exporting only reads
+  QHash<int, QString> uncached;
+  if (fields.contains (4))
+    uncached = buildRepresentations ((QString)"select id from Word where id not in " +
+                                     "(select wordID from WordRepresentation)");
+  
+  // the class lists are grouped once for all words, not once per word
+  QSqlQuery query (db);
+  query.setForwardOnly (true);
+  query.prepare ((QString)"select Word.id, Word.name, definition, " +
+                 (fields.contains (3) ? "classlist, " : "null, ") +
+                 (fields.contains (4) ? "representation " : "null ") +
+                 "from Word " +
+                 (fields.contains (3) ? "left join ClassConcatView as c on c.id == Word.id " : "") +
+                 (fields.contains (4) ? "left join WordRepresentation on wordID == Word.id " : "") +
+                 "order by Word.id");
+  
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return false;
   }
   
   QFile file (filename);
+  
+  if (!file.open (QIODevice::WriteOnly | QIODevice::Text))  {
+    DATA_ERROR("Cannot write file " + filename)
+    finish (query);
+    return false;
+  }
+  
+  // lines end with '\n' rather than endl, which would flush every line
   QTextStream out (&file);
   out.setCodec ("UTF-8");
-  file.open (QIODevice::WriteOnly | QIODevice::Text);
   
-  while (query.next ())  {
-    QString line = pattern;
-    line.replace ("/w", query.value (1).toString ());
-    line.replace ("/d", query.value (2).toString ());
-    line.replace ("/p", getRepresentation (query.value (0).toInt ()));
-    
-    QSqlQuery classQuery (db);
-    classQuery.prepare ("select classlist from WordPageTable where id == :w");
-    classQuery.bindValue (":w", query.value (0).toInt ());
-    
-    if (!classQuery.exec ())  {
-      QUERY_ERROR(classQuery)
-      classQuery.finish ();
-      continue;
+  while (next (query))  {
+    for (int f = 0; f < fields.size (); f++)  {
+      out << literals[f];
+      
+      if (fields[f] == 4 && query.value (4).isNull ())
+        out << uncached.value (query.value (0).toInt ());
+      else out << query.value (fields[f]).toString ();
     }
     
-    if (classQuery.next ())
-      line.replace ("/c", classQuery.value (0).toString ());
-    
-    out << line << endl;
+    out << literals.last () << '\n';
   }
   
+  out.flush ();
   file.close ();
-  query.finish ();
+  finish (query);
   return true;
 }
 
@@ -564,15 +780,15 @@ bool CDICDatabase::saveFeatures (int domain, QString filename)  {
         
     QSqlQuery query (featuresDB);
         
-    if (!query.exec (queryText))  {
+    if (!exec (query, queryText))  {
       QUERY_ERROR(query);
-      query.finish ();
+      finish (query);
       featuresDB.rollback ();
       file.close ();
       return false;
     }
         
-    query.finish ();
+    finish (query);
     queryText = "";
   };
       
@@ -584,14 +800,14 @@ bool CDICDatabase::saveFeatures (int domain, QString filename)  {
   query.prepare ("select name, parentName, parentValue, displayType from " + 
                  tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     featuresDB.rollback ();
     return false;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     QSqlQuery fquery (featuresDB);
     fquery.prepare ("insert into FeatureDef values (:n, :pn, :pv, :d)");
     fquery.bindValue (":n", query.value (0).toString ());
@@ -599,99 +815,99 @@ bool CDICDatabase::saveFeatures (int domain, QString filename)  {
     fquery.bindValue (":pv", query.value (2).toString ());
     fquery.bindValue (":d", query.value (3).toString ());
     
-    if (!fquery.exec ())  {
+    if (!exec (fquery))  {
       QUERY_ERROR(fquery)
-      fquery.finish ();
+      finish (fquery);
       featuresDB.rollback ();
       return false;
     }
     
-    fquery.finish ();
+    finish (fquery);
   }
   
-  query.finish ();
+  finish (query);
   
   tableName = (domain == PHONEME ? "PhonemeSubfeature" : "WordSubfeature");
   
   query.prepare ("select name, value from " + tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     featuresDB.rollback ();
     return false;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     QSqlQuery fquery (featuresDB);
     fquery.prepare ("insert into Subfeature values (:n, :v)");
     fquery.bindValue (":n", query.value (0).toString ());
     fquery.bindValue (":v", query.value (1).toString ());
     
-    if (!fquery.exec ())  {
+    if (!exec (fquery))  {
       QUERY_ERROR(fquery)
-      fquery.finish ();
+      finish (fquery);
       featuresDB.rollback ();
       return false;
     }
   }
   
-  query.finish ();
+  finish (query);
   
   tableName = (domain == PHONEME ? "NaturalClassPhon" : "NaturalClassWord");
   
   query.prepare ("select bundleID, name from " + tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     featuresDB.rollback ();
     return false;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     QSqlQuery fquery (featuresDB);
     fquery.prepare ("insert into NaturalClass values (:id, :n)");
     fquery.bindValue (":id", query.value (0).toInt ());
     fquery.bindValue (":n", query.value (1).toString ());
     
-    if (!fquery.exec ())  {
+    if (!exec (fquery))  {
       QUERY_ERROR(fquery)
-      fquery.finish ();
+      finish (fquery);
       featuresDB.rollback ();
       return false;
     }
   }
   
-  query.finish ();
+  finish (query);
   
   tableName = (domain == PHONEME ? "FeatureBundlePhon" : "FeatureBundleWord");
   
   query.prepare ("select id, feature, value from " + tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     featuresDB.rollback ();
     return false;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     QSqlQuery fquery (featuresDB);
     fquery.prepare ("insert into FeatureBundle values (:id, :f, :v)");
     fquery.bindValue (":id", query.value (0).toInt ());
     fquery.bindValue (":f", query.value (1).toString ());
     fquery.bindValue (":v", query.value (2).toString ());
     
-    if (!fquery.exec ())  {
+    if (!exec (fquery))  {
       QUERY_ERROR(fquery)
-      fquery.finish ();
+      finish (fquery);
       featuresDB.rollback ();
       return false;
     }
   }
   
-  query.finish ();
+  finish (query);
   featuresDB.commit ();
   featuresDB.close ();
   
@@ -701,48 +917,26 @@ bool CDICDatabase::saveFeatures (int domain, QString filename)  {
 bool CDICDatabase::settingDefined (QString setting)  {
   if (!db.isOpen ()) return false;
   
-  QSqlQuery query (db);
-  query.prepare ("select value from Settings where name == :setting");
-  query.bindValue (":setting", setting);
-  
-  if (!query.exec ())  {
-    QUERY_ERROR(query)
-    query.finish ();
-    return false;
-  }
-  
-  if (query.next ())  {
-    query.finish ();
-    return true;
-  }
-  
-  else  {
-    query.finish ();
-    return false;
-  }
+  return settings->contains (setting);
 }
 
 QString CDICDatabase::getValue (QString setting)  {
   if (!db.isOpen ()) return "";
   
-  QString value = "";
-  QSqlQuery query (db);
-  query.prepare ("select value from Settings where name == :setting");
-  query.bindValue (":setting", setting);
-  
-  if (!query.exec ())  {
-    QUERY_ERROR(query)
-    query.finish ();
-    return "";
-  }
+  return settings->value (setting);
+}
+
+// A "true" or "false" setting, or the default if it is neither
+bool CDICDatabase::getFlag (QString setting, bool unset)  {
+  QString value = getValue (setting);
   
-  if (query.next ())
-    value = query.value (0).toString ();
+  if (value == "true") return true;
+  if (value == "false") return false;
   
-  query.finish ();
-  return value;
+  return unset;
 }
 
+// Written to the table first, so the cache only changes if the table did
 void CDICDatabase::setValue (QString setting, QString value)  {
   if (!db.isOpen ()) return;
   
@@ -752,21 +946,27 @@ void CDICDatabase::setValue (QString setting, QString value)  {
     query.prepare ("update Settings set value = :value where name == :setting");
     query.bindValue (":value", value);
     query.bindValue (":setting", setting);
-    
-    if (!query.exec ())
-      QUERY_ERROR(query)
   }
   
   else  {
     query.prepare ("insert into Settings values (:setting, :value)");
     query.bindValue (":setting", setting);
     query.bindValue (":value", value);
-    
-    if (!query.exec ())
-      QUERY_ERROR(query)
   }
   
-  query.finish ();
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return;
+  }
+  
+  finish (query);
+  settings->setValue (setting, value);
+}
+
+// Shared by every copy of this database, for connecting to valueChanged
+SettingsCache *CDICDatabase::getSettings ()  {
+  return settings.data ();
 }
 
 QSqlQueryModel *CDICDatabase::getPhonemeListModel ()  {
@@ -797,52 +997,52 @@ void CDICDatabase::addPhoneme (QString name, QString notes)  {
   
   int nextAlpha = 0;
 
-  if (!query.exec ("select count(alpha) from Phoneme"))  {
+  if (!exec (query, "select count(alpha) from Phoneme"))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (query.next ())
+  if (next (query))
     nextAlpha = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
 
   query.prepare ("insert into Phoneme values (null, :alpha, :name, :notes)");
   query.bindValue (":alpha", nextAlpha);
   query.bindValue (":name", name);
   query.bindValue (":notes", notes);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  query.finish ();
+  finish (query);
   
   query.prepare ("select max(id) from Phoneme");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
   int id = 0;
-  if (query.next ())
+  if (next (query))
     id = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
   
   query.prepare ("insert into PhonemeSpelling values (:id, :name)");
   query.bindValue (":id", id);
   query.bindValue (":name", name);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
   
   return;
 }
@@ -854,10 +1054,10 @@ void CDICDatabase::deletePhoneme (QString name)  {
   query.prepare ("delete from Phoneme where name == :name");
   query.bindValue (":name", name);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
   
-  query.finish ();
+  finish (query);
 }
 
 void CDICDatabase::movePhonemeUp (int alpha)  {
@@ -869,10 +1069,10 @@ void CDICDatabase::movePhonemeUp (int alpha)  {
   query.bindValue (":new", alpha-1);
   query.bindValue (":old", alpha);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 void CDICDatabase::movePhonemeDown (int alpha)  {
@@ -889,21 +1089,21 @@ void CDICDatabase::setSpellings (QString phon, QString s)  {
   query.prepare ("select id from Phoneme where name == :name");
   query.bindValue (":name", phon);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
+  if (!next (query))  {
     DATA_ERROR("No such phoneme: " + phon)
-    query.finish ();
+    finish (query);
     return;
   }
   
   else phonID = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
   
   db.transaction ();
   
@@ -912,14 +1112,14 @@ void CDICDatabase::setSpellings (QString phon, QString s)  {
     query.bindValue (":id", phonID);
     query.bindValue (":spell", spellings[x]);
       
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
+      finish (query);
       db.rollback ();
       return;
     }
     
-    query.finish ();
+    finish (query);
   }
   
   QStringList placeholders;
@@ -933,14 +1133,14 @@ void CDICDatabase::setSpellings (QString phon, QString s)  {
   for (int x = 0; x < spellings.size (); x++)
     query.bindValue (x+1, spellings[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     db.rollback ();
     return;
   }
   
-  query.finish ();
+  finish (query);
   db.commit ();
 }
 
@@ -957,10 +1157,10 @@ void CDICDatabase::assignNaturalClass (QString className, QString phonName)  {
   query.bindValue (":pn", phonName);
   query.bindValue (":cn", className);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
 
-  query.finish ();
+  finish (query);
 }
 
 QString CDICDatabase::getPhonemeName (int id)  {
@@ -970,18 +1170,18 @@ QString CDICDatabase::getPhonemeName (int id)  {
   query.prepare ("select name from Phoneme where id == :id");
   query.bindValue (":id", id);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
   QString name = "";
   
-  if (query.next ())
+  if (next (query))
     name = query.value (0).toString ();
   
-  query.finish ();
+  finish (query);
   return name;
 }
 
@@ -994,38 +1194,38 @@ QString CDICDatabase::getSpellingText (QString phon)  {
   query.prepare ("select id from Phoneme where name == :name");
   query.bindValue (":name", phon);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
-  if (!query.next ())  {
+  if (!next (query))  {
     DATA_ERROR("No such phoneme: " + phon)
-    query.finish ();
+    finish (query);
     return "";
   }
   
   phonID = query.value (0).toInt ();
-  query.finish ();
+  finish (query);
   
   query.prepare ("select spelling from PhonemeSpelling where phonemeID == :id");
   query.bindValue (":id", phonID);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
   QString text = "";
   
-  while (query.next ())
+  while (next (query))
     text += query.value (0).toString () + " ";
   
   if (text != "") text.chop (1);
   
-  query.finish ();
+  finish (query);
   return text;
 }
 
@@ -1036,13 +1236,13 @@ QStringList CDICDatabase::getAllPhonemeNames ()  {
   
   QSqlQuery query (db);
   
-  if (!query.exec ("select name from Phoneme"))  {
+  if (!exec (query, "select name from Phoneme"))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return list;
   }
   
-  while (query.next ())
+  while (next (query))
     list.append (query.value (0).toString ());
   
   return list;
@@ -1076,10 +1276,10 @@ void CDICDatabase::addSupra (QString name)  {
   query.prepare ("insert into Suprasegmental(name) values (:name)");
   query.bindValue (":name", name);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::deleteSupra (QString name)  {
@@ -1089,10 +1289,10 @@ void CDICDatabase::deleteSupra (QString name)  {
   query.prepare ("delete from Suprasegmental where name == :name");
   query.bindValue (":name", name);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::setSupraApplies (QString name, QStringList phonList)  {
@@ -1107,33 +1307,33 @@ void CDICDatabase::setSupraApplies (QString name, QStringList phonList)  {
   query.prepare ("select id from Suprasegmental where name == :name");
   query.bindValue (":name", name);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
+  if (!next (query))  {
     DATA_ERROR("No such suprasegmental: " + name)
-    query.finish ();
+    finish (query);
     return;
   }
   
   int supraID = query.value (0).toInt ();
-  query.finish ();
+  finish (query);
   
   QList<int> phonID;
   query.prepare ("select id from Phoneme where name in (" + placeholders.join (", ") + ")");
   for (int x = 0; x < phonList.size (); x++)
     query.bindValue (x, phonList[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  while (query.next ())
+  while (next (query))
     phonID.append (query.value (0).toInt ());
   
   db.transaction ();
@@ -1145,9 +1345,9 @@ void CDICDatabase::setSupraApplies (QString name, QStringList phonList)  {
   for (int x = 0; x < phonList.size (); x++)
     query.bindValue (x+1, phonList[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     db.rollback ();
     return;
   }
@@ -1161,14 +1361,14 @@ void CDICDatabase::setSupraApplies (QString name, QStringList phonList)  {
   for (int x = 0; x < phonID.size (); x++)
     query.bindValue (x+1, phonID[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     db.rollback ();
     return;
   }
   
-  query.finish ();
+  finish (query);
   db.commit ();
 }
 
@@ -1183,16 +1383,16 @@ QStringList CDICDatabase::getSupraApplies (QString name)  {
                        "and phonemeID == Phoneme.id");
   query.bindValue (":n", name);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return applies;
   }
   
-  while (query.next ())
+  while (next (query))
     applies.append (query.value (0).toString ());
   
-  query.finish ();
+  finish (query);
   
   return applies;
 }
@@ -1205,13 +1405,13 @@ QList<Suprasegmental> CDICDatabase::getSupras ()  {
   QSqlQuery query (db);
   query.prepare ("select id, name, domain, repType, repText from Suprasegmental");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return supraList;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     Suprasegmental s;
     s.name = query.value (1).toString ();
     s.domain = query.value (2).toInt ();
@@ -1223,19 +1423,19 @@ QList<Suprasegmental> CDICDatabase::getSupras ()  {
                           "where id == phonemeID and supraID == :sid");
     appliesQuery.bindValue (":sid", query.value (0).toInt ());
     
-    if (!appliesQuery.exec ())  {
+    if (!exec (appliesQuery))  {
       QUERY_ERROR(appliesQuery)
-      appliesQuery.finish ();
+      finish (appliesQuery);
       supraList.append (s);
       continue;
     }
     
     QStringList appliesList;
     
-    while (appliesQuery.next ())
+    while (next (appliesQuery))
       appliesList.append (appliesQuery.value (0).toString ());
     
-    appliesQuery.finish ();
+    finish (appliesQuery);
     
     s.applicablePhonemes = appliesList;
     
@@ -1262,15 +1462,15 @@ QStringList CDICDatabase::getSequenceList (int loc)  {
   query.prepare ("select id, ind, name from " + tableName + ", NaturalClassPhon " +
                  "where class == bundleID");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return list;
   }
   
   QList< QList<QStringList> > data;
   
-  while (query.next ())  {
+  while (next (query))  {
     int id = query.value(0).toInt ();
     int ind = query.value(1).toInt ();
     QString className = query.value(2).toString ();
@@ -1320,19 +1520,19 @@ void CDICDatabase::addSequence (int loc, QList<QStringList> sequence)  {
   QSqlQuery query (db);
   query.prepare ("select max(id) from " + tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
   int nextID = 1;
   
-  if (query.next ())
+  if (next (query))
     if (query.value(0).toInt () >= 1)
       nextID = query.value(0).toInt () + 1;
   
-  query.finish ();
+  finish (query);
   
   for (int ind = 0; ind < sequence.size (); ind++)  {
     for (int c = 0; c < sequence[ind].size (); c++)  {
@@ -1341,30 +1541,30 @@ void CDICDatabase::addSequence (int loc, QList<QStringList> sequence)  {
       query.prepare ("select bundleID from NaturalClassPhon where name == :name");
       query.bindValue (":name", sequence[ind][c]);
       
-      if (!query.exec ())  {
+      if (!exec (query))  {
         QUERY_ERROR(query)
-        query.finish ();
+        finish (query);
         continue;
       }
       
-      if (!query.next ())  {
-        query.finish ();
+      if (!next (query))  {
+        finish (query);
         continue;
       }
       
       classID = query.value(0).toInt ();
       
-      query.finish ();
+      finish (query);
       
       query.prepare ("insert into " + tableName + " values (:id, :ind, :class)");
       query.bindValue (":id", nextID);
       query.bindValue (":ind", ind);
       query.bindValue (":class", classID);
       
-      if (!query.exec ())
+      if (!exec (query))
         QUERY_ERROR(query)
         
-      query.finish ();
+      finish (query);
     }
   }
 }
@@ -1384,118 +1584,201 @@ void CDICDatabase::removeSequence (int loc, int id)  {
   query.prepare ("delete from " + tableName + " where id == :id");
   query.bindValue (":id", id);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
     
-  query.finish ();
+  finish (query);
   
   query.prepare ("update " + tableName + " set id = id - 1 where id > :id");
   query.bindValue (":id", id);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();  
+  finish (query);  
   return;
 }
 
-QSqlQueryModel *CDICDatabase::getWordListModel ()  {
+WordListModel *CDICDatabase::getWordListModel ()  {
   if (!db.isOpen ()) return NULL;
   
-  QSqlQueryModel *model = new QSqlQueryModel (NULL);
-  model->setQuery ("select id, name, classlist from WordPageTable order by name", db);
-  
-  return model;
+  return new WordListModel (db);
 }
     
-void CDICDatabase::searchWordList (QSqlQueryModel *model, QString search,
-                                   QString className, QString languageName)  {
+// Lists the words found by a search, or every word when there is nothing to
+// search for
+void CDICDatabase::searchWordList (WordListModel *model, QString search,
+                                   QString className, QString languageName,
+                                   int mode)  {
   if (!model) return;
   
-  if (search == "" && (className == "" || className == "Any Word Type"))  {
-    model->setQuery ("select id, name, classlist from WordPageTable order by name");
+  QSqlQuery query (db);
+  
+  if (!prepareWordSearch (query, search, className, languageName,
+                          getValue (IGNORED_CHARACTERS), mode))  {
+    model->showAll ();
+    return;
+  }
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
     return;
   }
   
-  search.prepend ("%");
-  search.append ("%");
+  QList<int> ids;
+  while (next (query))
+    ids.append (query.value (0).toInt ());
+  
+  finish (query);
+  
+  model->showResults (ids);
+}
 
-  QSqlQuery query (db);
+// Prepares a query for the ids of the words found by a search, best first;
+// false if there is nothing to search for.  Conlang searches use the name
+// index for prefixes and the WordGram index for substrings, which leaves out
+// spaces and the given ignored characters; English searches use the WordText
+// index for words starting with each search term and scan the definitions for
+// substrings.  Exact matches come first, then those starting with the search,
+// then the rest by name.
+bool CDICDatabase::prepareWordSearch (QSqlQuery &query, QString search,
+                                      QString className, QString languageName,
+                                      QString ignored, int mode)  {
+  if (className == "Any Word Type") className = "";
+  
+  bool english = (languageName == "English");
+  QString match;
+  
+  if (english && mode == SEARCH_PREFIX)  {
+    match = prefixMatch (search);
+    if (match == "") search = "";
+  }
+  
+  if (search == "" && className == "")
+    return false;
   
-  if (search == "")  {
-    query.prepare ("select id, name, classlist from WordPageTable " +
-                   (QString)"where exists " +
-                     "(select * from WordClassList " +
-                      "where WordClassList.id == WordPageTable.id and " +
-                            "WordClassList.class = :class) " +
-                   "order by name");
-    query.bindValue (":class", className);
-  }
+  QStringList conditions;
+  QString order = "name";
   
-  else if ((className == "" || className == "Any Word Type") && 
-           languageName != "English")  {
-    query.prepare ("select id, name, classlist from WordPageTable " +
-                  (QString)"where name like :search " +
-                  "order by name");
-    query.bindValue (":search", search);
-  }
-                  
-  else if (languageName != "English")  {
-    query.prepare ((QString)"select id, name, classlist from WordPageTable " +
-                   "where name like :search and exists " +
-                     "(select * from WordClassList " +
-                      "where WordClassList.id == WordPageTable.id and " +
-                            "WordClassList.class == :class) " +
-                   "order by name");
-    query.bindValue (":search", search);
-    query.bindValue (":class", className);
+  if (search != "")  {
+    if (!english && mode == SEARCH_PREFIX)
+      conditions << "name >= :low and name < :high";
+    
+    // every substring starts some gram with its first three characters
+    else if (!english)
+      conditions << "id in (select wordID from WordGram " +
+                    (QString)"where gram >= :low and gram < :high)"
+                 << "name like :search";
+    
+    else if (mode == SEARCH_PREFIX)
+      conditions << "id in (select docid from WordText where definition match :match)";
+    
+    else conditions << "definition like :search";
+    
+    QString field = (english ? "definition" : "name");
+    order = field + " != :exact, substr(" + field + ", 1, :length) != :start, name";
   }
   
-  else if ((className == "" || className == "Any Word Type") &&
-           languageName == "English")  {
-    query.prepare ("select Word.id, Word.name, classlist from Word, WordPageTable " +
-                   (QString)"where Word.id == WordPageTable.id and " +
-                                  "definition like :search " +
-                   "order by name");
-    query.bindValue (":search", search);
-  }
+  if (className != "")
+    conditions << "id in (select id from WordClassList where class == :class)";
   
-  else  {
-    query.prepare ("select Word.id, Word.name, classlist from Word, WordPageTable " +
-                   (QString)"where Word.id == WordPageTable.id and " +
-                   "definition like :search and exists " +
-                     "(select * from WordClassList " +
-                      "where WordClassList.id == WordPageTable.id and " +
-                            "WordClassList.class == :class) " +
-                      "order by name");
-    query.bindValue (":search", search);
-    query.bindValue (":class", className);
-  }
+  query.prepare ("select id from Word where " + conditions.join (" and ") + " " +
+                 "order by " + order);
   
-  if (!query.exec ())  {
-    QUERY_ERROR(query)
-    query.finish ();
-    return;
+  if (search != "")  {
+    QString low = (mode == SEARCH_PREFIX ? search
+                                         : firstGram (indexedName (search, ignored)));
+    
+    query.bindValue (":low", low);
+    query.bindValue (":high", prefixEnd (low));
+    query.bindValue (":search", "%" + search + "%");
+    query.bindValue (":match", match);
+    query.bindValue (":exact", search);
+    query.bindValue (":length", search.size ());
+    query.bindValue (":start", search);
   }
   
-  model->setQuery (query);
+  if (className != "")
+    query.bindValue (":class", className);
   
-  return;
+  return true;
 }
-    
-QSqlTableModel *CDICDatabase::getWordDisplayModel ()  {
-  if (!db.isOpen ()) return NULL;
+
+// A name as the parser reads it, without spaces or ignored characters
+QString CDICDatabase::indexedName (QString name, QString ignored)  {
+  QString indexed;
   
-  QSqlTableModel *model = new QSqlTableModel (NULL, db);
-  model->setTable ("Word");
-  model->setSort (0, Qt::AscendingOrder);
-  model->setEditStrategy (QSqlTableModel::OnManualSubmit);
-  model->select ();
+  for (int x = 0; x < name.size (); x++)
+    if (name[x] != ' ' && !ignored.contains (name[x]))
+      indexed.append (name[x]);
   
-  return model;
+  return indexed;
+}
+
+// The gram a name starts with in the WordGram index: its first three
+// characters, a character outside the BMP counting as one
+QString CDICDatabase::firstGram (QString name)  {
+  QVector<uint> points = name.toUcs4 ();
+  
+  return QString::fromUcs4 (points.constData (), qMin (3, points.size ()));
+}
+
+// The least value above every string that starts with prefix, by code point
+// as SQLite compares text, for looking up a prefix as a range on an index
+QVariant CDICDatabase::prefixEnd (QString prefix)  {
+  QVector<uint> points = prefix.toUcs4 ();
+  
+  while (!points.isEmpty () && points.last () >= 0x10ffff)
+    points.remove (points.size () - 1);
+  
+  // SQLite sorts any blob after all text
+  if (points.isEmpty ())
+    return QByteArray ("");
+  
+  points.last ()++;
+  
+  // surrogates are not characters of their own
+  if (points.last () == 0xd800)
+    points.last () = 0xe000;
+  
+  return QString::fromUcs4 (points.constData (), points.size ());
+}
+
+// A full text match for entries with a word starting with each search term.
+// Each term is quoted, so that none of them are taken as operators.
+QString CDICDatabase::prefixMatch (QString search)  {
+  QStringList terms = search.remove ('"').split (QRegExp ("\\s+"),
+                                                 QString::SkipEmptyParts);
+  
+  for (int x = 0; x < terms.size (); x++)
+    terms[x] = "\"" + terms[x] + "*\"";
+  
+  return terms.join (" ");
+}
+    
+QSqlTableModel *CDICDatabase::getWordDisplayModel ()  {
+  if (!db.isOpen ()) return NULL;
+  
+  QSqlTableModel *model = new QSqlTableModel (NULL, db);
+  model->setTable ("Word");
+  model->setSort (0, Qt::AscendingOrder);
+  model->setEditStrategy (QSqlTableModel::OnManualSubmit);
+  model->select ();
+  fetchAll (model);
+  
+  return model;
+}
+
+// Reads every row a model has selected.  A model only reads the first 256,
+// and until it reaches the end its query keeps a read lock on the file,
+// which stops a reanalysis or import on another connection from committing.
+void CDICDatabase::fetchAll (QSqlTableModel *model)  {
+  while (model->canFetchMore ())
+    model->fetchMore ();
 }
     
 int CDICDatabase::addWord (QString name, QString definition)  {
@@ -1506,23 +1789,88 @@ int CDICDatabase::addWord (QString name, QString definition)  {
   query.bindValue (":name", name);
   query.bindValue (":def", definition);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
   
   query.prepare ("select max(id) from Word");
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.next ();
+  next (query);
   
   int wordID = query.value (0).toInt ();
-  query.finish ();
+  finish (query);
+  
+  QMap<int, QString> word;
+  word[wordID] = name;
+  indexWords (word);
   
   return wordID;
 }
+
+// Rewrites the WordGram rows of the given words from their names
+bool CDICDatabase::indexWords (QMap<int, QString> words)  {
+  if (!db.isOpen ()) return false;
+  if (words.isEmpty ()) return true;
+  
+  QString ignored = getValue (IGNORED_CHARACTERS);
+  
+  QVariantList ids;
+  QVariantList gramIDs;
+  QVariantList positions;
+  QVariantList grams;
+  
+  for (QMap<int, QString>::const_iterator w = words.constBegin ();
+       w != words.constEnd (); w++)  {
+    ids.append (w.key ());
+    QString name = indexedName (w.value (), ignored);
+    
+    // grams are counted in characters, so that none splits a surrogate pair
+    QVector<uint> points = name.toUcs4 ();
+    
+    for (int x = 0; x < points.size (); x++)  {
+      gramIDs.append (w.key ());
+      positions.append (x + 1);
+      grams.append (QString::fromUcs4 (points.constData () + x,
+                                       qMin (3, points.size () - x)));
+    }
+  }
+  
+  bool ownTransaction;
+  if (!joinTransaction (ownTransaction)) return false;
+  
+  QSqlQuery query (db);
+  query.prepare ("delete from WordGram where wordID == ?");
+  query.addBindValue (ids);
+  
+  bool ok = execBatch (query);
+  
+  if (!ok)
+    QUERY_ERROR(query)
+  
+  else if (!grams.isEmpty ())  {
+    query.prepare ("insert into WordGram values (?, ?, ?)");
+    query.addBindValue (gramIDs);
+    query.addBindValue (positions);
+    query.addBindValue (grams);
+    
+    ok = execBatch (query);
+    
+    if (!ok)
+      QUERY_ERROR(query)
+  }
+  
+  finish (query);
+  
+  return leaveTransaction (ownTransaction, ok);
+}
+
+bool CDICDatabase::reindexWords ()  {
+  return indexWords (getWordNames ());
+}
     
 void CDICDatabase::deleteWord (int wordID)  {
   if (!db.isOpen ()) return;
@@ -1531,10 +1879,10 @@ void CDICDatabase::deleteWord (int wordID)  {
   query.prepare ("delete from Word where id == :id");
   query.bindValue (":id", wordID);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::assignNaturalClass (QString className, int wordID)  {
@@ -1550,564 +1898,538 @@ void CDICDatabase::assignNaturalClass (QString className, int wordID)  {
   query.bindValue (":wi", wordID);
   query.bindValue (":cn", className);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 bool CDICDatabase::setPhonology (int wordID, QList<Syllable> phonology)  {
-  if (!db.isOpen ()) return false;
+  QList< QPair<int, QList<Syllable> > > phonologies;
+  phonologies.append (qMakePair (wordID, phonology));
   
-  QSqlQuery query (db);
+  return setPhonologyBatch (phonologies) == 1;
+}
+
+// Replaces the phonologies of many words at once: names are resolved from
+// one lookup of each table, and each table gets a single prepared statement
+// executed in a batch, and the words' cached representations are rebuilt
+// from what was written.  A word given more than once keeps its last
+// phonology, and a supra repeated on a phoneme or syllable is written once.
+// A word with an unknown phoneme or supra is reported and left as it was.
+// Returns the number of words written, or -1 if the database failed part
+// way, in which case the caller should roll back.  Callers writing many
+// words should wrap this in a transaction, and callers writing many batches
+// should pass statements to keep the lookups and statements between them.
+int CDICDatabase::setPhonologyBatch (QList< QPair<int, QList<Syllable> > > phonologies,
+                                     PhonologyStatements *statements)  {
+  if (!db.isOpen ()) return -1;
+  if (phonologies.isEmpty ()) return 0;
   
-//  db.transaction ();
+  PhonologyStatements local;
   
-  for (int x = 0; x < 7; x++)  {
-    QString tableName = "OnsetSupra";
-    if (x == 1) tableName = "PeakSupra";
-    if (x == 2) tableName = "CodaSupra";
-    if (x == 3) tableName = "Onset";
-    if (x == 4) tableName = "Peak";
-    if (x == 5) tableName = "Coda";
-    if (x == 6) tableName = "SyllableSupra";
-    
-    query.prepare ("delete from " + tableName + " where wordID == :wID");
-    query.bindValue (":wID", wordID);
+  if (!statements)  {
+    local.ready = false;
+    statements = &local;
+  }
   
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-//      db.rollback ();
-      return false;
-    }
+  if (!statements->ready && !preparePhonologyStatements (*statements))
+    return -1;
+  
+  const QHash<QString, int> &phonemeIDs = statements->phonemeIDs;
+  const QHash<QString, int> &supraIDs = statements->supraIDs;
+  
+  // per table, the values of each column of the rows to insert
+  QList< QList<QVariantList> > rows;
+  for (int t = 0; t < PHONOLOGY_TABLES; t++)  {
+    rows.append (QList<QVariantList> ());
     
-    query.finish ();
+    for (int c = 0; c < (t == 6 ? 3 : 4); c++)
+      rows[t].append (QVariantList ());
   }
   
-  for (int syll = 0; syll < phonology.size (); syll++)  {
-    // syllable supras
-    for (int sup = 0; sup < phonology[syll].supras.size (); sup++)  {
-      query.prepare ("select id from Suprasegmental where name == :n");
-      query.bindValue (":n", phonology[syll].supras[sup]);
-      
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-//        db.rollback ();
-        return false;
-      }
-      
-      if (!query.next ())  {
-        DATA_ERROR("Could not find suprasegmental " + phonology[syll].supras[sup])
-        query.finish ();
-//        db.rollback ();
-        return false;
-      }
-      
-      int supID = query.value (0).toInt ();
-      
-      query.finish ();
-      query.prepare ("insert into SyllableSupra values (:wID, :sNum, :sID)");
-      query.bindValue (":wID", wordID);
-      query.bindValue (":sNum", syll);
-      query.bindValue (":sID", supID);
-      
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-//        db.rollback ();
-        return false;
-      }
-      
-      query.finish ();
+  // word -> its last place in the list
+  QHash<int, int> latest;
+  for (int w = 0; w < phonologies.size (); w++)
+    latest[phonologies[w].first] = w;
+  
+  QVariantList wordIDs;
+  
+  for (int w = 0; w < phonologies.size (); w++)  {
+    int wordID = phonologies[w].first;
+    const QList<Syllable> &phonology = phonologies[w].second;
+    
+    if (latest[wordID] != w) continue;
+    
+    QString unknown = findUnknownName (phonology, phonemeIDs, supraIDs);
+    
+    if (unknown != "")  {
+      DATA_ERROR("Could not save the phonology of word " + QString::number (wordID) +
+                 ": " + unknown)
+      continue;
     }
     
-    for (int x = 0; x < 3; x++)  {
-      QString tableName = "Onset";
-      if (x == 1) tableName = "Peak";
-      if (x == 2) tableName = "Coda";
-      
-      QList<Phoneme> currList = phonology[syll].onset;
-      if (x == 1) currList = phonology[syll].peak;
-      if (x == 2) currList = phonology[syll].coda;
+    wordIDs.append (wordID);
+    
+    for (int syll = 0; syll < phonology.size (); syll++)  {
+      // syllable supras
+      QSet<int> written;
       
-      for (int p = 0; p < currList.size (); p++)  {
-        query.prepare ("select id from Phoneme where name == :n");
-        query.bindValue (":n", currList[p].name);
-        
-        if (!query.exec ())  {
-          QUERY_ERROR(query)
-          query.finish ();
-//          db.rollback ();
-          return false;
-        }
-        
-        if (!query.next ())  {
-          DATA_ERROR("Could not find phoneme " + currList[p].name)
-          query.finish ();
-//          db.rollback ();
-          return false;
-        }
-        
-        int pID = query.value (0).toInt ();
+      for (int sup = 0; sup < phonology[syll].supras.size (); sup++)  {
+        int supraID = supraIDs[phonology[syll].supras[sup]];
+        if (written.contains (supraID)) continue;
+        written.insert (supraID);
         
-        query.finish ();
-        query.prepare ("insert into " + tableName + " values (:wID, :sNum, :ind, :pID)");
-        query.bindValue (":wID", wordID);
-        query.bindValue (":sNum", syll);
-        query.bindValue (":ind", p);
-        query.bindValue (":pID", pID);
-        
-        if (!query.exec ())  {
-          QUERY_ERROR(query)
-          query.finish ();
-//          db.rollback ();
-          return false;
-        }
-        
-        query.finish ();
+        rows[6][0].append (wordID);
+        rows[6][1].append (syll);
+        rows[6][2].append (supraID);
+      }
+      
+      for (int x = 0; x < 3; x++)  {
+        const QList<Phoneme> &currList = (x == 0 ? phonology[syll].onset :
+                                          (x == 1 ? phonology[syll].peak : 
+                                                    phonology[syll].coda));
         
-        for (int s = 0; s < currList[p].supras.size (); s++)  {
-          query.prepare ("select id from Suprasegmental where name == :n");
-          query.bindValue (":n", currList[p].supras[s]);
-          
-          if (!query.exec ())  {
-            QUERY_ERROR(query)
-            query.finish ();
-//            db.rollback ();
-            return false;
-          }
-          
-          if (!query.next ())  {
-            DATA_ERROR("Could not find suprasegmental " + currList[p].supras[s])
-            query.finish ();
-//            db.rollback ();
-            return false;
-          }
-          
-          int sID = query.value (0).toInt ();
+        for (int p = 0; p < currList.size (); p++)  {
+          rows[x+3][0].append (wordID);
+          rows[x+3][1].append (syll);
+          rows[x+3][2].append (p);
+          rows[x+3][3].append (phonemeIDs[currList[p].name]);
           
-          query.finish ();
-          query.prepare ("insert into " + tableName + "Supra values (:wID, :sNum, :ind, :sID)");
-          query.bindValue (":wID", wordID);
-          query.bindValue (":sNum", syll);
-          query.bindValue (":ind", p);
-          query.bindValue (":sID", sID);
+          written.clear ();
           
-          if (!query.exec ())  {
-            QUERY_ERROR(query)
-            query.finish ();
-//            db.rollback ();
-            return false;
+          for (int s = 0; s < currList[p].supras.size (); s++)  {
+            int supraID = supraIDs[currList[p].supras[s]];
+            if (written.contains (supraID)) continue;
+            written.insert (supraID);
+            
+            rows[x][0].append (wordID);
+            rows[x][1].append (syll);
+            rows[x][2].append (p);
+            rows[x][3].append (supraID);
           }
-          
-          query.finish ();
         }
       }
     }
   }
   
-//  db.commit ();
-  return true;
-}
-     
-QString CDICDatabase::getRepresentation (int wordID)  {
-  if (!db.isOpen ()) return "";
-  
-  QSqlQuery query (db);
-  QString text = "";
-  int syllNum = 0;
+  if (wordIDs.isEmpty ()) return 0;
   
-  while (true)  {
-    QString syllText = "";
-    
-    if (syllNum > 0)
-      syllText += ".";
-    
-    // load before supra
-    query.prepare ((QString)"select repText from Suprasegmental, SyllableSupra " +
-                   "where wordID == :wi and syllNum == :sn and supraID == id and " +
-                         "repType == :rt");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    query.bindValue (":rt", TYPE_BEFORE);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    if (query.next ())
-      syllText += query.value (0).toString ();
-    
-    query.finish ();
-    
-    QStringList tempList;
-    
-    // get onset phonemes
-    query.prepare ((QString)"select name from Onset, Phoneme " +
-                   "where wordID == :wi and syllNum == :sn and phonemeID == id " +
-                   "order by ind");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    while (query.next ())
-      tempList.append (query.value (0).toString ());
-    
-    query.finish ();
+  for (int t = 0; t < PHONOLOGY_TABLES; t++)  {
+    QSqlQuery &query = statements->deletes[t];
+    query.bindValue (0, wordIDs);
     
-    // get onset supras
-    query.prepare ("select ind, repType, repText from OnsetSupra, Suprasegmental " +
-                   (QString)"where wordID == :wi and syllNum == :sn and supraID == id");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    while (query.next ())  {
-      int ind = query.value (0).toInt ();
-      int rty = query.value (1).toInt ();
-      QString rtx = query.value (2).toString ();
-      
-      if (rty == TYPE_BEFORE) tempList[ind].prepend (rtx);
-      else if (rty == TYPE_AFTER) tempList[ind].append (rtx);
-      else if (rty == TYPE_DOUBLED) tempList[ind].append (tempList[ind]);
-      else tempList[ind] = applyDiacritic (rty, tempList[ind]);
-    }
-    
-    syllText += tempList.join ("");
-    tempList.clear ();
-    
-    query.finish ();
-    
-    // get peak phonemes
-    query.prepare ((QString)"select name from Peak, Phoneme " +
-                   "where wordID == :wi and syllNum == :sn and phonemeID == id " +
-                   "order by ind");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    while (query.next ())
-      tempList.append (query.value (0).toString ());
-    
-    query.finish ();
-    
-    // get peak-based syllable supra
-    query.prepare ((QString)"select repType from SyllableSupra, Suprasegmental " +
-                   "where wordID == :wi and syllNum == :sn and supraID == id " +
-                     "and (repType < :before or repType == :doubled)");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    query.bindValue (":before", TYPE_BEFORE);
-    query.bindValue (":doubled", TYPE_DOUBLED);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    if (query.next ())  {
-      if (query.value (0) == TYPE_DOUBLED)  {
-        int l = tempList.length ();
-        for (int x = 0; x < l; x++)
-          tempList.append (tempList[x]);
-      }
-      
-      else for (int x = 0; x < tempList.length (); x++)
-        tempList[x] = applyDiacritic (query.value (0).toInt (), tempList[x]);
-    }
-    
-    query.finish ();
-    
-    // get peak supras
-    query.prepare ("select ind, repType, repText from PeakSupra, Suprasegmental " +
-                   (QString)"where wordID == :wi and syllNum == :sn and supraID == id");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    while (query.next ())  {
-      int ind = query.value (0).toInt ();
-      int rty = query.value (1).toInt ();
-      QString rtx = query.value (2).toString ();
-      
-      if (rty == TYPE_BEFORE) tempList[ind].prepend (rtx);
-      else if (rty == TYPE_AFTER) tempList[ind].append (rtx);
-      else if (rty == TYPE_DOUBLED) tempList[ind].append (tempList[ind]);
-      else tempList[ind] = applyDiacritic (rty, tempList[ind]);
-    }
-    
-    query.finish ();
-    
-    syllText += tempList.join ("");
-    tempList.clear ();
-    
-    // get coda phonemes
-    query.prepare ((QString)"select name from Coda, Phoneme " +
-                   "where wordID == :wi and syllNum == :sn and phonemeID == id " +
-                   "order by ind");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    
-    if (!query.exec ())  {
+    if (!execBatch (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      break;
-    }
-    
-    while (query.next ())
-      tempList.append (query.value (0).toString ());
-    
-    query.finish ();
-    
-    // get coda supras
-    query.prepare ("select ind, repType, repText from CodaSupra, Suprasegmental " +
-                   (QString)"where wordID == :wi and syllNum == :sn and supraID == id");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      break;
+      finish (query);
+      return -1;
     }
     
-    while (query.next ())  {
-      int ind = query.value (0).toInt ();
-      int rty = query.value (1).toInt ();
-      QString rtx = query.value (2).toString ();
-      
-      if (rty == TYPE_BEFORE) tempList[ind].prepend (rtx);
-      else if (rty == TYPE_AFTER) tempList[ind].append (rtx);
-      else if (rty == TYPE_DOUBLED) tempList[ind].append (tempList[ind]);
-      else tempList[ind] = applyDiacritic (rty, tempList[ind]);
-    }
-    
-    query.finish ();
+    finish (query);
+  }
+  
+  // and the segment tables come first when inserting
+  int order[] = {3, 4, 5, 0, 1, 2, 6};
+  
+  for (int x = 0; x < PHONOLOGY_TABLES; x++)  {
+    int t = order[x];
     
-    syllText += tempList.join ("");
-    tempList.clear ();
+    if (rows[t][0].isEmpty ()) continue;
     
-    // get after supra
-    query.prepare ((QString)"select repText from Suprasegmental, SyllableSupra " +
-                   "where wordID == :wi and syllNum == :sn and supraID == id and " +
-                         "repType == :rt");
-    query.bindValue (":wi", wordID);
-    query.bindValue (":sn", syllNum);
-    query.bindValue (":rt", TYPE_AFTER);
+    QSqlQuery &query = statements->inserts[t];
+    for (int c = 0; c < rows[t].size (); c++)
+      query.bindValue (c, rows[t][c]);
     
-    if (!query.exec ())  {
+    if (!execBatch (query))  {
       QUERY_ERROR(query)
-      query.finish ();
-      break;
+      finish (query);
+      return -1;
     }
     
-    if (query.next ())
-      syllText += query.value (0).toString ();
-    
-    query.finish ();
-    
-    if (syllText == "" || syllText == ".")
-      break;
-    
-    text += syllText;
-    syllText = "";
-    
-    syllNum++;
+    finish (query);
   }
   
-  return text;
-}
-
-QList<Syllable> CDICDatabase::getPhonology (int wordID)  {
-  if (!db.isOpen ()) return QList<Syllable> ();
-  
-  QList<Syllable> syllList;
-  QSqlQuery query (db);
+  QStringList idList;
+  for (int w = 0; w < wordIDs.size (); w++)
+    idList.append (wordIDs[w].toString ());
   
-  // onsets, peaks, codas
-  for (int x = 0; x <= 2; x++)  {
-    QString tableName = "Onset";
-    if (x == 1) tableName = "Peak";
-    if (x == 2) tableName = "Coda";
-    
-    query.prepare ("select syllNum, ind, name from "+ tableName +", Phoneme " +
-                   "where id == phonemeID and wordID == :wID");
-    query.bindValue (":wID", wordID);
+  if (!cacheRepresentations (idList.join (", ")))
+    return -1;
   
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return syllList;
+  return wordIDs.size ();
+}
+
+// Looks up the phoneme and supra names and prepares the statements for
+// setPhonologyBatch
+bool CDICDatabase::preparePhonologyStatements (PhonologyStatements &statements)  {
+  statements.phonemeIDs = getNameIDs ("Phoneme");
+  statements.supraIDs = getNameIDs ("Suprasegmental");
+  
+  // supra tables come first so that deleting never breaks a foreign key
+  QStringList tables;
+  tables << "OnsetSupra" << "PeakSupra" << "CodaSupra" 
+         << "Onset" << "Peak" << "Coda" << "SyllableSupra";
+  
+  for (int t = 0; t < PHONOLOGY_TABLES; t++)  {
+    statements.deletes[t] = QSqlQuery (db);
+    statements.inserts[t] = QSqlQuery (db);
+    
+    if (!statements.deletes[t].prepare ("delete from " + tables[t] + " where wordID == ?"))  {
+      QUERY_ERROR(statements.deletes[t])
+      return false;
     }
-  
-    while (query.next ())  {
-      int syllNum = query.value (0).toInt ();
-      int ind = query.value (1).toInt ();
-      QString phon = query.value (2).toString ();
     
-      while (syllList.size () <= syllNum)  {
-	Syllable syll;
-	syllList.append (syll);
-      }
+    QString placeholders = (t == 6 ? "?, ?, ?" : "?, ?, ?, ?");
     
-      if (x == 0)  {
-	while (syllList[syllNum].onset.size () <= ind)  {
-	  Phoneme p;
-	  syllList[syllNum].onset.append (p);
-	}
-	  
-	syllList[syllNum].onset[ind].name = phon;
-      }
-      
-      else if (x == 1)  {
-	while (syllList[syllNum].peak.size () <= ind)  {
-	  Phoneme p;
-	  syllList[syllNum].peak.append (p);
-	}
-	  
-	syllList[syllNum].peak[ind].name = phon;
-      }
-      
-      else  {
-	while (syllList[syllNum].coda.size () <= ind)  {
-	  Phoneme p;
-	  syllList[syllNum].coda.append (p);
-	}
-	
-	syllList[syllNum].coda[ind].name = phon;
-      }
+    if (!statements.inserts[t].prepare ("insert into " + tables[t] + " values (" + placeholders + ")"))  {
+      QUERY_ERROR(statements.inserts[t])
+      return false;
     }
-    
-    query.finish ();
   }
   
-  // phoneme supras
-  for (int x = 0; x <= 2; x++)  {
-    QString tableName = "OnsetSupra";
-    if (x == 1) tableName = "PeakSupra";
-    if (x == 2) tableName = "CodaSupra";
-    
-    query.prepare ("select syllNum, ind, name from " + tableName + ", Suprasegmental " +
-		    "where id == supraID and wordID == :wID");
-    query.bindValue (":wID", wordID);
-  
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return syllList;
-    }
-  
-    while (query.next ())  {
-      int syllNum = query.value (0).toInt ();
-      int ind = query.value (1).toInt ();
-      QString supra = query.value (2).toString ();
-    
-      while (syllList.size () <= syllNum)  {
-	Syllable syll;
-	syllList.append (syll);
-      }
-    
-      if (x == 0)  {
-        while (syllList[syllNum].onset.size () <= ind)  {
-	  Phoneme p;
-	  syllList[syllNum].onset.append (p);
-        }
-    
-        syllList[syllNum].onset[ind].supras.append (supra);
-      }
-      
-      else if (x == 1)  {
-        while (syllList[syllNum].peak.size () <= ind)  {
-	  Phoneme p;
-	  syllList[syllNum].peak.append (p);
-        }
+  statements.ready = true;
+  return true;
+}
+
+// The first phoneme or supra of a phonology that is not in the dictionary,
+// as a message, or "" if there is none
+QString CDICDatabase::findUnknownName (const QList<Syllable> &phonology,
+                                       const QHash<QString, int> &phonemeIDs,
+                                       const QHash<QString, int> &supraIDs)  {
+  for (int syll = 0; syll < phonology.size (); syll++)  {
+    for (int sup = 0; sup < phonology[syll].supras.size (); sup++)
+      if (!supraIDs.contains (phonology[syll].supras[sup]))
+        return "could not find suprasegmental " + phonology[syll].supras[sup];
     
-        syllList[syllNum].peak[ind].supras.append (supra);	
-      }
+    for (int x = 0; x < 3; x++)  {
+      const QList<Phoneme> &currList = (x == 0 ? phonology[syll].onset :
+                                        (x == 1 ? phonology[syll].peak : 
+                                                  phonology[syll].coda));
       
-      else  {
-        while (syllList[syllNum].coda.size () <= ind)  {
-	  Phoneme p;
-	  syllList[syllNum].coda.append (p);
-        }
-    
-        syllList[syllNum].coda[ind].supras.append (supra);	
+      for (int p = 0; p < currList.size (); p++)  {
+        if (!phonemeIDs.contains (currList[p].name))
+          return "could not find phoneme " + currList[p].name;
+        
+        for (int s = 0; s < currList[p].supras.size (); s++)
+          if (!supraIDs.contains (currList[p].supras[s]))
+            return "could not find suprasegmental " + currList[p].supras[s];
       }
     }
-  
-    query.finish ();
   }
   
-  // syllable supras
-  query.prepare ("select syllNum, name from SyllableSupra, Suprasegmental " +
-		 (QString)"where id == supraID and wordID == :wID");
-  query.bindValue (":wID", wordID);
+  return "";
+}
+     
+// name -> id for Phoneme or Suprasegmental
+QHash<QString, int> CDICDatabase::getNameIDs (QString tableName)  {
+  QHash<QString, int> ids;
+  
+  QSqlQuery query (db);
   
-  if (!query.exec ())  {
+  if (!exec (query, "select id, name from " + tableName))  {
     QUERY_ERROR(query)
-    query.finish ();
-    return syllList;
+    finish (query);
+    return ids;
   }
   
-  while (query.next ())  {
-    int syllNum = query.value (0).toInt ();
-    QString supra = query.value (1).toString ();
-    
-//    DATA_ERROR("Found supra: " + supra)
-    
-    while (syllList.size () <= syllNum)  {
-      Syllable syll;
-      syllList.append (syll);
-    }
-    
-    syllList[syllNum].supras.append (supra);
-  }
+  while (next (query))
+    ids[query.value (1).toString ()] = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
   
-  return syllList;
+  return ids;
 }
 
-int CDICDatabase::getNumberOfWords ()  {
-  if (!db.isOpen ()) return 0;
+// Read from the WordRepresentation cache, or worked out on a miss without
+// writing anything; the cache is only filled where phonologies are written
+QString CDICDatabase::getRepresentation (int wordID)  {
+  if (!db.isOpen ()) return "";
   
   QSqlQuery query (db);
-  query.prepare ("select count(id) from Word");
+  query.prepare ("select representation from WordRepresentation where wordID == :id");
+  query.bindValue (":id", wordID);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
-    return 0;
+    finish (query);
+    return "";
   }
   
-  query.next ();
-  int num = query.value (0).toInt ();
-  query.finish ();
+  if (next (query))  {
+    QString text = query.value (0).toString ();
+    finish (query);
+    return text;
+  }
+  
+  finish (query);
+  
+  return buildRepresentations (QString::number (wordID)).value (wordID, "");
+}
+
+// Recomputes the cached representation of every word
+bool CDICDatabase::rebuildRepresentations ()  {
+  if (!db.isOpen ()) return false;
+  
+  QSqlQuery query (db);
+  
+  if (!exec (query, "delete from WordRepresentation"))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  finish (query);
+  
+  return cacheRepresentations ("select id from Word");
+}
+
+// Caches the representations of the words that have none, after a change to
+// a phoneme or supra has cleared theirs
+bool CDICDatabase::fillRepresentations ()  {
+  if (!db.isOpen ()) return false;
+  
+  bool ownTransaction;
+  if (!joinTransaction (ownTransaction)) return false;
+  
+  bool ok = cacheRepresentations ((QString)"select id from Word where id not in " +
+                                  "(select wordID from WordRepresentation)");
+  
+  return leaveTransaction (ownTransaction, ok);
+}
+
+// Stores the representations of the words whose ids are listed in wordIDs,
+// which is anything that can go inside "id in (...)".  Words with no 
+// phonology get an empty representation.
+bool CDICDatabase::cacheRepresentations (QString wordIDs)  {
+  QHash<int, QString> representations = buildRepresentations (wordIDs);
+  
+  QSqlQuery query (db);
+  
+  if (!exec (query, "select id from Word where id in (" + wordIDs + ")"))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  QVariantList ids;
+  QVariantList texts;
+  
+  while (next (query))  {
+    int id = query.value (0).toInt ();
+    ids.append (id);
+    texts.append (representations.value (id, ""));
+  }
+  
+  finish (query);
+  
+  if (ids.isEmpty ()) return true;
+  
+  query.prepare ("insert or replace into WordRepresentation values (?, ?)");
+  query.addBindValue (ids);
+  query.addBindValue (texts);
+  
+  if (!execBatch (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  finish (query);
+  
+  return true;
+}
+
+// Writes out the given words from one query over all the segment and supra 
+// tables, ordered so that each word's syllables come in sequence, each 
+// syllable's supras before its onset, peak and coda, and each phoneme just
+// before its own supras.
+QHash<int, QString> CDICDatabase::buildRepresentations (QString wordIDs)  {
+  QHash<int, QString> representations;
+  
+  if (!db.isOpen ()) return representations;
+  
+  QString where = " where wordID in (" + wordIDs + ")";
+  QStringList parts;
+  
+  parts << "select wordID, syllNum, 0, 0, supraID, repType, repText " +
+           (QString)"from SyllableSupra join Suprasegmental on supraID == id" + where;
+  
+  QStringList tables;
+  tables << "Onset" << "Peak" << "Coda";
+  
+  for (int t = 0; t < tables.size (); t++)  {
+    QString part = QString::number (t + 1);
+    
+    parts << "select wordID, syllNum, " + part + ", ind, -1, -1, name " +
+             "from " + tables[t] + " join Phoneme on phonemeID == id" + where;
+    parts << "select wordID, syllNum, " + part + ", ind, supraID, repType, repText " +
+             "from " + tables[t] + "Supra join Suprasegmental on supraID == id" + where;
+  }
+  
+  QSqlQuery query (db);
+  query.setForwardOnly (true);
+  
+  if (!exec (query, parts.join (" union all ") + " order by 1, 2, 3, 4, 5"))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return representations;
+  }
+  
+  bool more = next (query);
+  
+  while (more)  {
+    int wordID = query.value (0).toInt ();
+    QMap<int, SyllableText> syllables;
+    
+    while (more && query.value (0).toInt () == wordID)  {
+      SyllableText &syllable = syllables[query.value (1).toInt ()];
+      int part = query.value (2).toInt ();
+      int supraID = query.value (4).toInt ();
+      QPair<int, QString> rep (query.value (5).toInt (), query.value (6).toString ());
+      
+      if (part == 0)
+        syllable.supras.append (rep);
+      
+      else if (supraID < 0)  {
+        syllable.segments[part-1].append (rep.second);
+        syllable.segmentSupras[part-1].append (QList< QPair<int, QString> > ());
+      }
+      
+      else if (!syllable.segmentSupras[part-1].isEmpty ())
+        syllable.segmentSupras[part-1].last ().append (rep);
+      
+      more = next (query);
+    }
+    
+    // like the syllables themselves, the text stops at the first empty one
+    QString text = "";
+    
+    for (int syllNum = 0; syllables.contains (syllNum); syllNum++)  {
+      QString syllText = representSyllable (syllables[syllNum], syllNum);
+      
+      if (syllText == "" || syllText == ".")
+        break;
+      
+      text += syllText;
+    }
+    
+    representations[wordID] = text;
+  }
+  
+  finish (query);
+  
+  return representations;
+}
+
+QString CDICDatabase::representSyllable (SyllableText &syllable, int syllNum)  {
+  QString syllText = "";
+  
+  if (syllNum > 0)
+    syllText += ".";
+  
+  // before supra
+  for (int s = 0; s < syllable.supras.size (); s++)
+    if (syllable.supras[s].first == TYPE_BEFORE)  {
+      syllText += syllable.supras[s].second;
+      break;
+    }
+  
+  for (int part = 0; part < 3; part++)  {
+    QStringList tempList = syllable.segments[part];
+    
+    // peak-based syllable supra
+    if (part == 1)
+      for (int s = 0; s < syllable.supras.size (); s++)  {
+        int rty = syllable.supras[s].first;
+        
+        if (rty == TYPE_DOUBLED)  {
+          int l = tempList.length ();
+          for (int x = 0; x < l; x++)
+            tempList.append (tempList[x]);
+        }
+        
+        else if (rty < TYPE_BEFORE)  {
+          for (int x = 0; x < tempList.length (); x++)
+            tempList[x] = applyDiacritic (rty, tempList[x]);
+        }
+        
+        else continue;
+        
+        break;
+      }
+    
+    // phoneme supras
+    for (int ind = 0; ind < syllable.segmentSupras[part].size (); ind++)  {
+      const QList< QPair<int, QString> > &supras = syllable.segmentSupras[part][ind];
+      
+      for (int s = 0; s < supras.size (); s++)  {
+        int rty = supras[s].first;
+        QString rtx = supras[s].second;
+        
+        if (rty == TYPE_BEFORE) tempList[ind].prepend (rtx);
+        else if (rty == TYPE_AFTER) tempList[ind].append (rtx);
+        else if (rty == TYPE_DOUBLED) tempList[ind].append (tempList[ind]);
+        else tempList[ind] = applyDiacritic (rty, tempList[ind]);
+      }
+    }
+    
+    syllText += tempList.join ("");
+  }
+  
+  // after supra
+  for (int s = 0; s < syllable.supras.size (); s++)
+    if (syllable.supras[s].first == TYPE_AFTER)  {
+      syllText += syllable.supras[s].second;
+      break;
+    }
+  
+  return syllText;
+}
+
+QList<Syllable> CDICDatabase::getPhonology (int wordID)  {
+  if (!db.isOpen ()) return QList<Syllable> ();
+  
+  PhonologyIterator phonologies (db, QString::number (wordID));
+  
+  if (!phonologies.next ())
+    return QList<Syllable> ();
+  
+  return phonologies.phonology ();
+}
+
+// Iterators over the phonologies of all or some words, in order of id.  The
+// caller deletes them, and should not write phonologies while reading.
+PhonologyIterator *CDICDatabase::getPhonologies ()  {
+  return new PhonologyIterator (db);
+}
+
+PhonologyIterator *CDICDatabase::getPhonologies (QList<int> wordIDs)  {
+  QStringList idList;
+  for (int x = 0; x < wordIDs.size (); x++)
+    idList.append (QString::number (wordIDs[x]));
+  
+  // an empty list must not turn into every word
+  if (idList.isEmpty ())
+    idList.append ("null");
+  
+  return new PhonologyIterator (db, idList.join (", "));
+}
+
+int CDICDatabase::getNumberOfWords ()  {
+  if (!db.isOpen ()) return 0;
+  
+  QSqlQuery query (db);
+  query.prepare ("select count(id) from Word");
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return 0;
+  }
+  
+  next (query);
+  int num = query.value (0).toInt ();
+  finish (query);
   return num;
 }
 
@@ -2119,10 +2441,10 @@ void CDICDatabase::setDefinition (QString def, int wordID)  {
   query.bindValue (":def", def);
   query.bindValue (":id", wordID);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
   return;
 }
 
@@ -2133,14 +2455,14 @@ QString CDICDatabase::getDefinition (int wordID)  {
   query.prepare ("select definition from Word where id == :id");
   query.bindValue (":id", wordID);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
   QString def = "";
-  if (query.next ())
+  if (next (query))
     def = query.value (0).toString ();
   
   return def;
@@ -2154,13 +2476,13 @@ QMap<int, QString> CDICDatabase::getWordsAndIDs ()  {
   QSqlQuery query (db);
   query.prepare ("select id, name, classlist from WordPageTable");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return map;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     QString name = query.value (1).toString ();
     QString classlist = query.value (2).toString ();
     
@@ -2169,11 +2491,46 @@ QMap<int, QString> CDICDatabase::getWordsAndIDs ()  {
     else map[query.value (0).toInt ()] = name + " (" + classlist + ")";
   }
   
-  query.finish ();
+  finish (query);
   
   return map;
 }
 
+// The word index leaves ignored characters out, so the words with any of the
+// characters that change are indexed again
+void CDICDatabase::setIgnoredCharacters (QString ignored)  {
+  if (!db.isOpen ()) return;
+  
+  QString old = getValue (IGNORED_CHARACTERS);
+  QString changed;
+  
+  for (int x = 0; x < old.size (); x++)
+    if (!ignored.contains (old[x]))
+      changed.append (old[x]);
+  
+  for (int x = 0; x < ignored.size (); x++)
+    if (!old.contains (ignored[x]))
+      changed.append (ignored[x]);
+  
+  db.transaction ();
+  setValue (IGNORED_CHARACTERS, ignored);
+  
+  QMap<int, QString> words = getWordNames ();
+  QMap<int, QString> affected;
+  
+  for (QMap<int, QString>::const_iterator w = words.constBegin ();
+       w != words.constEnd (); w++)
+    for (int x = 0; x < changed.size (); x++)
+      if (w.value ().contains (changed[x]))  {
+        affected.insert (w.key (), w.value ());
+        break;
+      }
+  
+  if (indexWords (affected))
+    commit ();
+  else rollback ();
+}
+
 void CDICDatabase::setMorphemeList (QList<int> idList)  {
   if (!db.isOpen ()) return;
   
@@ -2190,27 +2547,27 @@ void CDICDatabase::setMorphemeList (QList<int> idList)  {
   for (int x = 0; x < idList.size (); x++)
     query.bindValue (x, idList[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     db.rollback ();
     return;
   }
   
-  query.finish ();
+  finish (query);
 
   query.prepare ("delete from Word where id in (" + placeholders.join (", ") + ")");
   for (int x = 0; x < idList.size (); x++)
     query.bindValue (x, idList[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     db.rollback ();
     return;
   }
   
-  query.finish ();
+  finish (query);
   
   QStringList tableNames = QStringList () << "Onset" << "Peak" << "Coda" 
                            << "SyllableSupra" << "OnsetSupra" << "PeakSupra" 
@@ -2221,14 +2578,14 @@ void CDICDatabase::setMorphemeList (QList<int> idList)  {
     for (int x = 0; x < idList.size (); x++)
       query.bindValue (x, idList[x]);
   
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
+      finish (query);
       db.rollback ();
       return;
     }
   
-    query.finish ();
+    finish (query);
   }
   
   db.commit ();
@@ -2249,13 +2606,13 @@ QList< QList<QStringList> > CDICDatabase::getPhonotacticSequenceList (int loc)
   QSqlQuery query (db);
   query.prepare ("select id, ind, class from " + tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return list;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     int id = query.value (0).toInt ();
     int index = query.value (1).toInt ();
     QString className = query.value (2).toString ();
@@ -2269,7 +2626,7 @@ QList< QList<QStringList> > CDICDatabase::getPhonotacticSequenceList (int loc)
     list[id][index].append (className);
   }
   
-  query.finish ();
+  finish (query);
   
   return list;
 }
@@ -2288,13 +2645,13 @@ QList<Suprasegmental> CDICDatabase::getDiacriticSupras ()  {
   QSqlQuery query (db);
   query.prepare ("select id, name, domain, spellType from Suprasegmental");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return supraList;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     int spellType = query.value (3).toInt ();
     
     if (spellType >= TYPE_BEFORE) continue;
@@ -2310,19 +2667,19 @@ QList<Suprasegmental> CDICDatabase::getDiacriticSupras ()  {
                     "where phonemeID == id and supraID == :id");
     pquery.bindValue (":id", query.value (0).toInt ());
     
-    if (!pquery.exec ())  {
+    if (!exec (pquery))  {
       QUERY_ERROR(pquery)
-      pquery.finish ();
+      finish (pquery);
       continue;
     }
     
     QStringList applies;
-    while (pquery.next ())
+    while (next (pquery))
       applies.append (pquery.value (0).toString ());
     
     supraList[spellType].applicablePhonemes = applies;
     
-    pquery.finish ();
+    finish (pquery);
   }
   
   return supraList;
@@ -2338,13 +2695,13 @@ QList<Suprasegmental> CDICDatabase::getBeforeSupras ()  {
                  (QString)"where spellType == :t");
   query.bindValue (":t", TYPE_BEFORE);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return supraList;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     Suprasegmental s;
     s.name = query.value (1).toString ();
     s.domain = query.value (2).toInt ();
@@ -2360,23 +2717,23 @@ QList<Suprasegmental> CDICDatabase::getBeforeSupras ()  {
                     "where phonemeID == id and supraID == :id");
     pquery.bindValue (":id", query.value (0).toInt ());
     
-    if (!pquery.exec ())  {
+    if (!exec (pquery))  {
       QUERY_ERROR(pquery)
-      pquery.finish ();
+      finish (pquery);
       continue;
     }
     
     QStringList applies;
-    while (pquery.next ())
+    while (next (pquery))
       applies.append (pquery.value (0).toString ());
     
     s.applicablePhonemes = applies;
     supraList.append (s);
     
-    pquery.finish ();
+    finish (pquery);
   }
   
-  query.finish ();
+  finish (query);
   
   return supraList;
 }
@@ -2391,13 +2748,13 @@ QList<Suprasegmental> CDICDatabase::getAfterSupras ()  {
                  (QString)"where spellType == :t");
   query.bindValue (":t", TYPE_AFTER);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return supraList;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     Suprasegmental s;
     s.name = query.value (1).toString ();
     s.domain = query.value (2).toInt ();
@@ -2413,23 +2770,23 @@ QList<Suprasegmental> CDICDatabase::getAfterSupras ()  {
                     "where phonemeID == id and supraID == :id");
     pquery.bindValue (":id", query.value (0).toInt ());
     
-    if (!pquery.exec ())  {
+    if (!exec (pquery))  {
       QUERY_ERROR(pquery)
-      pquery.finish ();
+      finish (pquery);
       continue;
     }
     
     QStringList applies;
-    while (pquery.next ())
+    while (next (pquery))
       applies.append (pquery.value (0).toString ());
     
     s.applicablePhonemes = applies;
     supraList.append (s);
     
-    pquery.finish ();
+    finish (pquery);
   }
   
-  query.finish ();
+  finish (query);
   
   return supraList;
 }
@@ -2444,13 +2801,13 @@ QList<Suprasegmental> CDICDatabase::getDoubledSupras ()  {
                  "where spellType == :t");
   query.bindValue (":t", TYPE_DOUBLED);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return supraList;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     Suprasegmental s;
     s.name = query.value (1).toString ();
     s.domain = query.value (2).toInt ();
@@ -2465,23 +2822,23 @@ QList<Suprasegmental> CDICDatabase::getDoubledSupras ()  {
                     "where phonemeID == id and supraID == :id");
     pquery.bindValue (":id", query.value (0).toInt ());
     
-    if (!pquery.exec ())  {
+    if (!exec (pquery))  {
       QUERY_ERROR(pquery)
-      pquery.finish ();
+      finish (pquery);
       continue;
     }
     
     QStringList applies;
-    while (pquery.next ())
+    while (next (pquery))
       applies.append (pquery.value (0).toString ());
       
     s.applicablePhonemes = applies;
     supraList.append (s);
     
-    pquery.finish ();
+    finish (pquery);
   }
   
-  query.finish ();
+  finish (query);
   return supraList;
 }
 
@@ -2494,20 +2851,20 @@ QMap<QString, QStringList> CDICDatabase::getPhonemesAndSpellings ()  {
   query.prepare ("select name, spelling from Phoneme, PhonemeSpelling " +
                  (QString)"where phonemeID == id");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return map;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     if (!map.contains (query.value (0).toString ()))
       map[query.value (0).toString ()] = QStringList ();
     
     map[query.value (0).toString ()].append (query.value (1).toString ());
   }
   
-  query.finish ();
+  finish (query);
   
   return map;
 }
@@ -2518,21 +2875,100 @@ QList<int> CDICDatabase::getAllWordIDs ()  {
   QSqlQuery query (db);
   query.prepare ("select id from Word");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return QList<int> ();
   }
   
   QList<int> idList;
-  while (query.next ())
+  while (next (query))
     idList.append (query.value (0).toInt ());
   
-  query.finish ();
+  finish (query);
   
   return idList;
 }
 
+QMap<int, QString> CDICDatabase::getWordNames ()  {
+  if (!db.isOpen ()) return QMap<int, QString> ();
+  
+  QSqlQuery query (db);
+  query.prepare ("select id, name from Word");
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return QMap<int, QString> ();
+  }
+  
+  QMap<int, QString> map;
+  while (next (query))
+    map[query.value (0).toInt ()] = query.value (1).toString ();
+  
+  finish (query);
+  
+  return map;
+}
+
+// Words whose names contain any of the given spellings, with or without a
+// diacritic, looked up through the WordGram index.  Names and spellings are
+// compared as the parser reads them, without spaces or ignored characters.
+QMap<int, QString> CDICDatabase::getWordsContaining (QStringList spellings)  {
+  if (!db.isOpen ()) return QMap<int, QString> ();
+  
+  QString ignored = getValue (IGNORED_CHARACTERS);
+  QSet<QString> searches;
+  
+  for (int x = 0; x < spellings.size (); x++)  {
+    QString spelling = spellings[x].split ('|')[0];
+    if (indexedName (spelling, ignored).isEmpty ()) continue;
+    
+    searches.insert (indexedName (spelling, ignored));
+    for (int d = TYPE_ACUTE; d < TYPE_BEFORE; d++)
+      searches.insert (indexedName (applyDiacritic (d, spelling), ignored));
+  }
+  
+  QStringList searchList = searches.toList ();
+  QMap<int, QString> map;
+  QSqlQuery query (db);
+  
+  for (int x = 0; x < searchList.size (); x++)  {
+    QString search = searchList[x];
+    
+    // every substring of up to three characters begins some gram
+    if (firstGram (search) == search)  {
+      query.prepare ((QString)"select distinct id, name from Word, WordGram " +
+                     "where id == wordID and gram >= :low and gram < :high");
+      query.bindValue (":low", search);
+      query.bindValue (":high", prefixEnd (search));
+    }
+    
+    else  {
+      query.prepare ((QString)"select distinct id, name from Word, WordGram " +
+                     "where id == wordID and gram == :gram");
+      query.bindValue (":gram", firstGram (search));
+    }
+    
+    if (!exec (query))  {
+      QUERY_ERROR(query)
+      finish (query);
+      return map;
+    }
+    
+    while (next (query))  {
+      QString name = query.value (1).toString ();
+      
+      if (indexedName (name, ignored).contains (search))
+        map[query.value (0).toInt ()] = name;
+    }
+    
+    finish (query);
+  }
+  
+  return map;
+}
+
 QString CDICDatabase::getWordName (int id)  {
   if (!db.isOpen ()) return "";
   
@@ -2540,17 +2976,17 @@ QString CDICDatabase::getWordName (int id)  {
   query.prepare ("select name from Word where id == :id");
   query.bindValue (":id", id);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
   QString name = "";
-  if (query.next ())
+  if (next (query))
     name = query.value (0).toString ();
   
-  query.finish ();
+  finish (query);
   
   return name;
 }
@@ -2571,86 +3007,71 @@ QStringList CDICDatabase::getPhonemesOfClass (QStringList classNames)  {
   for (int x = 0; x < classNames.size (); x++)
     query.bindValue (x, classNames[x]);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return list;
   }
   
-  while (query.next ())
+  while (next (query))
     list.append (query.value (0).toString ());
   
-  query.finish ();
+  finish (query);
   
   return list;
 }
 
+// Returns the cached grammar if none of the tables it is built from have
+// changed since it was cached, and builds it otherwise.  A miss is not
+// written back, since loading the analyzer only reads; see cacheParsingGrammar.
 QList<Rule> CDICDatabase::getParsingGrammar ()  {
-  QList<Rule> ruleList;
+  if (!db.isOpen ()) return QList<Rule> ();
   
-  // put supras into relevant lists
-  QList<Suprasegmental> diacriticSupraList;
-  QList<Suprasegmental> beforePhonSupraList;
-  QList<Suprasegmental> beforeSyllSupraList;
-  QList<Suprasegmental> afterPhonSupraList;
-  QList<Suprasegmental> afterSyllSupraList;
-  QList<Suprasegmental> doubledSupraList;
+  QString hash = getGrammarHash ();
   
-  QSqlQuery query (db);
-  query.prepare ("select id, name, domain, spellType, spellText from Suprasegmental");
+  if (hash != "" && getValue (GRAMMAR_HASH) == hash)  {
+    QList<Rule> ruleList = loadGrammarCache ();
+    
+    if (!ruleList.isEmpty ())
+      return ruleList;
+  }
   
-  if (!query.exec ())  {
-    QUERY_ERROR(query)
-    query.finish ();
+  return buildParsingGrammar ();
+}
+
+// Rebuilds the grammar cache if it is out of date, for callers about to
+// write anyway, before a reparse
+bool CDICDatabase::cacheParsingGrammar ()  {
+  if (!db.isOpen ()) return false;
+  
+  QString hash = getGrammarHash ();
+  
+  if (hash == "") return false;
+  if (getValue (GRAMMAR_HASH) == hash) return true;
+  
+  QList<Rule> ruleList = buildParsingGrammar ();
+  
+  bool ownTransaction;
+  if (!joinTransaction (ownTransaction)) return false;
+  
+  bool ok = saveGrammarCache (ruleList);
+  
+  if (ok)
+    setValue (GRAMMAR_HASH, hash);
+  
+  return leaveTransaction (ownTransaction, ok);
+}
+
+// Builds the grammar from scratch, bypassing the cache
+QList<Rule> CDICDatabase::buildParsingGrammar ()  {
+  QList<Rule> ruleList;
+  
+  GrammarSupras supras;
+  
+  if (!getGrammarSupras (supras))
     return ruleList;
-  }
   
-  while (query.next ())  {
-    Suprasegmental s;
-    s.name = query.value (1).toString ();
-    s.domain = query.value (2).toInt ();
-    s.type = query.value (3).toInt ();
-    s.text = query.value (4).toString ();
-    s.applicablePhonemes = QStringList ();
-    
-    QSqlQuery phonQuery (db);
-    phonQuery.prepare ((QString)"select name from Phoneme, SupraApplies " +
-                       "where supraID == :id and phonemeID == Phoneme.id");
-    phonQuery.bindValue (":id", query.value (0).toInt ());
-    
-    if (!phonQuery.exec ())  {
-      QUERY_ERROR(phonQuery)
-      phonQuery.finish ();
-      continue;
-    }
-    
-    while (phonQuery.next ())
-      s.applicablePhonemes.append (phonQuery.value (0).toString ());
-    
-    phonQuery.finish ();
-    
-    if (s.domain == SUPRA_DOMAIN_PHON)  {
-      if (s.type < TYPE_BEFORE)
-        diacriticSupraList.append (s);
-      else if (s.type == TYPE_BEFORE)
-        beforePhonSupraList.append (s);
-      else if (s.type == TYPE_AFTER)
-        afterPhonSupraList.append (s);
-      else doubledSupraList.append (s);
-    }
-    
-    else  {
-      if (s.type < TYPE_BEFORE)
-        diacriticSupraList.append (s);
-      else if (s.type == TYPE_BEFORE)
-        beforeSyllSupraList.append (s);
-      else if (s.type == TYPE_AFTER)
-        afterSyllSupraList.append (s);
-      else doubledSupraList.append (s);
-    }
-  }
- 
-  query.finish ();
+  QSqlQuery query (db);
   
   // add basic rules
   Rule r1;
@@ -2673,7 +3094,7 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
   r4.rhs = QStringList () << "Onset" << "Peak" << "Coda";
   ruleList.append (r4);
   
-  if (getValue (ONSET_REQUIRED) != "true")  {
+  if (!getFlag (ONSET_REQUIRED))  {
     Rule r5;
     r5.lhs = "Syll";
     r5.rhs = QStringList ("Peak");
@@ -2686,8 +3107,8 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
   }
   
   // add syllable before/after supra rules
-  for (int s = 0; s < beforeSyllSupraList.size (); s++)  {
-    QString chars = beforeSyllSupraList[s].text;
+  for (int s = 0; s < supras.beforeSyll.size (); s++)  {
+    QString chars = supras.beforeSyll[s].text;
     QStringList splitChars;
     for (int c = 0; c < chars.size (); c++)
       splitChars.append ("Char" + chars[c]);
@@ -2699,8 +3120,8 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
     ruleList.append (rule);
   }
   
-  for (int s = 0; s < afterSyllSupraList.size (); s++)  {
-    QString chars = afterSyllSupraList[s].text;
+  for (int s = 0; s < supras.afterSyll.size (); s++)  {
+    QString chars = supras.afterSyll[s].text;
     QStringList splitChars = QStringList ("Syll");
     for (int c = 0; c < chars.size (); c++)
       splitChars.append ("Char" + chars[c]);
@@ -2735,13 +3156,13 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
     query.prepare ("select id, ind, name from NaturalClassPhon, " + tableName +
                    " where class == bundleID");
     
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
+      finish (query);
       continue;
     }
     
-    while (query.next ())  {
+    while (next (query))  {
       int id = query.value (0).toInt ();
       int ind = query.value (1).toInt ();
       QString className = query.value (2).toString ();
@@ -2754,7 +3175,7 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
       sequences[id][ind].append (className);
     }
     
-    query.finish ();
+    finish (query);
     
     for (int x = 0; x < sequences.size (); x++)  {
       QList<int> currentCombo;
@@ -2774,7 +3195,7 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
           ruleList.append (rule);
         }
         
-        int c = currentCombo.size () + 1;
+        int c = currentCombo.size () - 1;
         while (c >= 0)  {
           if (currentCombo[c] < sequences[x][c].size () - 1)  {
             currentCombo[c]++;
@@ -2795,130 +3216,249 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
   query.prepare ((QString)"select name, class from PhonClassList, Phoneme " +
                  "where PhonClassList.id == Phoneme.id");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return ruleList;
   }
   
-  while (query.next ())  {
+  while (next (query))  {
     Rule rule;
     rule.lhs = "Class" + query.value (1).toString ();
     rule.rhs = QStringList ("Phon" + query.value (0).toString ());
     ruleList.append (rule);
   }
   
-  query.finish ();
+  finish (query);
   
   // add phoneme rules
   query.prepare ("select name from Phoneme");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return ruleList;
   }
   
-  while (query.next ())  {
-    QString phoneme = query.value (0).toString ();
-    
-    for (int x = 0; x < beforePhonSupraList.size (); x++)
-      if (beforePhonSupraList[x].applicablePhonemes.contains (phoneme))  {
-        QStringList rhs;
-        for (int c = 0; c < beforePhonSupraList[x].text.size (); c++)
-          rhs.append ("Char" + beforePhonSupraList[x].text[c]);
-      
-        Rule rule;
-        rule.lhs = "Phon" + phoneme;
-        rule.rhs = rhs;
-        rule.rhs.append ("Phon" + phoneme);
-        ruleList.append (rule);
-      }
-    
-    for (int x = 0; x < afterPhonSupraList.size (); x++)
-      if (afterPhonSupraList[x].applicablePhonemes.contains (phoneme))  {
-        QStringList rhs = QStringList ("Phon" + phoneme);
-        for (int c = 0; c < afterPhonSupraList[x].text.size (); c++)
-          rhs.append ("Char" + afterPhonSupraList[x].text[c]);
-      
-        Rule rule;
-        rule.lhs = "Phon" + phoneme;
-        rule.rhs = rhs;
-        ruleList.append (rule);
-      }
-  }
+  while (next (query))
+    addPhonemeRules (ruleList, supras, query.value (0).toString ());
   
-  query.finish ();
+  finish (query);
   
   query.prepare ("select name, spelling from Phoneme, PhonemeSpelling " +
                  (QString)"where id == phonemeID");
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return ruleList;
   }
   
-  while (query.next ())  {
-    QString phoneme = query.value (0).toString ();
-    QString spelling = query.value (1).toString ();
-    QString context = "";
-    
-    if (spelling.contains ("|"))  {
-      context = spelling.split ('|')[1];
-      spelling = spelling.split ('|')[0];
-    }
-    
-    for (int x = 0; x < diacriticSupraList.size (); x++)
-      if (diacriticSupraList[x].applicablePhonemes.contains (phoneme) ||
-          (diacriticSupraList[x].domain == SUPRA_DOMAIN_SYLL &&
-           plainChars.contains (spelling)))  {
-        QString diacriticChars = applyDiacritic (diacriticSupraList[x].type, spelling);
-        QStringList rhs;
-        for (int c = 0; c < diacriticChars.size (); c++)
-          rhs.append ("Char" + diacriticChars[c]);
-        
-        Rule rule;
-        rule.lhs = "Phon" + phoneme;
-        rule.rhs = rhs;
-        rule.context = context;
-        ruleList.append (rule);
-      }
-      
-    for (int x = 0; x < doubledSupraList.size (); x++)
-      if (doubledSupraList[x].applicablePhonemes.contains (phoneme) ||
-          doubledSupraList[x].domain == SUPRA_DOMAIN_SYLL)  {
-        QStringList rhs;
-        for (int c = 0; c < spelling.size (); c++)
-          rhs.append ("Char" + spelling[c]);
-        for (int c = 0; c < spelling.size (); c++)
-          rhs.append ("Char" + spelling[c]);
-        
-        Rule rule;
-        rule.lhs = "Phon" + phoneme;
-        rule.rhs = rhs;
-        rule.context = context;
-        ruleList.append (rule);
-      }
-      
-    QStringList rhs;
-    
-    for (int x = 0; x < spelling.size (); x++)
-      rhs.append ("Char" + spelling[x]);
-      
-    Rule rule;
-    rule.lhs = "Phon" + phoneme;
-    rule.rhs = rhs;
-    rule.context = context;
-    ruleList.append (rule);
+  while (next (query))
+    addSpellingRules (ruleList, supras, query.value (0).toString (),
+                      query.value (1).toString ());
+  
+  finish (query);
+  
+  addCharacterRules (ruleList);
+  
+  return ruleList;
+}
+
+// Rules for a single phoneme, for patching a parser's grammar after its
+// spellings change; see EarleyParser::replaceRules.
+QList<Rule> CDICDatabase::getPhonemeGrammar (QString phoneme)  {
+  QList<Rule> ruleList;
+  
+  if (!db.isOpen ()) return ruleList;
+  
+  GrammarSupras supras;
+  
+  if (!getGrammarSupras (supras, phoneme))
+    return ruleList;
+  
+  addPhonemeRules (ruleList, supras, phoneme);
+  
+  QSqlQuery query (db);
+  query.prepare ((QString)"select spelling from Phoneme, PhonemeSpelling " +
+                 "where id == phonemeID and name == :name");
+  query.bindValue (":name", phoneme);
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return ruleList;
   }
   
-  query.finish ();
+  while (next (query))
+    addSpellingRules (ruleList, supras, phoneme, query.value (0).toString ());
+  
+  finish (query);
+  
+  addCharacterRules (ruleList);
+  
+  return ruleList;
+}
+
+// Sorts the supras by their effect on the grammar.  With a phoneme given,
+// only its own supra applications are loaded.
+bool CDICDatabase::getGrammarSupras (GrammarSupras &supras, QString phoneme)  {
+  QSqlQuery query (db);
   
-  // add character rules
-  QString addedCharacters = "";
+  if (phoneme.isNull ())
+    query.prepare ((QString)"select Suprasegmental.name, Phoneme.name " +
+                   "from Suprasegmental, SupraApplies, Phoneme " +
+                   "where supraID == Suprasegmental.id and phonemeID == Phoneme.id");
   
-  for (int x = 0; x < ruleList.size (); x++)
+  else  {
+    query.prepare ((QString)"select Suprasegmental.name, Phoneme.name " +
+                   "from Suprasegmental, SupraApplies, Phoneme " +
+                   "where supraID == Suprasegmental.id and phonemeID == Phoneme.id " +
+                   "and Phoneme.name == :name");
+    query.bindValue (":name", phoneme);
+  }
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  while (next (query))
+    supras.appliesTo[query.value (0).toString ()].insert (query.value (1).toString ());
+  
+  finish (query);
+  
+  query.prepare ("select name, domain, spellType, spellText from Suprasegmental");
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  while (next (query))  {
+    Suprasegmental s;
+    s.name = query.value (0).toString ();
+    s.domain = query.value (1).toInt ();
+    s.type = query.value (2).toInt ();
+    s.text = query.value (3).toString ();
+    
+    if (s.domain == SUPRA_DOMAIN_PHON)  {
+      if (s.type < TYPE_BEFORE)
+        supras.diacritic.append (s);
+      else if (s.type == TYPE_BEFORE)
+        supras.beforePhon.append (s);
+      else if (s.type == TYPE_AFTER)
+        supras.afterPhon.append (s);
+      else supras.doubled.append (s);
+    }
+    
+    else  {
+      if (s.type < TYPE_BEFORE)
+        supras.diacritic.append (s);
+      else if (s.type == TYPE_BEFORE)
+        supras.beforeSyll.append (s);
+      else if (s.type == TYPE_AFTER)
+        supras.afterSyll.append (s);
+      else supras.doubled.append (s);
+    }
+  }
+ 
+  finish (query);
+  
+  return true;
+}
+
+// Before and after supras of a phoneme
+void CDICDatabase::addPhonemeRules (QList<Rule> &ruleList, GrammarSupras &supras,
+                                    QString phoneme)  {
+  for (int x = 0; x < supras.beforePhon.size (); x++)
+    if (supras.appliesTo.value (supras.beforePhon[x].name).contains (phoneme))  {
+      QStringList rhs;
+      for (int c = 0; c < supras.beforePhon[x].text.size (); c++)
+        rhs.append ("Char" + supras.beforePhon[x].text[c]);
+    
+      Rule rule;
+      rule.lhs = "Phon" + phoneme;
+      rule.rhs = rhs;
+      rule.rhs.append ("Phon" + phoneme);
+      ruleList.append (rule);
+    }
+  
+  for (int x = 0; x < supras.afterPhon.size (); x++)
+    if (supras.appliesTo.value (supras.afterPhon[x].name).contains (phoneme))  {
+      QStringList rhs = QStringList ("Phon" + phoneme);
+      for (int c = 0; c < supras.afterPhon[x].text.size (); c++)
+        rhs.append ("Char" + supras.afterPhon[x].text[c]);
+    
+      Rule rule;
+      rule.lhs = "Phon" + phoneme;
+      rule.rhs = rhs;
+      ruleList.append (rule);
+    }
+}
+
+// One spelling of a phoneme, with its diacritic and doubled forms
+void CDICDatabase::addSpellingRules (QList<Rule> &ruleList, GrammarSupras &supras,
+                                     QString phoneme, QString spelling)  {
+  QString context = "";
+  
+  if (spelling.contains ("|"))  {
+    context = spelling.split ('|')[1];
+    spelling = spelling.split ('|')[0];
+  }
+  
+  for (int x = 0; x < supras.diacritic.size (); x++)
+    if (supras.appliesTo.value (supras.diacritic[x].name).contains (phoneme) ||
+        (supras.diacritic[x].domain == SUPRA_DOMAIN_SYLL &&
+         plainChars.contains (spelling)))  {
+      QString diacriticChars = applyDiacritic (supras.diacritic[x].type, spelling);
+      QStringList rhs;
+      for (int c = 0; c < diacriticChars.size (); c++)
+        rhs.append ("Char" + diacriticChars[c]);
+      
+      Rule rule;
+      rule.lhs = "Phon" + phoneme;
+      rule.rhs = rhs;
+      rule.context = context;
+      ruleList.append (rule);
+    }
+    
+  for (int x = 0; x < supras.doubled.size (); x++)
+    if (supras.appliesTo.value (supras.doubled[x].name).contains (phoneme) ||
+        supras.doubled[x].domain == SUPRA_DOMAIN_SYLL)  {
+      QStringList rhs;
+      for (int c = 0; c < spelling.size (); c++)
+        rhs.append ("Char" + spelling[c]);
+      for (int c = 0; c < spelling.size (); c++)
+        rhs.append ("Char" + spelling[c]);
+      
+      Rule rule;
+      rule.lhs = "Phon" + phoneme;
+      rule.rhs = rhs;
+      rule.context = context;
+      ruleList.append (rule);
+    }
+    
+  QStringList rhs;
+  
+  for (int x = 0; x < spelling.size (); x++)
+    rhs.append ("Char" + spelling[x]);
+    
+  Rule rule;
+  rule.lhs = "Phon" + phoneme;
+  rule.rhs = rhs;
+  rule.context = context;
+  ruleList.append (rule);
+}
+
+// One terminal rule for every character used in the rules so far
+void CDICDatabase::addCharacterRules (QList<Rule> &ruleList)  {
+  QSet<QChar> addedCharacters;
+  int rules = ruleList.size ();
+  
+  for (int x = 0; x < rules; x++)
     for (int r = 0; r < ruleList[x].rhs.size (); r++)
       if (ruleList[x].rhs[r].startsWith ("Char") && 
           !addedCharacters.contains (ruleList[x].rhs[r][4]))  {
@@ -2926,12 +3466,122 @@ QList<Rule> CDICDatabase::getParsingGrammar ()  {
         rule.lhs = ruleList[x].rhs[r];
         rule.rhs = QStringList ("\"" + ruleList[x].rhs[r][4] + "\"");
         ruleList.append (rule);
-        addedCharacters.append (ruleList[x].rhs[r][4]);
+        addedCharacters.insert (ruleList[x].rhs[r][4]);
       }
+}
+
+// Hashes everything the parsing grammar depends on
+QString CDICDatabase::getGrammarHash ()  {
+  if (!db.isOpen ()) return "";
+  
+  QStringList statements;
+  statements << "select id, name from Phoneme order by id"
+             << "select phonemeID, spelling from PhonemeSpelling order by phonemeID, spelling"
+             << "select id, domain, spellType, spellText from Suprasegmental order by id"
+             << "select supraID, phonemeID from SupraApplies order by supraID, phonemeID"
+             << "select id, ind, class from LegalOnset order by id, ind, class"
+             << "select id, ind, class from LegalPeak order by id, ind, class"
+             << "select id, ind, class from LegalCoda order by id, ind, class"
+             << "select bundleID, name from NaturalClassPhon order by bundleID"
+             << "select id, feature, value from FeatureBundlePhon order by id, feature"
+             << "select phonemeID, feature, value from PhonemeFeatureSet order by phonemeID, feature";
+  
+  QCryptographicHash hash (QCryptographicHash::Sha1);
+  QSqlQuery query (db);
+  
+  for (int x = 0; x < statements.size (); x++)  {
+    if (!exec (query, statements[x]))  {
+      QUERY_ERROR(query)
+      finish (query);
+      return "";
+    }
+    
+    int columns = query.record ().count ();
+    
+    while (next (query))  {
+      for (int c = 0; c < columns; c++)  {
+        hash.addData (query.value (c).toString ().toUtf8 ());
+        hash.addData ("\x1f", 1);
+      }
+      
+      hash.addData ("\x1e", 1);
+    }
+    
+    hash.addData ("\x1d", 1);
+    finish (query);
+  }
+  
+  hash.addData (getValue (ONSET_REQUIRED).toUtf8 ());
+  
+  return hash.result ().toHex ();
+}
+
+QList<Rule> CDICDatabase::loadGrammarCache ()  {
+  QList<Rule> ruleList;
+  
+  QSqlQuery query (db);
+  query.prepare ("select lhs, rhs, context from GrammarRule order by id");
+  
+  if (!exec (query))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return ruleList;
+  }
+  
+  while (next (query))  {
+    Rule rule;
+    rule.lhs = query.value (0).toString ();
+    rule.rhs = query.value (1).toString ().split (RHS_SEPARATOR);
+    rule.context = query.value (2).toString ();
+    ruleList.append (rule);
+  }
+  
+  finish (query);
   
   return ruleList;
 }
 
+bool CDICDatabase::saveGrammarCache (QList<Rule> ruleList)  {
+  QSqlQuery query (db);
+  
+  if (!exec (query, "delete from GrammarRule"))  {
+    QUERY_ERROR(query)
+    finish (query);
+    return false;
+  }
+  
+  finish (query);
+  
+  if (ruleList.isEmpty ()) return true;
+  
+  QVariantList ids;
+  QVariantList lhs;
+  QVariantList rhs;
+  QVariantList contexts;
+  
+  for (int x = 0; x < ruleList.size (); x++)  {
+    ids.append (x);
+    lhs.append (ruleList[x].lhs);
+    rhs.append (ruleList[x].rhs.join (RHS_SEPARATOR));
+    contexts.append (ruleList[x].context);
+  }
+  
+  query.prepare ("insert into GrammarRule (id, lhs, rhs, context) values (?, ?, ?, ?)");
+  query.addBindValue (ids);
+  query.addBindValue (lhs);
+  query.addBindValue (rhs);
+  query.addBindValue (contexts);
+  
+  bool ok = execBatch (query);
+  
+  if (!ok)
+    QUERY_ERROR(query)
+  
+  finish (query);
+  
+  return ok;
+}
+
 EditableQueryModel *CDICDatabase::getFeatureListModel (int domain, int type)  {
   if (!db.isOpen ()) return NULL;
   
@@ -2986,9 +3636,9 @@ void CDICDatabase::filterFeatureModel (int domain, EditableQueryModel *model, in
       query.prepare ("select distinct name from " + subTable);
   }
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
@@ -3020,9 +3670,9 @@ void CDICDatabase::updateSubfeatureModel (int domain, EditableQueryModel *model,
   
   else query.prepare ("select value from " + tableName + " where name != name");
 
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
@@ -3060,15 +3710,15 @@ QStringList CDICDatabase::getBundledFeatures (int domain, QString className)  {
                  "feature == " + featTable + ".name");
   query.bindValue (":n", className);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return QStringList ();
   }
   
   QStringList featureList;
   
-  while (query.next ())  {
+  while (next (query))  {
     QString f = query.value (0).toString ();
     QString s = query.value (1).toString ();
     QString d = query.value (2).toString ();
@@ -3086,7 +3736,7 @@ QStringList CDICDatabase::getBundledFeatures (int domain, QString className)  {
     else featureList.append (s);
   }
   
-  query.finish ();
+  finish (query);
   return featureList;
 }
 
@@ -3106,15 +3756,15 @@ QStringList CDICDatabase::getBundledFeatures (int domain, int id)  {
                  "where " + idName + " == :id and name == feature");
   query.bindValue (":id", id);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return QStringList ();
   }
   
   QStringList featureList;
   
-  while (query.next ())  {
+  while (next (query))  {
     QString f = query.value (0).toString ();
     QString s = query.value (1).toString ();
     QString d = query.value (2).toString ();
@@ -3132,7 +3782,7 @@ QStringList CDICDatabase::getBundledFeatures (int domain, int id)  {
     else featureList.append (s); 
   }
   
-  query.finish ();
+  finish (query);
   return featureList;
 }
     
@@ -3158,14 +3808,14 @@ void CDICDatabase::addFeature (int domain, QStringList featList, QStringList sub
     query.bindValue (":name", featList[f]);
     query.bindValue (":disp", display);
   
-    if (!query.exec ())  {
+    if (!exec (query))  {
       QUERY_ERROR(query)
-      query.finish ();
+      finish (query);
       db.rollback ();
       continue;
     }
   
-    query.finish ();
+    finish (query);
   
     tableName = (domain == WORD ? "WordSubfeature" : 
                  (domain == PHONEME ? "PhonemeSubfeature" : "MorphemeSubfeature"));
@@ -3175,14 +3825,14 @@ void CDICDatabase::addFeature (int domain, QStringList featList, QStringList sub
       query.bindValue (":name", featList[f]);
       query.bindValue (":value", sub[s]);
     
-      if (!query.exec ())  {
+      if (!exec (query))  {
         QUERY_ERROR(query)
-        query.finish ();
+        finish (query);
         db.rollback ();
         break;
       }
     
-      query.finish ();
+      finish (query);
     }
   
     db.commit ();
@@ -3206,10 +3856,10 @@ void CDICDatabase::deleteFeature (int domain, QStringList featList)  {
   for (int x = 0; x < featList.size (); x++)
     query.bindValue (x, featList[x]);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
   
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::addSubfeature (int domain, QString feat, QStringList subList)  {
@@ -3223,15 +3873,15 @@ void CDICDatabase::addSubfeature (int domain, QString feat, QStringList subList)
   query.prepare ("select name from " + tableName + " where name == :name");
   query.bindValue (":name", feat);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
+  if (!next (query))  {
     DATA_ERROR("No such feature: " + feat)
-    query.finish ();
+    finish (query);
     return;
   }
   
@@ -3243,10 +3893,10 @@ void CDICDatabase::addSubfeature (int domain, QString feat, QStringList subList)
     query.bindValue (":name", feat);
     query.bindValue (":value", subList[s]);
   
-    if (!query.exec ())
+    if (!exec (query))
       QUERY_ERROR(query)
     
-    query.finish ();
+    finish (query);
   }
 }
     
@@ -3268,10 +3918,10 @@ void CDICDatabase::deleteSubfeature (int domain, QString feat, QStringList subLi
   for (int x = 0; x < subList.size (); x++)
     query.bindValue (x+1, subList[x]);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 void CDICDatabase::renameFeature (int domain, QString before, QString after)  {
@@ -3285,28 +3935,28 @@ void CDICDatabase::renameFeature (int domain, QString before, QString after)  {
   query.prepare ("select name from " + tableName + " where name == :n");
   query.bindValue (":n", after);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (query.next ())  {
-    QMessageBox::warning (NULL, "Error", "There is already a feature with that name.");
-    query.finish ();
+  if (next (query))  {
+    DATA_ERROR("There is already a feature with that name.")
+    finish (query);
     return;
   }
   
-  query.finish ();
+  finish (query);
   
   query.prepare ("update " + tableName + " set name = :new where name == :old");
   query.bindValue (":new", after);
   query.bindValue (":old", before);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 void CDICDatabase::renameSubfeature (int domain, QString feat, QString before, QString after)  {
@@ -3321,29 +3971,29 @@ void CDICDatabase::renameSubfeature (int domain, QString feat, QString before, Q
   query.bindValue (":f", feat);
   query.bindValue (":s", after);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (query.next ())  {
-    QMessageBox::warning (NULL, "Error", "There is already a subfeature with that name.");
-    query.finish ();
+  if (next (query))  {
+    DATA_ERROR("There is already a subfeature with that name.")
+    finish (query);
     return;
   }
   
-  query.finish ();
+  finish (query);
   
   query.prepare ("update " + tableName + " set value = :new where name == :feat and value == :old");
   query.bindValue (":new", after);
   query.bindValue (":old", before);
   query.bindValue (":feat", feat);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::setDisplay (int domain, QString feat, int disp)  {
@@ -3357,27 +4007,27 @@ void CDICDatabase::setDisplay (int domain, QString feat, int disp)  {
   query.prepare ("select name from " + tableName + " where name == :name");
   query.bindValue (":name", feat);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return;
   }
   
-  query.finish ();
+  finish (query);
   
   query.prepare ("update " + tableName + " set displayType = :d where name == :n");
   query.bindValue (":d", displayType[disp]);
   query.bindValue (":n", feat);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::setFeatureParent (int domain, QString feat, QString parent,
@@ -3394,10 +4044,10 @@ void CDICDatabase::setFeatureParent (int domain, QString feat, QString parent,
   query.bindValue (":v", parentSub);
   query.bindValue (":f", feat);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 QString CDICDatabase::getParent (int domain, QString feat)  {
@@ -3411,37 +4061,37 @@ QString CDICDatabase::getParent (int domain, QString feat)  {
                  " where name == :name");
   query.bindValue (":name", feat);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return "";
   }
   
   QString pfeat = query.value (0).toString ();
   QString psub = query.value (1).toString ();
-  query.finish ();
+  finish (query);
   
   if (pfeat.isEmpty ())  {
-    query.finish ();
+    finish (query);
     return "None";
   }
   
   query.prepare ("select displayType from " + tableName + " where name == :pn");
   query.bindValue (":pn", pfeat);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return "";
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return "";
   }
   
@@ -3460,7 +4110,7 @@ QString CDICDatabase::getParent (int domain, QString feat)  {
   else if (query.value (0) == displayType[DISPLAY_SOLO])
     text = psub;
   
-  query.finish ();
+  finish (query);
   return text;
 }
     
@@ -3475,20 +4125,20 @@ QStringList CDICDatabase::getDisplayType (int domain, QString feat)  {
   query.prepare ("select value from " + tableName + " where name == :n");
   query.bindValue (":n", feat);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return displayList;
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return displayList;
   }
   
   QString subfeature = query.value (0).toString ();
   
-  query.finish ();
+  finish (query);
   
   displayList.append (feat + ": " + subfeature);
   displayList.append (subfeature + feat);
@@ -3501,14 +4151,14 @@ QStringList CDICDatabase::getDisplayType (int domain, QString feat)  {
   query.prepare ("select displayType from " + tableName + " where name == :n");
   query.bindValue (":n", feat);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return QStringList ();
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return QStringList ();
   }
   
@@ -3532,26 +4182,26 @@ void CDICDatabase::addNaturalClass (int domain, QString className)  {
   query.prepare ("select name from " + tableName + " where name == :n");
   query.bindValue (":n", className);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (query.next ())  {
-    QMessageBox::warning (NULL, "Error", "A class with that name already exists!");
-    query.finish ();
+  if (next (query))  {
+    DATA_ERROR("A class with that name already exists!")
+    finish (query);
     return;
   }
   
-  query.finish ();
+  finish (query);
   query.prepare ("insert into " + tableName + " values (null, :n)");
   query.bindValue (":n", className);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
 
-  query.finish ();
+  finish (query);
   return;
 }
     
@@ -3568,10 +4218,10 @@ void CDICDatabase::deleteNaturalClass (int domain, QStringList classList)  {
     query.prepare ("delete from " + tableName + " where name == :n");
     query.bindValue (":n", classList[x]);
   
-    if (!query.exec ())
+    if (!exec (query))
       QUERY_ERROR(query)
     
-    query.finish ();
+    finish (query);
   }
 }
 
@@ -3586,27 +4236,27 @@ void CDICDatabase::renameNaturalClass (int domain, QString before, QString after
   query.prepare ("select name from " + tableName + " where name == :n");
   query.bindValue (":n", after);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (query.next ())  {
-    QMessageBox::warning (NULL, "Error", "There is already a natural class with that name.");
-    query.finish ();
+  if (next (query))  {
+    DATA_ERROR("There is already a natural class with that name.")
+    finish (query);
     return;
   }
   
-  query.finish ();
+  finish (query);
   query.prepare ("update " + tableName + " set name = :new where name == :old");
   query.bindValue (":new", after);
   query.bindValue (":old", before);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::addFeatureToClass (int domain, QString cName, QString feat, QString sub)  {
@@ -3622,29 +4272,29 @@ void CDICDatabase::addFeatureToClass (int domain, QString cName, QString feat, Q
   query.prepare ("select bundleID from " + classTable + " where name == :n");
   query.bindValue (":n", cName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return;
   }
   
   int classID = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
   query.prepare ("insert into " + bundleTable + " values (:id, :feat, :val)");
   query.bindValue (":id", classID);
   query.bindValue (":feat", feat);
   query.bindValue (":val", sub);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
   return;
 }
 
@@ -3661,10 +4311,10 @@ void CDICDatabase::addFeatureToSet (int domain, int id, QString feat, QString su
   query.bindValue (":feat", feat);
   query.bindValue (":val", sub);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 void CDICDatabase::removeFeatureFromClass (int domain, QString className, QString feat)  {
@@ -3680,29 +4330,29 @@ void CDICDatabase::removeFeatureFromClass (int domain, QString className, QStrin
   query.prepare ("select bundleID from " + classTable + " where name == :n");
   query.bindValue (":n", className);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return;
   }
   
   int classID = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
   query.prepare ("delete from " + bundleTable + 
                 " where id == :id and feature == :feat");
   query.bindValue (":id", classID);
   query.bindValue (":feat", feat);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 void CDICDatabase::removeFeatureFromSet (int domain, int id, QString feat)  {
@@ -3720,10 +4370,10 @@ void CDICDatabase::removeFeatureFromSet (int domain, int id, QString feat)  {
   query.bindValue (":id", id);
   query.bindValue (":feat", feat);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR (query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::clearClass (int domain, QString className)  {
@@ -3739,27 +4389,27 @@ void CDICDatabase::clearClass (int domain, QString className)  {
   query.prepare ("select bundleID from " + className + "where name == :n");
   query.bindValue (":n", className);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return;
   }
   
-  if (!query.next ())  {
-    query.finish ();
+  if (!next (query))  {
+    finish (query);
     return;
   }
   
   int classID = query.value (0).toInt ();
   
-  query.finish ();
+  finish (query);
   query.prepare ("delete from " + bundleTable + " where id == :id");
   query.bindValue (":id", classID);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
     
 void CDICDatabase::clearSet (int domain, int id)  {
@@ -3774,10 +4424,10 @@ void CDICDatabase::clearSet (int domain, int id)  {
   query.prepare ("delete from " + tableName + " where " + idName + " == :id");
   query.bindValue (":id", id);
   
-  if (!query.exec ())
+  if (!exec (query))
     QUERY_ERROR(query)
     
-  query.finish ();
+  finish (query);
 }
 
 QStringList CDICDatabase::getClassList (int domain)  {
@@ -3789,15 +4439,15 @@ QStringList CDICDatabase::getClassList (int domain)  {
   QSqlQuery query (db);
   query.prepare ("select name from " + tableName);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return QStringList ();
   }
   
   QStringList classList;
   
-  while (query.next ())
+  while (next (query))
     classList.append (query.value (0).toString ());
   
   return classList;
@@ -3813,18 +4463,18 @@ QStringList  CDICDatabase::getClassList (int domain, int id)  {
   query.prepare ("select class from " + viewName + " where id == :id");
   query.bindValue (":id", id);
   
-  if (!query.exec ())  {
+  if (!exec (query))  {
     QUERY_ERROR(query)
-    query.finish ();
+    finish (query);
     return QStringList ();
   }
   
   QStringList classList;
   
-  while (query.next ())
+  while (next (query))
     classList.append (query.value(0).toString ());
   
-  query.finish ();
+  finish (query);
   
   return classList;
 }
@@ -3854,6 +4504,55 @@ QString CDICDatabase::applyDiacritic (int diacritic, QString old)  {
   return newText;
 }
 
+// Goes to the current thread's sink if it has one, else to the error sink,
+// else to stderr
+void CDICDatabase::reportError (QString message)  {
+  errorSinkMutex.lock ();
+  ErrorSink *sink = threadErrorSinks.value (QThread::currentThread (), errorSink);
+  errorSinkMutex.unlock ();
+  
+  if (sink)
+    sink->report (message);
+  
+  else cerr << message.toLocal8Bit ().constData () << endl;
+}
+
+// The sink is not owned, and has to outlast every CDICDatabase
+void CDICDatabase::setErrorSink (ErrorSink *sink)  {
+  errorSink = sink;
+}
+
+// Sends the errors of the calling thread to their own sink, or back to the
+// error sink if NULL, so that a background job can collect its errors for
+// the window to show once it is done
+void CDICDatabase::setThreadErrorSink (ErrorSink *sink)  {
+  QMutexLocker locker (&errorSinkMutex);
+  
+  if (sink)
+    threadErrorSinks[QThread::currentThread ()] = sink;
+  else threadErrorSinks.remove (QThread::currentThread ());
+}
+
+bool CDICDatabase::exec (QSqlQuery &query)  {
+  return QueryProfiler::exec (query);
+}
+
+bool CDICDatabase::exec (QSqlQuery &query, QString statement)  {
+  return QueryProfiler::exec (query, statement);
+}
+
+bool CDICDatabase::execBatch (QSqlQuery &query)  {
+  return QueryProfiler::execBatch (query);
+}
+
+bool CDICDatabase::next (QSqlQuery &query)  {
+  return QueryProfiler::next (query);
+}
+
+void CDICDatabase::finish (QSqlQuery &query)  {
+  QueryProfiler::finish (query);
+}
+
 void CDICDatabase::putInOrder (int *first, int *second, int *third)  {
   // Takes four int pointers, and assigns all non-negative values the numbers
   // one through four, based on the order of the numbers from lowest to highest.
@@ -3879,6 +4578,62 @@ void CDICDatabase::putInOrder (int *first, int *second, int *third)  {
       *array[x] = number++;
 }
 
+// Reads every setting into the cache shared by the copies of this database
+void CDICDatabase::loadSettings ()  {
+  QHash<QString, QString> values;
+  
+  if (db.isOpen ())  {
+    QSqlQuery query (db);
+    query.setForwardOnly (true);
+    
+    if (!exec (query, "select name, value from Settings"))
+      QUERY_ERROR(query)
+    
+    while (next (query))
+      values.insert (query.value (0).toString (), query.value (1).toString ());
+    
+    finish (query);
+  }
+  
+  settings->load (values);
+}
+
+// "safe" is SQLite's defaults, with every commit synced to disk.
+// "interactive" logs to a write-ahead log, so readers such as the word
+// searcher do not wait on writes, and syncs only at checkpoints.
+// "bulk-load" leaves the journal alone but does not sync at all, for jobs
+// that can simply be run again.  The journal mode is only set when asked,
+// right after opening, and then quietly stays as it was if another
+// connection has the file open.
+void CDICDatabase::applyProfile (QString p, bool journal)  {
+  QStringList pragmas;
+  
+  if (p == PROFILE_INTERACTIVE)
+    pragmas << "pragma synchronous = NORMAL" << "pragma cache_size = -16384"
+            << "pragma mmap_size = 268435456";
+  
+  else if (p == PROFILE_BULK_LOAD)
+    pragmas << "pragma synchronous = OFF" << "pragma cache_size = -65536";
+  
+  else pragmas << "pragma synchronous = FULL" << "pragma cache_size = -2000"
+               << "pragma mmap_size = 0";
+  
+  QSqlQuery query (db);
+  
+  if (journal && p != PROFILE_BULK_LOAD)  {
+    exec (query, p == PROFILE_INTERACTIVE ? "pragma journal_mode = WAL"
+                                          : "pragma journal_mode = DELETE");
+    finish (query);
+  }
+  
+  for (int x = 0; x < pragmas.size (); x++)  {
+    if (!exec (query, pragmas[x]))
+      QUERY_ERROR(query)
+    
+    finish (query);
+  }
+}
+
 bool CDICDatabase::readSQLFile (QString filename)  {
   if (!db.isOpen ()) return false;
   
@@ -3906,570 +4661,18 @@ bool CDICDatabase::readSQLFile (QString filename)  {
         
     QSqlQuery query (db);
         
-    if (!query.exec (queryText))  {
+    if (!exec (query, queryText))  {
       QUERY_ERROR(query);
-      query.finish ();
+      finish (query);
       file.close ();
       return false;
     }
         
-    query.finish ();
+    finish (query);
     queryText = "";
   };
       
   file.close ();
 
-  return true;
-}
-
-bool CDICDatabase::loadInventory (QDomElement inv)  {
-  if (inv.isNull ()) return false;
-
-  QString alphabet = inv.firstChildElement ("alphabet").text ();
-  QStringList alphaStrings = alphabet.split (" ");
-
-  QDomNodeList nodeList = inv.childNodes ();
-  int currentID = 0;
-
-  for (int x = 0; x < nodeList.size (); x++)  {
-    QDomElement currentElement = nodeList.at(x).toElement ();
-    
-    if (currentElement.isNull ()) 
-      continue;
-    if (currentElement.tagName () != "phonemeDef")
-      continue;
-
-    QString name = currentElement.attribute ("name");
-    QStringList spellings = currentElement.firstChildElement ("orthography").text ().split (' ');
-    QString notes = currentElement.firstChildElement ("notes").text ();
-    int alpha = alphaStrings.indexOf (name);
-      
-    QSqlQuery query (db);
-    query.prepare ("insert into Phoneme values (:id, :alpha, :name, :notes)");
-    query.bindValue (":id", currentID);
-    query.bindValue (":alpha", alpha);
-    query.bindValue (":name", name);
-    query.bindValue (":notes", notes);
-
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return false;
-    }
-      
-    query.finish ();
-      
-    for (int x = 0; x < spellings.size (); x++)  {
-      query.prepare ("insert into PhonemeSpelling values (:id, :spelling)");
-      query.bindValue (":id", currentID);
-      query.bindValue (":spelling", spellings[x]);
-
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        return false;
-      }
-        
-      query.finish ();
-    }
-    
-    currentID++;
-  }
-  
-  return true;
-}
-
-bool CDICDatabase::loadSupras (QDomElement supras)  {
-  if (supras.isNull ()) return true;
-  
-  QDomNodeList nodeList = supras.childNodes ();
-  int currentID = 0;
-  
-  for (int x = 0; x < nodeList.size (); x++)  {
-    QDomElement currentElement = nodeList.at(x).toElement ();
-    
-    if (currentElement.isNull ()) 
-      continue;
-    if (currentElement.tagName () != "supraDef")
-      continue;
-    
-    QString name = currentElement.attribute ("name");
-    int domain = currentElement.attribute ("domain", "0").toInt ();
-    QStringList applies = currentElement.firstChildElement ("applies").text ().split (' ');
-    QString notes = currentElement.firstChildElement ("notes").text ();
-
-    QDomElement spelling = currentElement.firstChildElement ("spelling");
-    int spellType = spelling.attribute ("type", "0").toInt ();
-    QString spellText = spelling.text ();
-    
-    switch (spellType)  {
-      case 0:
-        if (spellText == "Acute Accent")
-          spellType = TYPE_ACUTE;
-        else if (spellText == "Grave Accent")
-          spellType = TYPE_GRAVE;
-        else if (spellText == "Circumflex")
-          spellType = TYPE_CIRCUMFLEX;
-        else if (spellText == "Diaresis/Umlaut")
-          spellType = TYPE_DIARESIS;
-        else if (spellText == "Macron")
-          spellType = TYPE_MACRON;
-        spellText = "";
-        break;
-      case 1:
-        spellType = TYPE_BEFORE;
-        break;
-      case 2:
-        spellType = TYPE_AFTER;
-        break;
-      case 3:
-        spellType = TYPE_DOUBLED;
-        spellText = "";
-        break;
-      default:
-        spellType = 0;
-        spellText = "";
-    }
-    
-    QDomElement rep = currentElement.firstChildElement ("representation");
-    int repType = rep.attribute ("type", "0").toInt ();
-    QString repText = rep.text ();
-    
-    switch (repType)  {
-      case 0:
-        if (repText == "Acute Accent")
-          repType = TYPE_ACUTE;
-        else if (repText == "Grave Accent")
-          repType = TYPE_GRAVE;
-        else if (repText == "Circumflex")
-          repType = TYPE_CIRCUMFLEX;
-        else if (repText == "Diaresis/Umlaut")
-          repType = TYPE_DIARESIS;
-        else if (repText == "Macron")
-          repType = TYPE_MACRON;
-        repText = "";
-        break;
-      case 1:
-        repType = TYPE_BEFORE;
-        break;
-      case 2:
-        repType = TYPE_AFTER;
-        break;
-      case 3:
-        repType = TYPE_DOUBLED;
-        repText = "";
-        break;
-      default:
-        repType = 0;
-        repText = "";
-    }
-    
-    QSqlQuery query (db);
-    query.prepare ((QString)"insert into Suprasegmental values " +
-                            "(:id, :name, :domain, :rt, :rx, :st, :sx, :notes)");
-    query.bindValue (":id", currentID);
-    query.bindValue (":name", name);
-    query.bindValue (":domain", domain);
-    query.bindValue (":rt", repType);
-    query.bindValue (":rx", repText);
-    query.bindValue (":st", spellType);
-    query.bindValue (":sx", spellText);
-    query.bindValue (":notes", notes);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return false;
-    }
-    
-    query.finish ();
-    
-    QStringList placeholders;
-    for (int a = 0; a < applies.size (); a++)
-      placeholders.append ("?");
-    
-    query.prepare ((QString)"insert into SupraApplies " +
-                            "select ?, id from Phoneme where name in " +
-                            "(" + placeholders.join (", ") + ")");
-    query.bindValue (0, currentID);
-    for (int a = 0; a < applies.size (); a++)
-      query.bindValue (a+1, applies[a]);
-  
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return false;
-    }
-    
-    query.finish ();
-    
-    currentID++;
-  }
-  
-  return true;
-}
-
-bool CDICDatabase::loadWordFeatures (QDomElement words)  {
-  if (words.isNull ()) return true;
-  
-  QStringList types;
-  QList<QStringList> subTypes;
-  
-  QDomNodeList nodeList = words.childNodes ();
-  
-  int bundleID = 1;
-  
-  for (int x = 0; x < nodeList.size (); x++)  {
-    QDomElement currentElement = nodeList.at(x).toElement ();
-    
-    if (currentElement.isNull ()) 
-      continue;
-    if (currentElement.tagName () != "wordDef")
-      continue;
-    
-    QString t = currentElement.attribute ("type", "");
-    QString st = currentElement.attribute ("subtype", "");
-    
-    if (t == "") continue;
-    
-    if (!types.contains (t))
-      types.append (t);
-    
-    if (st == "") continue;
-    
-    int index = types.indexOf (t);
-    
-    while (subTypes.size () <= index)
-      subTypes.append (QStringList ());
-    
-    subTypes[index].append (st);
-  }
-  
-  while (subTypes.size () < types.size ())
-    subTypes.append (QStringList ());
-  
-  QSqlQuery query (db);
-  query.prepare ("insert into WordFeatureDef values (:n, null, null, :d)");
-  query.bindValue (":n", "Type");
-  query.bindValue (":d", displayType[DISPLAY_COLON]);
-  
-  if (!query.exec ())  {
-    QUERY_ERROR(query)
-    query.finish ();
-    return false;
-  }
-  
-  query.finish ();
-  
-  for (int x = 0; x < types.size (); x++)  {
-    query.prepare ("insert into WordSubfeature values (:name, :value)");
-    query.bindValue (":name", "Type");
-    query.bindValue (":value", types[x]);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      continue;
-    }
-    
-    query.finish ();
-    query.prepare ("insert into NaturalClassWord values (:id, :name)");
-    query.bindValue (":id", bundleID);
-    query.bindValue (":name", types[x]);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      continue;
-    }
-    
-    query.finish ();
-    query.prepare ("insert into FeatureBundleWord values (:id, :feat, :val)");
-    query.bindValue (":id", bundleID);
-    query.bindValue (":feat", "Type");
-    query.bindValue (":name", types[x]);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      continue;
-    }
-    
-    query.finish ();
-    bundleID++;
-    
-    if (subTypes[x].size () > 0)  {
-      query.prepare ("insert into WordFeatureDef values (:n, :pn, :pv, :d)");
-      query.bindValue (":n", types[x]);
-      query.bindValue (":pn", "Type");
-      query.bindValue (":pv", types[x]);
-      query.bindValue (":d", displayType[DISPLAY_COLON]);
-      
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        continue;
-      }
-      
-      query.finish ();
-      
-      for (int s = 0; s < subTypes[x].size (); s++)  {
-        query.prepare ("insert into WordSubfeature values (:name, :value)");
-        query.bindValue (":name", types[x]);
-        query.bindValue (":value", subTypes[x][s]);
-        
-        if (!query.exec ())
-          QUERY_ERROR(query)
-          
-        query.finish ();
-      }
-    }
-  }
-  
-  return true;
-}
-
-bool CDICDatabase::loadSequence (QDomElement sequence, int loc, int wordID, 
-                                 int syllNum)  {
-  if (sequence.isNull ()) return true;
-  
-  QString tableName;
-  if (loc == ONSET)
-    tableName = "Onset";
-  else if (loc == PEAK)
-    tableName = "Peak";
-  else tableName = "Coda";
-  
-  QDomNodeList nodeList = sequence.childNodes ();
-  int indNum = 0;
-  
-  QSqlQuery query (db);
-  
-  for (int p = 0; p < nodeList.size (); p++)  {
-    QDomElement currentPhoneme = nodeList.at(p).toElement ();
-      
-    if (currentPhoneme.isNull ())
-      continue;
-    if (currentPhoneme.tagName () != "phoneme")
-      continue;
-      
-    query.prepare ("select id from Phoneme where name == :name");
-    query.bindValue (":name", currentPhoneme.attribute ("name", ""));
-      
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return false;
-    }
-      
-    if (!query.next ())  {
-      DATA_ERROR("Could not find phoneme: " + currentPhoneme.attribute ("name", ""))
-      continue;
-    }
-      
-    int phonNum = query.value (0).toInt ();
-        
-    query.finish ();
-    query.prepare ("insert into " + tableName + 
-                   " values (:word, :syll, :ind, :phon)");
-    query.bindValue (":word", wordID);
-    query.bindValue (":syll", syllNum);
-    query.bindValue (":ind", indNum);
-    query.bindValue (":phon", phonNum);
-        
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return false;
-    }
-        
-    QDomNodeList supraList = currentPhoneme.childNodes ();
-    for (int s = 0; s < supraList.size (); s++)  {
-      QDomElement currentSupra = supraList.at(s).toElement ();
-        
-      if (currentSupra.isNull ())
-        continue;
-      if (currentSupra.tagName () != "supra")
-        continue;
-        
-      query.finish ();
-      query.prepare ("select id from Suprasegmental where name == :name");
-      query.bindValue (":name", currentSupra.text ());
-        
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        return false;
-      }
-        
-      if (!query.next ())  {
-        DATA_ERROR("Could not find suprasegmental: " + currentSupra.text ())
-        continue;
-      }
-        
-      int supraNum = query.value (0).toInt ();
-        
-      query.finish ();
-      query.prepare ("insert into " + tableName +
-                     "Supra values (:word, :syll, :ind, :supra)");
-      query.bindValue (":word", wordID);
-      query.bindValue (":syll", syllNum);
-      query.bindValue (":ind", indNum);
-      query.bindValue (":supra", supraNum);
-        
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        return false;
-      }
-    }
-      
-    query.finish ();
-      
-    indNum++;
-  }
-  
-  return true;
-}
-
-bool CDICDatabase::loadWord (QDomElement word, int wordID)  {
-  if (word.isNull ()) return true;
-  
-  QString name = word.attribute ("name");
-  QString definition = word.firstChildElement ("definition").text ();
-  
-  QSqlQuery query (db);
-  query.prepare ("insert into Word values (:id, :name, :def)");
-  query.bindValue (":id", wordID);
-  query.bindValue (":name", name);
-  query.bindValue (":def", definition);
-  
-  if (!query.exec ())  {
-    QUERY_ERROR(query)
-    query.finish ();
-    return false;
-  }
-  
-  query.finish ();
-  
-  QString type = word.attribute ("type", "");
-  QString subtype = word.attribute ("subtype", "");
-  
-  if (type != "")  {
-    query.prepare ("insert into WordFeatureSet values (:word, :feat, :val)");
-    query.bindValue (":word", wordID);
-    query.bindValue (":feat", "Type");
-    query.bindValue (":val", type);
-    
-    if (!query.exec ())  {
-      QUERY_ERROR(query)
-      query.finish ();
-      return false;
-    }
-    
-    query.finish ();
-    
-    if (subtype != "")  {
-      query.prepare ("insert into WordFeatureSet values (:word, :feat, :val)");
-      query.bindValue (":word", wordID);
-      query.bindValue (":feat", type);
-      query.bindValue (":val", subtype);
-      
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        return false;
-      }
-    }
-  }
-  
-  QDomNodeList syllList = word.firstChildElement ("phonology").childNodes ();
-  int syllNum = 0;
-  
-  for (int x = 0; x < syllList.size (); x++)  {
-    QDomElement currentSyllable = syllList.at(x).toElement ();
-    
-    if (currentSyllable.isNull ())
-      continue;
-    if (currentSyllable.tagName () != "syllable")
-      continue;
-    
-    QStringList syllSupras;
-    syllSupras.append (currentSyllable.attribute ("bSupra", ""));
-    syllSupras.append (currentSyllable.attribute ("fSupra", ""));
-    syllSupras.append (currentSyllable.attribute ("pSupra", ""));
-    
-    for (int sup = 0; sup < syllSupras.size (); sup++)  {
-      if (syllSupras[sup] == "") continue;
-      
-      query.prepare ("select id from Suprasegmental where name == :name");
-      query.bindValue (":name", syllSupras[sup]);
-      
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        return false;
-      }
-      
-      if (!query.next ())  {
-        DATA_ERROR("Could not find suprasegmental: " + syllSupras[sup])
-        continue;
-      }
-      
-      int supraNum = query.value (0).toInt ();
-        
-      query.finish ();
-      query.prepare ("insert into SyllableSupra values (:word, :syll, :supra)");
-      query.bindValue (":word", wordID);
-      query.bindValue (":syll", syllNum);
-      query.bindValue (":supra", supraNum);
-        
-      if (!query.exec ())  {
-        QUERY_ERROR(query)
-        query.finish ();
-        return false;
-      }
-      
-      query.finish ();
-    }
-    
-    if (!loadSequence (currentSyllable.firstChildElement ("onset"), ONSET, wordID, syllNum))
-      return false;
-    
-    if (!loadSequence (currentSyllable.firstChildElement ("peak"), PEAK, wordID, syllNum))
-      return false;
-
-    if (!loadSequence (currentSyllable.firstChildElement ("coda"), CODA, wordID, syllNum))
-      return false;
-    
-    syllNum++;
-  }
-  
-  return true;
-}
-
-bool CDICDatabase::loadWordList (QDomElement words)  {
-  if (words.isNull ()) return true;
-  
-  if (!loadWordFeatures (words))
-    return false;
-  
-  QDomNodeList nodeList = words.childNodes ();
-  int wordID = 1;
-  
-  for (int x = 0; x < nodeList.size (); x++)  {
-    QDomElement currentWord = nodeList.at(x).toElement ();
-    
-    if (currentWord.isNull ())
-      continue;
-    if (currentWord.tagName () != "wordDef")
-      continue;
-    
-    if (!loadWord (currentWord, wordID))
-      return false;
-    
-    wordID++;
-  }
-  
   return true;
 }
\ No newline at end of file
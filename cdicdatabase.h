@@ -2,17 +2,63 @@
 #define CDICDATABASE_H
 
 #include <QSqlDatabase>
+#include <QSqlQuery>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QSharedPointer>
+#include <QMutex>
 
 #include "const.h"
 #include "earleyparser.h"
+#include "settingscache.h"
 
 class QString;
 class QSqlQueryModel;
 class QSqlTableModel;
 class EditableQueryModel;
-class QDomElement;
+class PhonologyIterator;
+class WordListModel;
+class ErrorSink;
+class QThread;
+class ImportProgress;
+
+// Suprasegmentals sorted by the kind of grammar rules they produce
+typedef struct GrammarSupras_s  {
+  QList<Suprasegmental> diacritic;
+  QList<Suprasegmental> beforePhon;
+  QList<Suprasegmental> beforeSyll;
+  QList<Suprasegmental> afterPhon;
+  QList<Suprasegmental> afterSyll;
+  QList<Suprasegmental> doubled;
+  // supra name -> phonemes it applies to
+  QHash<QString, QSet<QString> > appliesTo;
+} GrammarSupras;
+
+// One syllable as it is written out: the phonemes of the onset, peak and coda,
+// with the (repType, repText) of the supras on each of them and on the syllable
+typedef struct SyllableText_s  {
+  QList< QPair<int, QString> > supras;
+  QStringList segments[3];
+  QList< QList< QPair<int, QString> > > segmentSupras[3];
+} SyllableText;
+
+// the supra and segment tables a phonology is written to
+#define PHONOLOGY_TABLES 7
+
+// Name lookups and prepared statements kept by a caller of setPhonologyBatch
+// between batches; set ready to false and the first batch fills them in.
+// They hold while the phonemes and supras do not change, and only on the
+// connection they were made with.
+typedef struct PhonologyStatements_s  {
+  bool ready;
+  QHash<QString, int> phonemeIDs;
+  QHash<QString, int> supraIDs;
+  QSqlQuery deletes[PHONOLOGY_TABLES];
+  QSqlQuery inserts[PHONOLOGY_TABLES];
+} PhonologyStatements;
 
 // This is basically an interface for QSqlDatabase, so that other classes do not
 // have to deal with SQL and queries, and can just call functions of this class.
@@ -22,18 +68,21 @@ class CDICDatabase  {
     CDICDatabase (QString);
     
     // database management
-    bool open (QString);
+    bool open (QString, QString connection = QString (), QString profile = QString ());
     void close ();
     void clear ();
     void clearWordlist ();
     void transaction ();
     void rollback ();
-    void commit ();
+    bool commit ();
+    void beginBulkLoad ();
+    bool endBulkLoad (bool);
+    void setProfile (QString);
     
     QString currentDB ();
     
     bool loadFromXML (QString);
-    bool loadFromText (QString, QString);
+    bool loadFromText (QString, QString, ImportProgress* = NULL);
     bool loadLexique (QString, QStringList);
     bool loadFeatures (int, QString);
     
@@ -43,7 +92,9 @@ class CDICDatabase  {
     // dictionary settings
     bool settingDefined (QString);
     QString getValue (QString);
+    bool getFlag (QString, bool = false);
     void setValue (QString, QString);
+    SettingsCache *getSettings ();
     
     // phonemes
     QSqlQueryModel *getPhonemeListModel ();
@@ -75,20 +126,33 @@ class CDICDatabase  {
     void removeSequence (int, int);
     
     // words
-    QSqlQueryModel *getWordListModel ();
-    void searchWordList (QSqlQueryModel*, QString, QString, QString);
+    WordListModel *getWordListModel ();
+    void searchWordList (WordListModel*, QString, QString, QString,
+                         int = SEARCH_SUBSTRING);
+    static bool prepareWordSearch (QSqlQuery&, QString, QString, QString, QString,
+                                   int = SEARCH_SUBSTRING);
     QSqlTableModel *getWordDisplayModel ();
+    static void fetchAll (QSqlTableModel*);
     
     int addWord (QString name, QString definition = "");
+    bool indexWords (QMap<int, QString>);
+    bool reindexWords ();
     void deleteWord (int);
     void assignNaturalClass (QString, int);
     bool setPhonology (int, QList<Syllable>);
+    int setPhonologyBatch (QList< QPair<int, QList<Syllable> > >,
+                           PhonologyStatements* = NULL);
     QString getRepresentation (int);
+    bool rebuildRepresentations ();
+    bool fillRepresentations ();
     QList<Syllable> getPhonology (int);
+    PhonologyIterator *getPhonologies ();
+    PhonologyIterator *getPhonologies (QList<int>);
     int getNumberOfWords ();
     void setDefinition (QString, int);
     QString getDefinition (int);
     QMap<int, QString> getWordsAndIDs ();
+    void setIgnoredCharacters (QString);
     
     // morphemes
     void setMorphemeList (QList<int>);
@@ -101,9 +165,14 @@ class CDICDatabase  {
     QList<Suprasegmental> getDoubledSupras ();
     QMap<QString, QStringList> getPhonemesAndSpellings ();
     QList<int> getAllWordIDs ();
+    QMap<int, QString> getWordNames ();
+    QMap<int, QString> getWordsContaining (QStringList);
     QString getWordName (int);
     QStringList getPhonemesOfClass (QStringList);
     QList<Rule> getParsingGrammar ();
+    bool cacheParsingGrammar ();
+    QList<Rule> buildParsingGrammar ();
+    QList<Rule> getPhonemeGrammar (QString);
     
     // features and natural classes (domain-generalized)
     // models for feature dialog
@@ -144,22 +213,59 @@ class CDICDatabase  {
     QStringList getClassList (int);
     QStringList getClassList (int, int);
     
-    QString applyDiacritic (int, QString);
+    static QString applyDiacritic (int, QString);
+    
+    // passes every error message to the error sink
+    static void reportError (QString);
+    static void setErrorSink (ErrorSink*);
+    static void setThreadErrorSink (ErrorSink*);
     
   private:
+    static ErrorSink *errorSink;
+    static QHash<QThread*, ErrorSink*> threadErrorSinks;
+    static QMutex errorSinkMutex;
+    
     void putInOrder (int*, int*, int*);
     
     bool readSQLFile (QString);
+    void loadSettings ();
+    void applyProfile (QString, bool);
+    QString savedProfile ();
+    
+    QHash<QString, int> getNameIDs (QString);
+    bool preparePhonologyStatements (PhonologyStatements&);
+    static QString findUnknownName (const QList<Syllable>&, const QHash<QString, int>&,
+                                    const QHash<QString, int>&);
+    
+    QHash<int, QString> buildRepresentations (QString);
+    bool cacheRepresentations (QString);
+    static QString representSyllable (SyllableText&, int);
+    
+    static QString prefixMatch (QString);
+    static QString indexedName (QString, QString);
+    static QString firstGram (QString);
+    static QVariant prefixEnd (QString);
+    
+    // every statement goes through the query profiler
+    static bool exec (QSqlQuery&);
+    static bool exec (QSqlQuery&, QString);
+    static bool execBatch (QSqlQuery&);
+    static bool next (QSqlQuery&);
+    static void finish (QSqlQuery&);
+    
+    bool getGrammarSupras (GrammarSupras&, QString = QString ());
+    void addPhonemeRules (QList<Rule>&, GrammarSupras&, QString);
+    void addSpellingRules (QList<Rule>&, GrammarSupras&, QString, QString);
+    void addCharacterRules (QList<Rule>&);
+    QString getGrammarHash ();
+    QList<Rule> loadGrammarCache ();
+    bool saveGrammarCache (QList<Rule>);
+    bool joinTransaction (bool&);
+    bool leaveTransaction (bool, bool);
     
-    bool loadInventory (QDomElement);
-    bool loadSupras (QDomElement);
-
-    bool loadWordFeatures (QDomElement);
-    bool loadSequence (QDomElement, int, int, int);
-    bool loadWord (QDomElement, int);
-    bool loadWordList (QDomElement);
-
     QSqlDatabase db;
+    QSharedPointer<SettingsCache> settings;
+    QString profile;
 };
 
 #endif
\ No newline at end of file
@@ -3,6 +3,18 @@
 
 -- Statements for clearing the database:
 
+delete from GrammarRule;
+
+delete from WordGram;
+
+delete from WordRepresentation;
+
+delete from WordText;
+
+delete from ClassMemberWord;
+
+delete from ClassMemberPhon;
+
 delete from RuleReference;
 
 delete from RuleCodaSupra;
@@ -3,6 +3,14 @@
 
 -- Statements for clearing the wordlist and morpheme list only:
 
+delete from WordGram;
+
+delete from WordRepresentation;
+
+delete from WordText;
+
+delete from ClassMemberWord;
+
 delete from Morpheme;
 
 delete from CodaSupra;
@@ -0,0 +1,14 @@
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QStringList>
+
+#include "commandline.h"
+
+int main (int argc, char *argv[])  {
+  QCoreApplication app (argc, argv);
+  QTextStream out (stdout);
+  QTextStream err (stderr);
+
+  CommandLine commandLine (&out, &err);
+  return commandLine.run (app.arguments ().mid (1));
+}
@@ -0,0 +1,184 @@
+#include <QTextStream>
+#include <QMap>
+
+#include "const.h"
+
+#include "commandline.h"
+#include "cdicdatabase.h"
+#include "errorsink.h"
+#include "phonologyanalyzer.h"
+#include "reanalyzer.h"
+#include "benchmark.h"
+#include "queryprofiler.h"
+
+CommandLine::CommandLine (QTextStream *o, QTextStream *e)  {
+  out = o;
+  err = e;
+}
+
+// Options come before the command: "--profile" writes the query profile to
+// stderr afterwards, and "--explain" also logs plans that scan whole tables
+int CommandLine::run (QStringList args)  {
+  bool profile = false;
+
+  while (!args.isEmpty () && args[0].startsWith ("--"))  {
+    QString option = args.takeFirst ();
+
+    if (option == "--explain")
+      QueryProfiler::setExplainScans (true);
+    else if (option != "--profile")
+      return usage ();
+
+    profile = true;
+  }
+
+  QueryProfiler::setEnabled (profile);
+
+  int status = runCommand (args);
+
+  if (profile)
+    *err << QueryProfiler::report ();
+
+  return status;
+}
+
+// Runs one command on one dictionary; returns the exit status
+int CommandLine::runCommand (QStringList args)  {
+  if (args.isEmpty ())
+    return usage ();
+
+  QString command = args.takeFirst ();
+
+  if (command == "benchmark")  {
+    Benchmark benchmark (out);
+    benchmark.run (args);
+    return 0;
+  }
+
+  if (args.isEmpty ())
+    return usage ();
+
+  StreamErrorSink errors (err);
+  CDICDatabase::setErrorSink (&errors);
+
+  QString filename = args.takeFirst ();
+  bool ok = false;
+
+  {
+    CDICDatabase db;
+
+    if (!db.open (filename))
+      *err << "cannot open " << filename << endl;
+
+    else if (command == "reparse" && args.isEmpty ())
+      ok = reparse (db);
+    else if (command == "import-xml" && args.size () == 1)
+      ok = importXML (db, args);
+    else if (command == "import-text" && args.size () == 2)
+      ok = importText (db, args);
+    else if (command == "export-text" && args.size () == 2)
+      ok = exportText (db, args);
+    else if (command == "import-features" && args.size () == 2)
+      ok = importFeatures (db, args);
+    else if (command == "export-features" && args.size () == 2)
+      ok = exportFeatures (db, args);
+
+    else  {
+      db.close ();
+      CDICDatabase::setErrorSink (NULL);
+      return usage ();
+    }
+
+    db.close ();
+  }
+
+  CDICDatabase::setErrorSink (NULL);
+
+  if (errors.unwritten () > 0)
+    *err << errors.unwritten () << " more errors not shown" << endl;
+
+  if (errors.count () > 0)
+    *err << errors.count () << " errors" << endl;
+
+  return (ok && errors.count () == 0 ? 0 : 1);
+}
+
+// Parses every word again from its spelling, on all cores
+bool CommandLine::reparse (CDICDatabase &db)  {
+  db.cacheParsingGrammar ();
+
+  PhonologyAnalyzer analyzer;
+  analyzer.load (db);
+
+  QMap<int, QString> words = db.getWordNames ();
+
+  Reanalyzer reanalyzer (db.currentDB (), analyzer, words);
+  reanalyzer.start ();
+  reanalyzer.wait ();
+
+  int failed = reanalyzer.failures ();
+  *out << words.size () - failed << " words reparsed" << endl;
+
+  if (failed > 0)
+    *err << failed << " words could not be saved" << endl;
+
+  return (failed == 0);
+}
+
+bool CommandLine::importXML (CDICDatabase &db, QStringList args)  {
+  if (!db.loadFromXML (args[0])) return false;
+
+  *out << db.getNumberOfWords () << " words in dictionary" << endl;
+
+  return true;
+}
+
+bool CommandLine::importText (CDICDatabase &db, QStringList args)  {
+  if (!db.loadFromText (args[0], args[1])) return false;
+
+  *out << db.getNumberOfWords () << " words in dictionary" << endl;
+
+  return true;
+}
+
+bool CommandLine::exportText (CDICDatabase &db, QStringList args)  {
+  return db.saveToText (args[0], args[1]);
+}
+
+// Replaces the features of the domain, without asking first
+bool CommandLine::importFeatures (CDICDatabase &db, QStringList args)  {
+  int domain = featureDomain (args[0]);
+  if (domain < 0) return false;
+
+  return db.loadFeatures (domain, args[1]);
+}
+
+bool CommandLine::exportFeatures (CDICDatabase &db, QStringList args)  {
+  int domain = featureDomain (args[0]);
+  if (domain < 0) return false;
+
+  return db.saveFeatures (domain, args[1]);
+}
+
+int CommandLine::usage ()  {
+  *err << "usage: cdic-cli [--profile | --explain] COMMAND..." << endl
+       << "       cdic-cli reparse DICTIONARY" << endl
+       << "       cdic-cli import-xml DICTIONARY FILE" << endl
+       << "       cdic-cli import-text DICTIONARY FILE PATTERN" << endl
+       << "       cdic-cli export-text DICTIONARY FILE PATTERN" << endl
+       << "       cdic-cli import-features DICTIONARY phoneme|word|morpheme FILE" << endl
+       << "       cdic-cli export-features DICTIONARY phoneme|word|morpheme FILE" << endl
+       << "       cdic-cli benchmark [--tsv] [DICTIONARY or .xml FILE...]" << endl
+       << "Patterns are as in the GUI, e.g. \"/w,/c,/d\"." << endl;
+
+  return 2;
+}
+
+int CommandLine::featureDomain (QString name)  {
+  if (name == "phoneme") return PHONEME;
+  if (name == "word") return WORD;
+  if (name == "morpheme") return MORPHEME;
+
+  *err << "unknown feature domain " << name << endl;
+  return -1;
+}
@@ -0,0 +1,36 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QStringList>
+
+class QTextStream;
+class CDICDatabase;
+class StreamErrorSink;
+
+// The cdic-cli tool: bulk jobs on a dictionary without the GUI.  Errors are
+// written to stderr by a StreamErrorSink instead of popping up dialogs, and
+// any error makes the exit status 1.  New dictionaries are created from
+// schema.sql, so it is run from the source directory.
+class CommandLine  {
+  public:
+    CommandLine (QTextStream*, QTextStream*);
+
+    int run (QStringList);
+
+  private:
+    int runCommand (QStringList);
+    bool reparse (CDICDatabase&);
+    bool importXML (CDICDatabase&, QStringList);
+    bool importText (CDICDatabase&, QStringList);
+    bool exportText (CDICDatabase&, QStringList);
+    bool importFeatures (CDICDatabase&, QStringList);
+    bool exportFeatures (CDICDatabase&, QStringList);
+
+    int usage ();
+    int featureDomain (QString);
+
+    QTextStream *out;
+    QTextStream *err;
+};
+
+#endif
@@ -13,6 +13,13 @@
 #define IGNORED_CHARACTERS "IgnoredCharacters"
 #define SQUARE_BRACKETS "SquareBrackets"
 #define USE_UNICODE "UseUnicode"
+#define GRAMMAR_HASH "GrammarHash"
+#define SQLITE_PROFILE "SQLiteProfile"
+
+// SQLite performance profiles, the values of SQLITE_PROFILE
+#define PROFILE_SAFE "safe"
+#define PROFILE_INTERACTIVE "interactive"
+#define PROFILE_BULK_LOAD "bulk-load"
 
 // Codes for phonotactics information
 #define ONSET 0
@@ -33,6 +40,10 @@
 // Special code for initializing FB dialog as for natural classes
 #define NATURAL_CLASS -1
 
+// Search modes for the word list
+#define SEARCH_SUBSTRING 0
+#define SEARCH_PREFIX 1
+
 // Feature display codes for strings stored in database
 #define DISPLAY_COLON 0
 #define DISPLAY_PREFIX 1
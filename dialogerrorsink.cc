@@ -0,0 +1,16 @@
+#include <QApplication>
+#include <QThread>
+#include <QMessageBox>
+
+#include <iostream>
+using namespace std;
+
+#include "dialogerrorsink.h"
+
+void DialogErrorSink::report (QString message)  {
+  if (qobject_cast<QApplication*> (QCoreApplication::instance ()) &&
+      QThread::currentThread () == QCoreApplication::instance ()->thread ())
+    QMessageBox::warning (NULL, "Database Error", message);
+
+  else cerr << message.toLocal8Bit ().constData () << endl;
+}
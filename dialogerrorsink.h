@@ -0,0 +1,13 @@
+#ifndef DIALOGERRORSINK_H
+#define DIALOGERRORSINK_H
+
+#include "errorsink.h"
+
+// Shows each error in a dialog on the GUI thread; background threads cannot
+// show one, so their errors go to stderr
+class DialogErrorSink : public ErrorSink  {
+  public:
+    void report (QString);
+};
+
+#endif
@@ -1,4 +1,7 @@
 #include <QFile>
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <QEventLoop>
 
 #include <QTextStream>
 #include <QMessageBox>
@@ -16,6 +19,7 @@ using namespace std;
 #include "suprasegmentalspage.h"
 #include "wordpage.h"
 #include "morphemeupdatedialog.h"
+#include "textimport.h"
 
 Dictionary::Dictionary ()  {
   setMinimumWidth (700);
@@ -33,6 +37,9 @@ Dictionary::Dictionary ()  {
   addTab (phonotacticsPage, "Phonotactics");
   addTab (wordPage, "Words");
 
+  connect (db.getSettings (), SIGNAL (valueChanged (QString, QString)), this,
+           SLOT (updateSetting (QString, QString)));
+
   connect (phonologyPage, SIGNAL (naturalClassListUpdated ()), phonotacticsPage,
            SLOT (updateClassList ()));
   
@@ -40,16 +47,24 @@ Dictionary::Dictionary ()  {
            SLOT (setDirty ()));
   connect (suprasegmentalsPage, SIGNAL (suprasChanged ()), wordPage,
            SLOT (setDirty ()));
+  connect (phonologyPage, SIGNAL (phonemeChanged (QString, QStringList)), wordPage,
+           SLOT (updatePhoneme (QString, QStringList)));
+  connect (suprasegmentalsPage, SIGNAL (supraChanged (QString)), wordPage,
+           SLOT (updateSupra (QString)));
   connect (phonotacticsPage, SIGNAL (phonotacticsChanged ()), wordPage,
            SLOT (setDirty ()));
   
   connect (phonotacticsPage, SIGNAL (reanalyze ()), wordPage,
            SLOT (parseWordlist ()));
+  connect (phonotacticsPage, SIGNAL (cancelReanalyze ()), wordPage,
+           SLOT (cancelParsing ()));
   
+  connect (wordPage, SIGNAL (parsingStarted (int)), phonotacticsPage,
+           SLOT (startProgressBar (int)));
   connect (wordPage, SIGNAL (wordParsed ()), phonotacticsPage,
            SLOT (incrementProgressBar ()));
-  connect (wordPage, SIGNAL (parsingFinished ()), phonotacticsPage,
-           SLOT (resetProgressBar ()));
+  connect (wordPage, SIGNAL (parsingFinished (int)), phonotacticsPage,
+           SLOT (resetProgressBar (int)));
 }
 
 bool Dictionary::isOpen ()  {
@@ -63,7 +78,7 @@ void Dictionary::openDB (QString filename)  {
     QMessageBox::warning (this, "", "Could not open database: " + filename);
   
   else  {
-    if (db.getValue ("NeedsMorphemeUpdateDialog") == "true")
+    if (db.getFlag ("NeedsMorphemeUpdateDialog"))
       launchMorphemeUpdateDialog ();
     
     QString langName = db.getValue (LANGUAGE_NAME);
@@ -72,8 +87,9 @@ void Dictionary::openDB (QString filename)  {
       emit languageNameUpdated ("Conlang");
     else emit languageNameUpdated (langName);
     
-    emit bracketsUpdated (db.getValue (SQUARE_BRACKETS) == "true");
-    emit unicodeUpdated (db.getValue (USE_UNICODE) == "true");
+    emit bracketsUpdated (db.getFlag (SQUARE_BRACKETS));
+    emit unicodeUpdated (db.getFlag (USE_UNICODE));
+    emit profileUpdated (db.getValue (SQLITE_PROFILE));
     
     setDB ();
   }
@@ -89,28 +105,75 @@ void Dictionary::closeDB ()  {
 }
 
 void Dictionary::loadXML (QString filename)  {
-  if (db.loadFromXML (filename))  {
-    QString langName = db.getValue (LANGUAGE_NAME);
-    
-    if (langName.isEmpty ())
-      emit languageNameUpdated ("Conlang");
-    else emit languageNameUpdated (langName);
-    
-    emit bracketsUpdated (db.getValue (SQUARE_BRACKETS) == "true");
-    emit unicodeUpdated (db.getValue (USE_UNICODE) == "true");
-    
+  // the language name and brackets it sets come through updateSetting
+  if (db.loadFromXML (filename))
     launchMorphemeUpdateDialog ();
-  }
   
   updateModels ();
 }
 
+// The import writes on a thread of its own while the window shows how far
+// it has got; cancelling it leaves the dictionary as it was
 void Dictionary::loadText (QString filename, QString pattern)  {
-  db.loadFromText (filename, pattern);
+  if (!isOpen ()) return;
+  
+  TextImport import (db.currentDB (), filename, pattern);
+  
+  QProgressDialog progress ("Importing " + QFileInfo (filename).fileName () + "...",
+                            "Cancel", 0, 100, this);
+  progress.setWindowModality (Qt::WindowModal);
+  progress.setMinimumDuration (0);
+  
+  QEventLoop loop;
+  
+  connect (&import, SIGNAL (progressed (int)), &progress, SLOT (setValue (int)));
+  connect (&progress, SIGNAL (canceled ()), &import, SLOT (cancel ()));
+  connect (&import, SIGNAL (finished ()), &loop, SLOT (quit ()));
+  
+  import.start ();
+  loop.exec ();
+  import.wait ();
+  
   updateModels ();
+  
+  // the import's errors are only shown now, on this thread, with the outcome
+  QString name = QFileInfo (filename).fileName ();
+  int errors = import.errors ()->count ();
+  QString summary;
+  
+  if (!import.succeeded ())  {
+    if (import.wasCancelled () && errors == 0) return;
+    summary = (import.wasCancelled () ? "Cancelled importing " : "Could not import ") +
+              name + "; the dictionary is unchanged.";
+  }
+  
+  else if (errors > 0)
+    summary = QString ("Imported %1 with %2 errors.").arg (name).arg (errors);
+  
+  else return;
+  
+  QMessageBox box (QMessageBox::Warning, "Import", summary, QMessageBox::Ok, this);
+  
+  if (errors > 0)  {
+    QStringList messages = import.errors ()->messages ();
+    
+    if (errors > messages.size ())
+      messages.append (QString ("%1 more errors not shown").arg (errors - messages.size ()));
+    
+    box.setDetailedText (messages.join ("\n"));
+  }
+  
+  box.exec ();
 }
 
 void Dictionary::loadFeatures (int domain, QString filename)  {
+  QString domainName = (domain == PHONEME ? "Phoneme" : (domain == WORD ? "Word" : "Morpheme"));
+  
+  if (QMessageBox::warning (this, "Load Features", (QString)"This will delete all existing " + 
+                            domainName + " features.  Continue?",
+                            QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::No)
+    return;
+  
   db.loadFeatures (domain, filename);
   updateModels ();
 }
@@ -159,19 +222,32 @@ void Dictionary::setValue (QString key, QString value)  {
   if (value.isNull ()) value = "";
   
   db.setValue (key, value);
-  
-  if (key == LANGUAGE_NAME)
-    wordPage->setLanguageName (value);
 }
 
 QString Dictionary::getValue (QString key)  {
   return db.getValue (key);
 }
 
+void Dictionary::setProfile (QString profile)  {
+  db.setProfile (profile);
+}
+
 void Dictionary::setMorphemeList (QList<int> list)  {
   db.setMorphemeList (list);
 }
 
+// Passes on the settings the main window shows, whoever changed them
+void Dictionary::updateSetting (QString name, QString value)  {
+  if (name == LANGUAGE_NAME)
+    emit languageNameUpdated (value.isEmpty () ? "Conlang" : value);
+  else if (name == SQUARE_BRACKETS)
+    emit bracketsUpdated (value == "true");
+  else if (name == USE_UNICODE)
+    emit unicodeUpdated (value == "true");
+  else if (name == SQLITE_PROFILE)
+    emit profileUpdated (value);
+}
+
 void Dictionary::setDB ()  {
   phonologyPage->setDB (db);
   suprasegmentalsPage->setDB (db);
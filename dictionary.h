@@ -36,14 +36,17 @@ class Dictionary : public QTabWidget {
     
     void setValue (QString, QString);
     QString getValue (QString);
+    void setProfile (QString);
     
   signals:
     void languageNameUpdated (QString);
     void bracketsUpdated (bool);
     void unicodeUpdated (bool);
+    void profileUpdated (QString);
     
   private slots:
     void setMorphemeList (QList<int>);
+    void updateSetting (QString, QString);
 
   private:
     void setDB ();
@@ -3,12 +3,22 @@
 
 -- Statements for dropping all tables (and thus deleting all data):
 
+drop table GrammarRule;
+
+drop table WordGram;
+
+drop table WordRepresentation;
+
+drop table WordText;
+
 drop view WordPageTable;
 
 drop view ClassConcatView;
 
 drop view WordClassList;
 
+drop table ClassMemberWord;
+
 drop table FeatureBundleWord;
 
 drop table NaturalClassWord;
@@ -47,6 +57,8 @@ drop table Suprasegmental;
 
 drop view PhonClassList;
 
+drop table ClassMemberPhon;
+
 drop table FeatureBundlePhon;
 
 drop table NaturalClassPhon;
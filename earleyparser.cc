@@ -5,46 +5,80 @@ using namespace std;
 
 #include "earleyparser.h"
 
-EarleyParser::EarleyParser ()  {}
+// How far scoreChartItem has got with an item
+#define UNSCORED 0
+#define SCORING 1
+#define SCORED 2
+#define UNDERIVABLE 3
+
+EarleyParser::EarleyParser ()  {
+  setRules (QList<Rule> ());
+}
 
 void EarleyParser::setRules (QList<Rule> list)  {
+  symbolTable.clear ();
+  symbolNames.clear ();
+  rules.clear ();
+  knownRules.clear ();
   nonterminals.clear ();
+  predictions.clear ();
   preterminals.clear ();
   terminals.clear ();
   
-  for (int x = 0; x < list.size (); x++)  {
-    bool hybrid = false;
-    
-    if (list[x].rhs.size () == 1 && list[x].rhs[0].startsWith ("\"") &&
-        list[x].rhs[0].endsWith ("\""))  {
-      QString terminal = list[x].rhs[0];
-      
-      if (!terminals.contains (terminal))
-        terminals[terminal] = QStringList ();
-      terminals[terminal].append (list[x].lhs);
-    
-      if (!preterminals.contains (list[x].lhs))
-        preterminals.append (list[x].lhs);
-    }
-    
-    else  {
-      for (int y = 0; y < list[x].rhs.size (); y++)
-        if (list[x].rhs[y].startsWith ("\"") && 
-            list[x].rhs[y].endsWith ("\""))
-          hybrid = true;
-     
-      if (!hybrid) nonterminals.append (list[x]);
-    }
-  }
+  // the start rule is not part of the grammar; it is rule 0 by convention
+  CompiledRule top;
+  top.lhs = internSymbol ("TOP");
+  top.rhs.append (internSymbol ("S"));
+  top.context = -1;
+  rules.append (top);
+  topRule = 0;
+  codaSymbol = internSymbol ("Coda");
+  
+  for (int x = 0; x < list.size (); x++)
+    compileRule (list[x]);
+  
+  indexRules ();
 /*
-  for (int x = 0; x < nonterminals.size (); x++)
-    printRule (nonterminals[x]);
+  for (int x = 0; x < list.size (); x++)
+    printRule (list[x]);*/
+}
+
+// Adds to the grammar without recompiling what is already there
+void EarleyParser::addRules (QList<Rule> list)  {
+  for (int x = 0; x < list.size (); x++)
+    compileRule (list[x]);
   
-  QTextStream terminal (stdout);
+  indexRules ();
+}
+
+// Drops every rule with the given left-hand side
+void EarleyParser::removeRules (QString lhs)  {
+  int symbol = symbolTable.value (lhs, -1);
+  if (symbol < 0) return;
+  
+  QList<CompiledRule> kept;
+  
+  for (int x = 0; x < rules.size (); x++)
+    if (x == topRule || rules[x].lhs != symbol)
+      kept.append (rules[x]);
+  
+  rules = kept;
+  
+  QString prefix = lhs + " -> ";
+  QSet<QString>::iterator i = knownRules.begin ();
   
-  QMap<QString, QStringList>::const_iterator i;
-  for (i = terminals.constBegin (); i != terminals.constEnd (); i++)
-    terminal << i.key () << ": " << i.value ().join (", ") << endl;*/
+  while (i != knownRules.end ())  {
+    if (i->startsWith (prefix))
+      i = knownRules.erase (i);
+    else ++i;
+  }
+  
+  indexRules ();
+}
+
+void EarleyParser::replaceRules (QString lhs, QList<Rule> list)  {
+  removeRules (lhs);
+  addRules (list);
 }
 
 void EarleyParser::setIgnored (QString i)  {
@@ -52,19 +86,29 @@ void EarleyParser::setIgnored (QString i)  {
 }
 
 TreeNode EarleyParser::parse (QString input)  {
-  chart.clear ();
-  
-  QStringList words;
+  return parse (tokenize (input));
+}
+
+// Converts the input into terminal symbols; characters which no rule can
+// produce become -1 and will fail to scan.
+QVector<int> EarleyParser::tokenize (QString input)  {
+  QVector<int> words;
   
   for (int x = 0; x < input.size (); x++)
     if (!ignored.contains (input[x]) && input[x] != ' ')
-      words.append ("\"" + input[x] + "\"");
+      words.append (symbolTable.value ("\"" + input[x] + "\"", -1));
   
-  QTextStream terminal (stdout);
+  return words;
+}
+
+TreeNode EarleyParser::parse (QVector<int> words)  {
+  chart.clear ();
+  chartIndex.clear ();
+  predicted.clear ();
+  waiting.clear ();
   
   ChartItem start;
-  start.lhs = "TOP";
-  start.rhs = QStringList ("S");
+  start.rule = topRule;
   start.nextElement = 0;
   start.start = 0;
   start.end = 0;
@@ -75,20 +119,19 @@ TreeNode EarleyParser::parse (QString input)  {
     if (chart.size () <= x) break;
     
     for (int y = 0; y < chart[x].size (); y++)  {
-      if (chart[x][y].rhs.size () > chart[x][y].nextElement)  {
-        QString nextElement = chart[x][y].rhs[chart[x][y].nextElement];
-        
-        if (preterminals.contains (nextElement) && x < words.size ())
-          runScanner (x, y, words[x], ((x+1) < words.size () ? words[x+1] : ""));
+      const CompiledRule &rule = rules[chart[x][y].rule];
+      int nextElement = chart[x][y].nextElement;
+      
+      if (rule.rhs.size () > nextElement)  {
+        if (preterminals[rule.rhs[nextElement]] && x < words.size ())
+          runScanner (x, y, words[x], ((x+1) < words.size () ? words[x+1] : -1));
         else runPredictor (x, y);
       }
       
-      else runCompleter (x, y, (x < words.size () ? words[x] : ""));
+      else runCompleter (x, y, (x < words.size () ? words[x] : -1));
     }
   }
   
-  QList<TreeNode> nodeList;
-  
   if (chart.size () <= words.size ())  {
     TreeNode tn;
     tn.label = "";
@@ -96,47 +139,26 @@ TreeNode EarleyParser::parse (QString input)  {
     return tn;
   }
   
-  for (int x = 0; x < chart[words.size ()].size (); x++)  {
-    ChartItem item = chart[words.size ()][x];
+  // Every parse of the word is a derivation of the one complete TOP item,
+  // so the forest is scored from there and only the best tree is built
+  int root = -1;
+  
+  for (int x = 0; x < chart[words.size ()].size () && root == -1; x++)  {
+    const ChartItem &item = chart[words.size ()][x];
     
-    if (item.lhs == "TOP" && item.nextElement == item.rhs.size ())
-      nodeList.append (getTreeNode (words.size (), x));
+    if (item.rule == topRule && item.start == 0 &&
+        item.nextElement == rules[topRule].rhs.size ())
+      root = x;
   }
   
-  if (nodeList.size () == 0)  {
+  if (root == -1 || scoreChartItem (words.size (), root) != SCORED)  {
     TreeNode tn;
     tn.label = "";
     tn.payload = "";
     return tn;
   }
   
-  QList<int> bestTrees;
-  int bestCodaCount = countCodas (nodeList[0]);
-  
-  for (int x = 1; x < nodeList.size (); x++)  {
-    int codas = countCodas (nodeList[x]);
-    
-    if (codas < bestCodaCount)
-      bestCodaCount = codas;
-  }
-  
-  for (int x = 0; x < nodeList.size (); x++)
-    if (countCodas (nodeList[x]) == bestCodaCount)
-      bestTrees.append (x);
-    
-  int bestTree = bestTrees[0];
-  int bestContextCount = countContexts (nodeList[bestTree]);
-  
-  for (int x = 0; x < bestTrees.size (); x++)  {
-    int contexts = countContexts (nodeList[bestTrees[x]]);
-    
-    if (contexts > bestContextCount)  {
-      bestTree = bestTrees[x];
-      bestContextCount = contexts;
-    }
-  }
-  
-  return nodeList[bestTree];
+  return getTreeNode (words.size (), root);
 }
 
 QString EarleyParser::stringTreeNode (TreeNode node)  {
@@ -153,19 +175,163 @@ QString EarleyParser::stringTreeNode (TreeNode node)  {
   return text;
 }
 
+// Works out the codas and contexts of the best subtree under an item, and
+// which of its derivations gives them, scoring the items each derivation
+// refers to first.  Fewest codas wins, then most contexts, then the tree
+// the parser found first (see compareTrees).  A derivation that leads back
+// to an item still being scored is part of a cycle and is passed over.
+// Returns SCORED, UNDERIVABLE, or SCORING if nothing was found but a cycle
+// was met; the item is then left unscored, as it may be derivable once the
+// item it looped back to is done.
+int EarleyParser::scoreChartItem (int chartPosition, int itemNum)  {
+  ChartItem &item = chart[chartPosition][itemNum];
+  
+  if (item.scored != UNSCORED)
+    return item.scored;
+  
+  const CompiledRule &rule = rules[item.rule];
+  
+  // an item's own rule is counted where its derivations begin
+  item.codas = (rule.lhs == codaSymbol ? 1 : 0);
+  item.contexts = (rule.context != -1 ? 1 : 0);
+  item.best = -1;
+  
+  if (item.derivations.isEmpty ())  {
+    item.scored = SCORED;
+    return SCORED;
+  }
+  
+  item.scored = SCORING;
+  bool cycle = false;
+  
+  for (int x = 0; x < item.derivations.size (); x++)  {
+    const BackPointer &previous = item.derivations[x].previous;
+    const BackPointer &child = item.derivations[x].child;
+    
+    int scored = scoreChartItem (previous.position, previous.item);
+    if (scored == SCORED)
+      scored = scoreChartItem (child.position, child.item);
+    
+    if (scored == SCORING)
+      cycle = true;
+    
+    if (scored != SCORED)
+      continue;
+    
+    int codas = chart[previous.position][previous.item].codas +
+                chart[child.position][child.item].codas;
+    int contexts = chart[previous.position][previous.item].contexts +
+                   chart[child.position][child.item].contexts;
+    
+    bool better = (item.best == -1 || codas < item.codas ||
+                   (codas == item.codas && contexts > item.contexts));
+    
+    if (!better && codas == item.codas && contexts == item.contexts)  {
+      const Derivation &best = item.derivations[item.best];
+      int order = compareTrees (child, false, best.child, false);
+      
+      better = (order < 0 || (order == 0 && 
+                compareTrees (previous, false, best.previous, false) < 0));
+    }
+    
+    if (better)  {
+      item.best = x;
+      item.codas = codas;
+      item.contexts = contexts;
+    }
+  }
+  
+  if (item.best != -1)
+    item.scored = SCORED;
+  else if (cycle)  {
+    item.scored = UNSCORED;
+    return SCORING;
+  }
+  else item.scored = UNDERIVABLE;
+  
+  return item.scored;
+}
+
+// Orders the trees under two items by when a chart holding one item per
+// tree, as the parser's used to, would have found them; among equally good
+// parses it kept the first.  Such a chart fills a column with the scanned
+// items, then with the items made while working through it: those an item
+// predicts, in rule order, and those an item completes, in the order the
+// items they advance were found.  A tree is read from an item's best
+// derivation, or if first is set, from the first one found.
+int EarleyParser::compareTrees (BackPointer a, bool firstA, BackPointer b, bool firstB)  {
+  if (a.position != b.position)
+    return (a.position < b.position ? -1 : 1);
+  
+  if (a.item == b.item && firstA == firstB)
+    return 0;
+  
+  const ChartItem &itemA = chart[a.position][a.item];
+  const ChartItem &itemB = chart[b.position][b.item];
+  
+  // scanned items, and the start item, come before anything else in a column
+  bool scannedA = itemA.derivations.isEmpty () && 
+                  (itemA.nextElement > 0 || itemA.rule == topRule);
+  bool scannedB = itemB.derivations.isEmpty () && 
+                  (itemB.nextElement > 0 || itemB.rule == topRule);
+  
+  if (scannedA || scannedB)  {
+    if (scannedA && scannedB)
+      return (a.item < b.item ? -1 : (a.item > b.item ? 1 : 0));
+    
+    return (scannedA ? -1 : 1);
+  }
+  
+  // the item each was made while working through: the first item waiting
+  // on a predicted item's symbol, or the child a completed item advanced over
+  bool predictedA = itemA.derivations.isEmpty ();
+  bool predictedB = itemB.derivations.isEmpty ();
+  BackPointer makerA = a, makerB = b;
+  BackPointer previousA, previousB;
+  
+  if (predictedA)
+    makerA.item = waiting[a.position][rules[itemA.rule].lhs].first ();
+  else  {
+    const Derivation &derivation = itemA.derivations[firstA ? 0 : itemA.best];
+    makerA = derivation.child;
+    previousA = derivation.previous;
+  }
+  
+  if (predictedB)
+    makerB.item = waiting[b.position][rules[itemB.rule].lhs].first ();
+  else  {
+    const Derivation &derivation = itemB.derivations[firstB ? 0 : itemB.best];
+    makerB = derivation.child;
+    previousB = derivation.previous;
+  }
+  
+  int order = compareTrees (makerA, firstA || predictedA, makerB, firstB || predictedB);
+  if (order != 0 || predictedA != predictedB)
+    return order;
+  
+  if (predictedA)
+    return (a.item < b.item ? -1 : (a.item > b.item ? 1 : 0));
+  
+  return compareTrees (previousA, firstA, previousB, firstB);
+}
+
+// Builds the tree of a scored item.  Its children are read off from right to
+// left, each best derivation giving the last child and the item holding the
+// ones before it.
 TreeNode EarleyParser::getTreeNode (int chartPosition, int itemNum)  {
   TreeNode node;
   
   if (chart.size () <= chartPosition) return node;
   if (chart[chartPosition].size () <= itemNum) return node;
   
-  ChartItem item = chart[chartPosition][itemNum];
+  const ChartItem &item = chart[chartPosition][itemNum];
+  const CompiledRule &rule = rules[item.rule];
   
-  node.label = item.lhs;
-  node.context = (item.context != "");
+  node.label = symbolNames[rule.lhs];
+  node.context = (rule.context != -1);
   
-  if (item.backPointers.size () == 0)  {
-    QString p = item.rhs[0];
+  if (item.derivations.isEmpty () && rule.rhs.size () > 0)  {
+    QString p = symbolNames[rule.rhs[0]];
     p.chop (1);
     p.remove (0, 1);
     
@@ -173,139 +339,222 @@ TreeNode EarleyParser::getTreeNode (int chartPosition, int itemNum)  {
     return node;
   }
   
-  for (int x = 0; x < item.backPointers.size (); x++)
-    node.children.append (getTreeNode (item.backPointers[x].position, 
-                                       item.backPointers[x].item));
+  QList<BackPointer> children;
+  int position = chartPosition;
+  int num = itemNum;
+  
+  while (chart[position][num].best >= 0)  {
+    const Derivation &derivation = chart[position][num].derivations[chart[position][num].best];
+    
+    children.prepend (derivation.child);
+    position = derivation.previous.position;
+    num = derivation.previous.item;
+  }
+  
+  for (int x = 0; x < children.size (); x++)
+    node.children.append (getTreeNode (children[x].position, children[x].item));
    
   node.payload = "";
     
   return node;
 }
 
-int EarleyParser::countCodas (TreeNode node)  {
-  int count = node.label == "Coda" ? 1 : 0;
+int EarleyParser::internSymbol (QString symbol)  {
+  QHash<QString, int>::const_iterator i = symbolTable.constFind (symbol);
   
-  for (int x = 0; x < node.children.size (); x++)
-    count += countCodas (node.children[x]);
+  if (i != symbolTable.constEnd ())
+    return i.value ();
   
-  return count;
+  int id = symbolNames.size ();
+  symbolTable[symbol] = id;
+  symbolNames.append (symbol);
+  preterminals.append (false);
+  
+  return id;
 }
 
-int EarleyParser::countContexts (TreeNode node)  {
-  int count = node.context ? 1 : 0;
+void EarleyParser::compileRule (Rule r)  {
+  // identical rules would only produce identical chart items
+  QString key = r.lhs + " -> " + r.rhs.join (" ") + " | " + r.context;
+  if (knownRules.contains (key)) return;
+  knownRules.insert (key);
+  
+  CompiledRule rule;
+  rule.lhs = internSymbol (r.lhs);
+  rule.context = -1;
+  
+  if (r.rhs.size () == 1 && r.rhs[0].startsWith ("\"") && 
+      r.rhs[0].endsWith ("\""))  {
+    int terminal = internSymbol (r.rhs[0]);
+    rule.rhs.append (terminal);
+    
+    QPair<int, int> scan (rule.lhs, terminal);
+    if (!terminals.contains (scan))  {
+      terminals[scan] = rules.size ();
+      rules.append (rule);
+    }
+  }
   
-  for (int x = 0; x < node.children.size (); x++)
-    count += countContexts (node.children[x]);
+  else  {
+    bool hybrid = false;
+    
+    if (r.context != "")
+      rule.context = internSymbol ("\"" + r.context + "\"");
+    
+    for (int y = 0; y < r.rhs.size (); y++)  {
+      if (r.rhs[y].startsWith ("\"") && r.rhs[y].endsWith ("\""))
+        hybrid = true;
+      
+      rule.rhs.append (internSymbol (r.rhs[y]));
+    }
+    
+    if (!hybrid)
+      rules.append (rule);
+  }
+}
+
+// Rebuilds the lookup tables from the compiled rules
+void EarleyParser::indexRules ()  {
+  nonterminals.clear ();
+  terminals.clear ();
+  predictions.clear ();
+  predictions.resize (symbolNames.size ());
+  preterminals.fill (false);
   
-  return count;
+  for (int x = 0; x < rules.size (); x++)  {
+    if (x == topRule) continue;
+    
+    const CompiledRule &rule = rules[x];
+    
+    if (rule.rhs.size () == 1 && symbolNames[rule.rhs[0]].startsWith ("\""))  {
+      terminals[qMakePair (rule.lhs, rule.rhs[0])] = x;
+      preterminals[rule.lhs] = true;
+    }
+    
+    else  {
+      nonterminals.append (x);
+      predictions[rule.lhs].append (x);
+    }
+  }
 }
 
 void EarleyParser::runPredictor (int chartPosition, int itemNum)  {
   if (chart.size () <= chartPosition) return;
   if (chart[chartPosition].size () <= itemNum) return;
   
-  ChartItem item = chart[chartPosition][itemNum];
+  int ruleNum = chart[chartPosition][itemNum].rule;
+  int next = chart[chartPosition][itemNum].nextElement;
+  int end = chart[chartPosition][itemNum].end;
 
-  if (item.rhs.size () <= item.nextElement)  {
+  if (rules[ruleNum].rhs.size () <= next)  {
     cout << "Error: Illegal chart item" << endl;
     return;
   }
   
-  QString nextElement = item.rhs[item.nextElement];
-  
-  for (int x = 0; x < nonterminals.size (); x++)
-    if (nonterminals[x].lhs == nextElement)  {
-      ChartItem newItem;
-      newItem.lhs = nonterminals[x].lhs;
-      newItem.rhs = nonterminals[x].rhs;
-      newItem.nextElement = 0;
-      newItem.start = item.end;
-      newItem.end = item.end;
-      newItem.context = nonterminals[x].context;
-      
-      addChartItem (newItem, item.end);
-    }
+  int nextElement = rules[ruleNum].rhs[next];
+  
+  // predicted items don't depend on the item that asked for them
+  if (predicted[end].contains (nextElement)) return;
+  predicted[end].insert (nextElement);
+  
+  const QList<int> &ruleList = predictions[nextElement];
+  
+  for (int x = 0; x < ruleList.size (); x++)  {
+    ChartItem newItem;
+    newItem.rule = ruleList[x];
+    newItem.nextElement = 0;
+    newItem.start = end;
+    newItem.end = end;
+    
+    addChartItem (newItem, end);
+  }
     
 //  cout << "Ran predictor" << endl;
 //  printChart ();
 }
 
-void EarleyParser::runScanner (int chartPosition, int itemNum, QString word, QString next)  {
+void EarleyParser::runScanner (int chartPosition, int itemNum, int word, int next)  {
   if (chart.size () <= chartPosition) return;
   if (chart[chartPosition].size () <= itemNum) return;
   
-  ChartItem item = chart[chartPosition][itemNum];
+  if (word < 0) return;
   
-  if (!terminals.contains (word)) return;
+  int ruleNum = chart[chartPosition][itemNum].rule;
+  int nextElement = chart[chartPosition][itemNum].nextElement;
+  int end = chart[chartPosition][itemNum].end;
   
-  if (item.rhs.size () <= item.nextElement)  {
+  if (rules[ruleNum].rhs.size () <= nextElement)  {
     cout << "Error: Illegal chart item" << endl;
     return;
   }
   
-  QString nextElement = item.rhs[item.nextElement];
+  QHash< QPair<int, int>, int >::const_iterator i = 
+    terminals.constFind (qMakePair (rules[ruleNum].rhs[nextElement], word));
+  
+  if (i == terminals.constEnd ()) return;
   
 //  QTextStream terminal (stdout);
-//  terminal << stringChartItem (item) << endl;
+//  terminal << stringChartItem (chart[chartPosition][itemNum]) << endl;
   
-  if (terminals[word].contains (nextElement) &&
-      (item.context == "" || ("\"" + item.context + "\"") == next))  {
+  if (rules[ruleNum].context == -1 || rules[ruleNum].context == next)  {
     ChartItem newItem;
-    newItem.lhs = nextElement;
-    newItem.rhs = QStringList (word);
+    newItem.rule = i.value ();
     newItem.nextElement = 1;
-    newItem.start = item.end;
-    newItem.end = item.end + 1;
-    newItem.context = "";
+    newItem.start = end;
+    newItem.end = end + 1;
     
-    addChartItem (newItem, item.end + 1);
+    addChartItem (newItem, end + 1);
   }
   
 //  cout << "Ran scanner" << endl;
 //  printChart ();
 }
 
-void EarleyParser::runCompleter (int chartPosition, int itemNum, QString next)  {
+void EarleyParser::runCompleter (int chartPosition, int itemNum, int next)  {
   if (chart.size () <= chartPosition) return;
   if (chart[chartPosition].size () <= itemNum) return;
   
-  ChartItem item = chart[chartPosition][itemNum];
+  int lhs = rules[chart[chartPosition][itemNum].rule].lhs;
+  int start = chart[chartPosition][itemNum].start;
+  int end = chart[chartPosition][itemNum].end;
   
-  if (chart.size () <= item.start)  {
+  if (chart.size () <= start)  {
     cout << "Error: chart not big enough for completer" << endl;
     return;
   }
   
 //  QTextStream terminal (stdout);
-//  terminal << stringChartItem (item) << endl;
+//  terminal << stringChartItem (chart[chartPosition][itemNum]) << endl;
   
-  for (int x = 0; x < chart[item.start].size (); x++)  {
-    ChartItem checkItem = chart[item.start][x];
+  if (!waiting[start].contains (lhs)) return;
+  
+  // only items whose next symbol is lhs can be advanced; the list may grow
+  // while we walk it if start and end are the same column
+  for (int x = 0; x < waiting[start][lhs].size (); x++)  {
+    int checkNum = waiting[start][lhs][x];
+    
+    const ChartItem &checkItem = chart[start][checkNum];
+    const CompiledRule &checkRule = rules[checkItem.rule];
+    
+//    terminal << stringChartItem (checkItem) << ", " << next << endl;
     
-    if (checkItem.rhs.size () <= checkItem.nextElement)
+    if (checkRule.context != -1 && checkRule.context != next)
       continue;
     
-    QString nextElement = checkItem.rhs[checkItem.nextElement];
+    ChartItem newItem;
+    newItem.rule = checkItem.rule;
+    newItem.nextElement = checkItem.nextElement + 1;
+    newItem.start = checkItem.start;
+    newItem.end = end;
     
-//    terminal << stringChartItem (checkItem) << ", " << next << endl;
+    Derivation derivation;
+    derivation.previous.position = start;
+    derivation.previous.item = checkNum;
+    derivation.child.position = chartPosition;
+    derivation.child.item = itemNum;
+    newItem.derivations.append (derivation);
     
-    if (nextElement == item.lhs && 
-        (checkItem.context == "" || ("\""+ checkItem.context + "\"") == next))  {      
-      ChartItem newItem;
-      newItem.lhs = checkItem.lhs;
-      newItem.rhs = checkItem.rhs;
-      newItem.nextElement = checkItem.nextElement + 1;
-      newItem.start = checkItem.start;
-      newItem.end = item.end;
-      newItem.context = checkItem.context;
-      newItem.backPointers = checkItem.backPointers;
-      BackPointer newBackPointer;
-      newBackPointer.position = chartPosition;
-      newBackPointer.item = itemNum;
-      newItem.backPointers.append (newBackPointer);
-      
-      addChartItem (newItem, item.end);
-    }
+    addChartItem (newItem, end);
   }
   
 //  cout << "Ran completer" << endl;
@@ -340,57 +589,80 @@ void EarleyParser::printChart ()  {
 }
 
 QString EarleyParser::stringChartItem (ChartItem item)  {
-  QString text = item.lhs + " ->";
+  const CompiledRule &rule = rules[item.rule];
+  QString text = symbolNames[rule.lhs] + " ->";
   
-  for (int x = 0; x < item.rhs.size (); x++)  {
+  for (int x = 0; x < rule.rhs.size (); x++)  {
     text += " ";
     
     if (item.nextElement == x)
       text += ". ";
     
-    text += item.rhs[x];
+    text += symbolNames[rule.rhs[x]];
   }
   
-  if (item.nextElement == item.rhs.size ())
+  if (item.nextElement == rule.rhs.size ())
     text += " .";
   
-  if (item.context != "")
-    text += " | " + item.context;
+  if (rule.context != -1)
+    text += " | " + symbolNames[rule.context];
   
   text += " [" + QString::number (item.start) + ", " + 
           QString::number (item.end) + "]";
           
-  for (int x = 0; x < item.backPointers.size (); x++)
-    text += " [" + QString::number (item.backPointers[x].position) +
-            ", " + QString::number (item.backPointers[x].item) + "]";
+  for (int x = 0; x < item.derivations.size (); x++)
+    text += " {[" + QString::number (item.derivations[x].previous.position) +
+            ", " + QString::number (item.derivations[x].previous.item) + "] [" +
+            QString::number (item.derivations[x].child.position) +
+            ", " + QString::number (item.derivations[x].child.item) + "]}";
           
   return text;
 }
 
+// Items are identified by rule, dot and start, packed into a single value;
+// the end is implied by the column.  Derivations are not part of an item's
+// identity.
+uint EarleyParser::hashChartItem (const ChartItem &item)  {
+  return qHash (((quint64)item.rule << 32) | 
+                ((quint64)item.nextElement << 16) | (quint64)item.start);
+}
+
+bool EarleyParser::sameChartItem (const ChartItem &a, const ChartItem &b)  {
+  return (a.rule == b.rule && a.nextElement == b.nextElement && 
+          a.start == b.start && a.end == b.end);
+}
+
 void EarleyParser::addChartItem (ChartItem item, int position)  {
-  while (chart.size () <= position)
+  while (chart.size () <= position)  {
     chart.append (QList<ChartItem> ());
+    chartIndex.append (QMultiHash<uint, int> ());
+    predicted.append (QSet<int> ());
+    waiting.append (QHash<int, QList<int> > ());
+  }
   
-  for (int x = 0; x < chart[position].size (); x++)
-    if (item.lhs == chart[position][x].lhs && item.rhs == chart[position][x].rhs
-        && item.nextElement == chart[position][x].nextElement 
-        && item.start == chart[position][x].start 
-        && item.end == chart[position][x].end 
-        && item.context == chart[position][x].context)  {
-      bool sameBP = true;
-    
-      if (item.backPointers.size () != chart[position][x].backPointers.size ())
-        continue;
-      
-      for (int b = 0; b < item.backPointers.size (); b++)
-        if (item.backPointers[b].position != 
-            chart[position][x].backPointers[b].position ||
-            item.backPointers[b].item !=
-            chart[position][x].backPointers[b].item)
-          sameBP = false;
-        
-      if (sameBP) return;
+  uint h = hashChartItem (item);
+  
+  // an item found again is packed: it only gains the new derivation, since
+  // each pair of items is completed together just once
+  QMultiHash<uint, int>::const_iterator i = chartIndex[position].constFind (h);
+  while (i != chartIndex[position].constEnd () && i.key () == h)  {
+    if (sameChartItem (item, chart[position][i.value ()]))  {
+      chart[position][i.value ()].derivations += item.derivations;
+      return;
     }
     
+    ++i;
+  }
+  
+  item.codas = 0;
+  item.contexts = 0;
+  item.best = -1;
+  item.scored = UNSCORED;
+  
+  const CompiledRule &rule = rules[item.rule];
+  if (item.nextElement < rule.rhs.size ())
+    waiting[position][rule.rhs[item.nextElement]].append (chart[position].size ());
+  
+  chartIndex[position].insert (h, chart[position].size ());
   chart[position].append (item);
 }
\ No newline at end of file
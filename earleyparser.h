@@ -4,7 +4,10 @@
 #include <QString>
 #include <QList>
 #include <QStringList>
-#include <QMap>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QSet>
 
 typedef struct Rule_s  {
   QString lhs;
@@ -12,19 +15,43 @@ typedef struct Rule_s  {
   QString context;
 } Rule;
 
+// Rule with every symbol interned to an index into EarleyParser::symbolNames.
+// Context is the symbol of the terminal that must follow, or -1 for none.
+typedef struct CompiledRule_s  {
+  int lhs;
+  QVector<int> rhs;
+  int context;
+} CompiledRule;
+
 typedef struct BackPointer_s  {
   int position;
   int item;
 } BackPointer;
 
+// One way of deriving a chart item: the item one symbol short of it, and the
+// completed item for that symbol
+typedef struct Derivation_s  {
+  BackPointer previous;
+  BackPointer child;
+} Derivation;
+
+// Chart items only refer to their rule; lhs, rhs and context are looked up
+// in EarleyParser::rules.  Together the items form a shared packed parse
+// forest: an item is only added once for its rule, dot, start and end, and
+// keeps every derivation found for it.  Predicted and scanned items have
+// none.  Once the chart is done, scoreChartItem fills in the Coda nodes and
+// contextual rules in the best subtree under the item, and which derivation
+// gives it.
 typedef struct ChartItem_s  {
-  QString lhs;
-  QStringList rhs;
+  int rule;
   int nextElement;
   int start;
   int end;
-  QList<BackPointer> backPointers;
-  QString context;
+  QList<Derivation> derivations;
+  int codas;
+  int contexts;
+  int best;
+  int scored;
 } ChartItem;
 
 typedef struct TreeNode_s  {
@@ -38,31 +65,59 @@ class EarleyParser  {
   public:
     EarleyParser ();
     void setRules (QList<Rule>);
+    void addRules (QList<Rule>);
+    void removeRules (QString);
+    void replaceRules (QString, QList<Rule>);
     void setIgnored (QString);
     
     TreeNode parse (QString);
+    TreeNode parse (QVector<int>);
+    QVector<int> tokenize (QString);
     
     QString stringTreeNode (TreeNode);
     
   private:
-    QList<Rule> nonterminals;
-    QStringList preterminals;
-    QMap<QString, QStringList> terminals;
+    // compiled grammar
+    QHash<QString, int> symbolTable;
+    QStringList symbolNames;
+    QList<CompiledRule> rules;
+    // source form of every rule compiled so far, to skip duplicates
+    QSet<QString> knownRules;
+    QList<int> nonterminals;
+    // symbol -> nonterminal rules with that lhs, in grammar order
+    QVector< QList<int> > predictions;
+    QVector<bool> preterminals;
+    QHash< QPair<int, int>, int > terminals;
+    int topRule;
+    int codaSymbol;
+    
     QString ignored;
     QList< QList<ChartItem> > chart;
+    // per column, item hash -> item numbers, for duplicate checks
+    QList< QMultiHash<uint, int> > chartIndex;
+    // per column, symbols which have already been predicted there
+    QList< QSet<int> > predicted;
+    // per column, next expected symbol -> item numbers waiting on it
+    QList< QHash<int, QList<int> > > waiting;
+    
+    int internSymbol (QString);
+    void compileRule (Rule);
+    void indexRules ();
     
+    int scoreChartItem (int, int);
+    int compareTrees (BackPointer, bool, BackPointer, bool);
     TreeNode getTreeNode (int, int);
-    int countCodas (TreeNode);
-    int countContexts (TreeNode);
     
     void runPredictor (int, int);
-    void runScanner (int, int, QString, QString);
-    void runCompleter (int, int, QString);
+    void runScanner (int, int, int, int);
+    void runCompleter (int, int, int);
     
     void printRule (Rule);
     void printChart ();
     QString stringChartItem (ChartItem);
     
+    uint hashChartItem (const ChartItem&);
+    bool sameChartItem (const ChartItem&, const ChartItem&);
     void addChartItem (ChartItem, int);
 };
 
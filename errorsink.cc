@@ -0,0 +1,55 @@
+#include <QTextStream>
+#include <QMutexLocker>
+
+#include "errorsink.h"
+
+ErrorSink::~ErrorSink ()  {
+
+}
+
+StreamErrorSink::StreamErrorSink (QTextStream *o, int l)  {
+  out = o;
+  limit = l;
+  errors = 0;
+}
+
+void StreamErrorSink::report (QString message)  {
+  QMutexLocker locker (&mutex);
+
+  if (errors++ < limit)
+    *out << "error: " << message << endl;
+}
+
+int StreamErrorSink::count ()  {
+  QMutexLocker locker (&mutex);
+  return errors;
+}
+
+// Errors past the limit, which were counted but not written
+int StreamErrorSink::unwritten ()  {
+  QMutexLocker locker (&mutex);
+  return qMax (errors - limit, 0);
+}
+
+ListErrorSink::ListErrorSink (int l)  {
+  limit = l;
+  errors = 0;
+}
+
+void ListErrorSink::report (QString message)  {
+  QMutexLocker locker (&mutex);
+
+  if (errors++ < limit)
+    kept.append (message);
+}
+
+int ListErrorSink::count ()  {
+  QMutexLocker locker (&mutex);
+  return errors;
+}
+
+// The errors within the limit, oldest first
+QStringList ListErrorSink::messages ()  {
+  QMutexLocker locker (&mutex);
+  return kept;
+}
@@ -0,0 +1,53 @@
+#ifndef ERRORSINK_H
+#define ERRORSINK_H
+
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+class QTextStream;
+
+// Where CDICDatabase::reportError sends the database's error messages
+class ErrorSink  {
+  public:
+    virtual ~ErrorSink ();
+
+    virtual void report (QString) = 0;
+};
+
+// Writes errors to a stream, up to a limit, and counts every one, so that a
+// bulk job with thousands of bad rows neither stops nor floods its log.
+// Errors can come from any thread.
+class StreamErrorSink : public ErrorSink  {
+  public:
+    StreamErrorSink (QTextStream*, int = 100);
+
+    void report (QString);
+    int count ();
+    int unwritten ();
+
+  private:
+    QTextStream *out;
+    int limit;
+    int errors;
+    QMutex mutex;
+};
+
+// Keeps errors, up to a limit, for the caller to show once a job is done,
+// and counts every one
+class ListErrorSink : public ErrorSink  {
+  public:
+    ListErrorSink (int = 100);
+
+    void report (QString);
+    int count ();
+    QStringList messages ();
+
+  private:
+    QStringList kept;
+    int limit;
+    int errors;
+    QMutex mutex;
+};
+
+#endif
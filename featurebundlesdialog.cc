@@ -137,14 +137,14 @@ void FeatureBundlesDialog::initFeatureSetDialog ()  {
   featureBoxModel = db.getFeatureListModel (domain, ALLSUBS);
   subfeatureBoxModel = db.getSubfeatureModel (domain, QString ());
   
-  QString sb = db.getValue ("SquareBrackets");
+  bool sb = db.getFlag (SQUARE_BRACKETS);
   
   QString label = "Edit Features of ";
   
   if (domain == PHONEME)  {
-    label += (sb == "true") ? "[" : "/";
+    label += sb ? "[" : "/";
     label += db.getPhonemeName (id);
-    label += (sb == "true") ? "]" : "/";
+    label += sb ? "]" : "/";
   }
   
   else label += db.getWordName (id);
@@ -6,9 +6,22 @@
 #include <QMessageBox>
 
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "cdicdatabase.h"
+#include "dialogerrorsink.h"
 
 int main (int argc, char *argv[])  {
+  if (argc > 1 && (QString)argv[1] == "--benchmark")  {
+    QCoreApplication app (argc, argv);
+    QTextStream out (stdout);
+    Benchmark benchmark (&out);
+    benchmark.run (app.arguments ().mid (2));
+    return 0;
+  }
+  
   QApplication app (argc, argv);
+  DialogErrorSink errorSink;
+  CDICDatabase::setErrorSink (&errorSink);
   QFont font ("DejaVu Sans", 8);
   QString path = ".";
   QString filename = argc > 1 ? argv[1] : "";
@@ -2,16 +2,22 @@
 #include <QMenu>
 #include <QMenuBar>
 #include <QAction>
+#include <QActionGroup>
 #include <QFileDialog>
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QFontDialog>
 #include <QTextStream>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
 
 #include <iostream>
 using namespace std;
 
 #include "mainwindow.h"
+#include "queryprofiler.h"
 
 MainWindow::MainWindow ()  {
   dictionary = new Dictionary ();
@@ -32,6 +38,8 @@ MainWindow::MainWindow ()  {
            SLOT (updateBrackets (bool)));
   connect (dictionary, SIGNAL (unicodeUpdated (bool)), this,
            SLOT (updateUnicode (bool)));
+  connect (dictionary, SIGNAL (profileUpdated (QString)), this,
+           SLOT (updateProfile (QString)));
 }
 
 void MainWindow::setPath (QString p)  {
@@ -232,7 +240,6 @@ void MainWindow::setFont ()  {
 void MainWindow::setLanguageName ()  {
   QString name = QInputDialog::getText (this, "Language Name", "Enter the name of your language.");
   dictionary->setValue (LANGUAGE_NAME, name);
-  updateWindowTitle (name);
 }
 
 void MainWindow::setBrackets (bool b)  {
@@ -273,6 +280,43 @@ void MainWindow::setPath ()  {
                             "The default path has been set to " + path);
 }
 
+void MainWindow::setProfile (QAction *action)  {
+  dictionary->setProfile (action->data ().toString ());
+}
+
+void MainWindow::setProfiling (bool b)  {
+  QueryProfiler::setEnabled (b);
+}
+
+void MainWindow::setExplainScans (bool b)  {
+  QueryProfiler::setExplainScans (b);
+}
+
+void MainWindow::showQueryProfile ()  {
+  QDialog dialog (this);
+  dialog.setWindowTitle ("Query Profile");
+  
+  QPlainTextEdit *text = new QPlainTextEdit (QueryProfiler::report ());
+  text->setReadOnly (true);
+  text->setLineWrapMode (QPlainTextEdit::NoWrap);
+  text->setFont (QFont ("Courier"));
+  
+  QDialogButtonBox *buttons = new QDialogButtonBox (QDialogButtonBox::Close);
+  connect (buttons, SIGNAL (rejected ()), &dialog, SLOT (reject ()));
+  
+  QVBoxLayout *layout = new QVBoxLayout;
+  layout->addWidget (text);
+  layout->addWidget (buttons);
+  dialog.setLayout (layout);
+  dialog.resize (800, 500);
+  
+  dialog.exec ();
+}
+
+void MainWindow::resetQueryProfile ()  {
+  QueryProfiler::reset ();
+}
+
 void MainWindow::updateWindowTitle (QString languageName)  {
   setWindowTitle (languageName + " Dictionary");
 }
@@ -285,6 +329,13 @@ void MainWindow::updateUnicode (bool b)  {
   unicodeAct->setChecked (b);
 }
 
+// Dictionaries that never chose a profile use the safe one
+void MainWindow::updateProfile (QString profile)  {
+  if (profile == PROFILE_INTERACTIVE)
+    interactiveAct->setChecked (true);
+  else safeAct->setChecked (true);
+}
+
 void MainWindow::createActions ()  {
   newAct = new QAction ("&New Dictionary", this);
   newAct->setShortcuts (QKeySequence::New);
@@ -362,6 +413,42 @@ void MainWindow::createActions ()  {
   pathAct = new QAction ("Set Default Path", this);
   pathAct->setStatusTip ("Set the default path for saving and loading");
   connect (pathAct, SIGNAL (triggered ()), this, SLOT (setPath ()));
+  
+  safeAct = new QAction ("Safe", this);
+  safeAct->setStatusTip ("Wait for the disk after every change");
+  safeAct->setData (PROFILE_SAFE);
+  
+  interactiveAct = new QAction ("Interactive", this);
+  interactiveAct->setStatusTip ("Use a write-ahead log and a larger cache; not for network drives");
+  interactiveAct->setData (PROFILE_INTERACTIVE);
+  
+  profileGroup = new QActionGroup (this);
+  profileGroup->addAction (safeAct);
+  profileGroup->addAction (interactiveAct);
+  
+  for (int x = 0; x < profileGroup->actions ().size (); x++)
+    profileGroup->actions ()[x]->setCheckable (true);
+  
+  safeAct->setChecked (true);
+  connect (profileGroup, SIGNAL (triggered (QAction*)), this, SLOT (setProfile (QAction*)));
+  
+  profileAct = new QAction ("Profile Queries", this);
+  profileAct->setStatusTip ("Count and time every database query");
+  profileAct->setCheckable (true);
+  connect (profileAct, SIGNAL (toggled (bool)), this, SLOT (setProfiling (bool)));
+  
+  explainAct = new QAction ("Explain Full Table Scans", this);
+  explainAct->setStatusTip ("Log the query plan of profiled queries that read a whole table");
+  explainAct->setCheckable (true);
+  connect (explainAct, SIGNAL (toggled (bool)), this, SLOT (setExplainScans (bool)));
+  
+  showProfileAct = new QAction ("Show Query Profile", this);
+  showProfileAct->setStatusTip ("Show the counts and times of the queries profiled");
+  connect (showProfileAct, SIGNAL (triggered ()), this, SLOT (showQueryProfile ()));
+  
+  resetProfileAct = new QAction ("Reset Query Profile", this);
+  resetProfileAct->setStatusTip ("Forget the queries profiled so far");
+  connect (resetProfileAct, SIGNAL (triggered ()), this, SLOT (resetQueryProfile ()));
 }
 
 void MainWindow::createMenus ()  {
@@ -392,4 +479,13 @@ void MainWindow::createMenus ()  {
   settingsMenu->addAction (bracketsAct);
   settingsMenu->addAction (unicodeAct);
   settingsMenu->addAction (pathAct);
+  
+  profileMenu = settingsMenu->addMenu ("Database Profile");
+  profileMenu->addActions (profileGroup->actions ());
+  
+  debugMenu = menuBar ()->addMenu ("Debug");
+  debugMenu->addAction (profileAct);
+  debugMenu->addAction (explainAct);
+  debugMenu->addAction (showProfileAct);
+  debugMenu->addAction (resetProfileAct);
 }
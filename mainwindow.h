@@ -7,6 +7,7 @@
 
 class QMenu;
 class QAction;
+class QActionGroup;
 
 class MainWindow : public QMainWindow {
   Q_OBJECT
@@ -39,10 +40,17 @@ class MainWindow : public QMainWindow {
     void setBrackets (bool);
     void setUnicode (bool);
     void setPath ();
+    void setProfile (QAction*);
+    
+    void setProfiling (bool);
+    void setExplainScans (bool);
+    void showQueryProfile ();
+    void resetQueryProfile ();
     
     void updateWindowTitle (QString);
     void updateBrackets (bool);
     void updateUnicode (bool);
+    void updateProfile (QString);
 
   private:
     void createActions ();
@@ -55,6 +63,8 @@ class MainWindow : public QMainWindow {
     QMenu *importMenu;
     QMenu *exportMenu;
     QMenu *settingsMenu;
+    QMenu *profileMenu;
+    QMenu *debugMenu;
     
     QAction *newAct;
     QAction *openAct;
@@ -78,6 +88,15 @@ class MainWindow : public QMainWindow {
     QAction *bracketsAct;
     QAction *unicodeAct;
     QAction *pathAct;
+    
+    QActionGroup *profileGroup;
+    QAction *safeAct;
+    QAction *interactiveAct;
+    
+    QAction *profileAct;
+    QAction *explainAct;
+    QAction *showProfileAct;
+    QAction *resetProfileAct;
 };
 
 #endif
\ No newline at end of file
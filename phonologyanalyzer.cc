@@ -0,0 +1,231 @@
+#include "const.h"
+
+#include "phonologyanalyzer.h"
+#include "cdicdatabase.h"
+
+PhonologyAnalyzer::PhonologyAnalyzer ()  {}
+
+void PhonologyAnalyzer::load (CDICDatabase &db)  {
+  phonemes = db.getPhonemesAndSpellings ();
+  diacriticSupras = db.getDiacriticSupras ();
+  beforeSupras = db.getBeforeSupras ();
+  afterSupras = db.getAfterSupras ();
+  doubledSupras = db.getDoubledSupras ();
+
+  parser.setRules (db.getParsingGrammar ());
+  parser.setIgnored (db.getValue (IGNORED_CHARACTERS));
+}
+
+// Patches the grammar after the spellings of one phoneme change
+void PhonologyAnalyzer::updatePhoneme (CDICDatabase &db, QString phoneme)  {
+  phonemes[phoneme] = db.getSpellingText (phoneme).split (' ', QString::SkipEmptyParts);
+  
+  parser.replaceRules ("Phon" + phoneme, db.getPhonemeGrammar (phoneme));
+}
+
+// Patches the grammar after a phoneme-domain supra changes; syllable-domain
+// supras touch every phoneme and need a full load instead.
+void PhonologyAnalyzer::updateSupra (CDICDatabase &db, QString supra)  {
+  diacriticSupras = db.getDiacriticSupras ();
+  beforeSupras = db.getBeforeSupras ();
+  afterSupras = db.getAfterSupras ();
+  doubledSupras = db.getDoubledSupras ();
+  
+  QStringList applies = db.getSupraApplies (supra);
+  
+  for (int x = 0; x < applies.size (); x++)
+    parser.replaceRules ("Phon" + applies[x], db.getPhonemeGrammar (applies[x]));
+}
+
+QList<Syllable> PhonologyAnalyzer::analyze (QString word)  {
+  return convertTree (parser.parse (word));
+}
+
+QList<Syllable> PhonologyAnalyzer::convertTree (TreeNode node)  {
+  QList<Syllable> syllList;
+  QList<TreeNode> treeList;
+  
+  TreeNode currentS;
+  
+  for (int x = 0; x < node.children.size (); x++)
+    if (node.children[x].label == "S")  {
+      currentS = node.children[x];
+      break;
+    }
+  
+  // break into syllables
+  while (true)  {
+    int x = 0;
+    int children = currentS.children.size ();
+    
+    for (; x < children; x++)
+      if (currentS.children[x].label == "Syll")  {
+        treeList.append (currentS.children[x]);
+        break;
+      }
+      
+    for (x = 0; x < children; x++)
+      if (currentS.children[x].label == "S")  {
+        currentS = currentS.children[x];
+        break;
+      }
+      
+    if (x == children)
+      break;
+  }
+  
+  // for each syllable
+  for (int x = 0; x < treeList.size (); x++)  {
+    Syllable s;
+    syllList.append (s);
+    
+    TreeNode syll = treeList[x];
+    
+    // deal with before and after supras
+    while (true)  {
+      QString beforeText = "";
+      QString afterText = "";
+      bool subSyllFound = false;
+      
+      for (int c = 0; c < syll.children.size (); c++)  {
+        if (syll.children[c].label == "Syll")  {
+          subSyllFound = true;
+          continue;
+        }
+        
+        if (subSyllFound && syll.children[c].label.startsWith ("Char"))
+          afterText.append (syll.children[c].payload);
+        else if (syll.children[c].label.startsWith ("Char"))
+          beforeText.append (syll.children[c].payload);
+      }
+               
+      if (!subSyllFound) break;
+      
+      if (beforeText != "")
+        for (int s = 0; s < beforeSupras.size (); s++)  {    
+          if (beforeSupras[s].domain == SUPRA_DOMAIN_SYLL &&
+              beforeSupras[s].text == beforeText)  {
+            syllList[x].supras.append (beforeSupras[s].name);
+            break;
+          }
+        }
+          
+      if (afterText != "")
+        for (int s = 0; s < afterSupras.size (); s++)
+          if (afterSupras[s].domain == SUPRA_DOMAIN_SYLL &&
+              afterSupras[s].text == afterText)  {
+            syllList[x].supras.append (afterSupras[s].name);
+          }
+          
+      for (int c = 0; c < syll.children.size (); c++)
+        if (syll.children[c].label == "Syll")
+          syll = syll.children[c];
+    }
+    
+    // for each segment
+    for (int loc = ONSET; loc <= CODA; loc++)  {
+      QString label;
+      if (loc == ONSET) label = "Onset";
+      else if (loc == PEAK) label = "Peak";
+      else label = "Coda";
+      
+      TreeNode segment;
+      for (int c = 0; c < syll.children.size (); c++)
+        if (syll.children[c].label == label)
+          segment = syll.children[c];
+        
+      // for each phoneme
+      for (int c = 0; c < segment.children.size (); c++)  {
+        if (segment.children[c].children.size () == 0) 
+          continue;
+        
+        TreeNode phonNode = segment.children[c].children[0];
+        if (!phonNode.label.startsWith ("Phon"))
+          continue;
+        
+        Phoneme p;
+        p.name = phonNode.label.remove (0, 4);
+        
+        // deal with before and after supras
+        while (true)  {
+          QString beforeText = "";
+          QString afterText = "";
+          bool subPhonFound = false;
+          
+          for (int c = 0; c < phonNode.children.size (); c++)  { 
+            if (phonNode.children[c].label.startsWith ("Phon"))  {
+              subPhonFound = true;
+              continue;
+            }
+        
+            if (subPhonFound) afterText.append (phonNode.children[c].payload);
+            else beforeText.append (phonNode.children[c].payload);
+          }
+          
+          if (!subPhonFound) break;
+      
+          if (beforeText != "")
+            for (int s = 0; s < beforeSupras.size (); s++)  {
+              if (beforeSupras[s].domain == SUPRA_DOMAIN_PHON &&
+                  beforeSupras[s].text == beforeText)  {
+                p.supras.append (beforeSupras[s].name);
+                break;
+              }
+            }
+          
+          if (afterText != "")
+            for (int s = 0; s < afterSupras.size (); s++)
+              if (afterSupras[s].domain == SUPRA_DOMAIN_PHON &&
+                  afterSupras[s].text == afterText)  {
+                p.supras.append (afterSupras[s].name);
+              }
+              
+          for (int c = 0; c < phonNode.children.size (); c++)
+            if (phonNode.children[c].label.startsWith ("Phon"))
+              phonNode = phonNode.children[c];
+        }
+        
+        QString spelling = "";
+        for (int c = 0; c < phonNode.children.size (); c++)
+          spelling.append (phonNode.children[c].payload);
+        
+        if (!phonemes[p.name].contains (spelling))  {
+          for (int sp = 0; sp < phonemes[p.name].size (); sp++)
+            if (spelling == phonemes[p.name][sp] + phonemes[p.name][sp])
+              for (int s = 0; s < doubledSupras.size (); s++)  {
+                if (doubledSupras[s].domain == SUPRA_DOMAIN_PHON)  {
+                  p.supras.append (doubledSupras[s].name);
+                  break;
+                }
+                
+                else if (loc == PEAK)  {
+                  syllList[x].supras.append (doubledSupras[s].name);
+                  break;
+                }
+              }
+              
+          for (int sp = 0; sp < phonemes[p.name].size (); sp++)
+            for (int s = 0; s < diacriticSupras.size (); s++)  {
+              if (spelling == CDICDatabase::applyDiacritic (diacriticSupras[s].type, phonemes[p.name][sp]))  {
+                if (diacriticSupras[s].domain == SUPRA_DOMAIN_PHON)  {
+                  p.supras.append (diacriticSupras[s].name);
+                  break;
+                }
+                
+                else if (loc == PEAK)  {
+                  syllList[x].supras.append (diacriticSupras[s].name);
+                  break;
+                }
+              }
+            }
+        }
+        
+        if (loc == ONSET) syllList[x].onset.append (p);
+        else if (loc == PEAK) syllList[x].peak.append (p);
+        else syllList[x].coda.append (p);
+      }
+    }
+  }
+  
+  return syllList;
+}
\ No newline at end of file
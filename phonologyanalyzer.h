@@ -0,0 +1,36 @@
+#ifndef PHONOLOGYANALYZER_H
+#define PHONOLOGYANALYZER_H
+
+#include <QMap>
+#include <QList>
+#include <QStringList>
+
+#include "const.h"
+#include "earleyparser.h"
+
+class CDICDatabase;
+
+// Works out the phonology of a word from its spelling, using the grammar,
+// spellings and suprasegmentals of a dictionary.  It keeps no reference to
+// the database once loaded, so copies can be handed to other threads.
+class PhonologyAnalyzer  {
+  public:
+    PhonologyAnalyzer ();
+    
+    void load (CDICDatabase&);
+    void updatePhoneme (CDICDatabase&, QString);
+    void updateSupra (CDICDatabase&, QString);
+    QList<Syllable> analyze (QString);
+    
+  private:
+    QList<Syllable> convertTree (TreeNode);
+    
+    EarleyParser parser;
+    QMap<QString, QStringList> phonemes;
+    QList<Suprasegmental> diacriticSupras;
+    QList<Suprasegmental> beforeSupras;
+    QList<Suprasegmental> afterSupras;
+    QList<Suprasegmental> doubledSupras;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include <QSqlError>
+#include <QVariant>
+
+#include "phonologyiterator.h"
+#include "cdicdatabase.h"
+#include "queryprofiler.h"
+
+// wordIDs is anything that can go inside "id in (...)"; empty means all words
+PhonologyIterator::PhonologyIterator (QSqlDatabase db, QString wordIDs)  {
+  QString where = "";
+  if (!wordIDs.isEmpty ())
+    where = " where wordID in (" + wordIDs + ")";
+
+  currentID = -1;
+
+  words = QSqlQuery (db);
+  ok = exec (words, "select id from Word" +
+                    (wordIDs.isEmpty () ? QString ("") : " where id in (" + wordIDs + ")") +
+                    " order by id");
+
+  QStringList tables;
+  tables << "Onset" << "Peak" << "Coda";
+
+  for (int t = 0; t < 3; t++)  {
+    segments[t] = QSqlQuery (db);
+    ok = ok && exec (segments[t], "select wordID, syllNum, ind, name from " + tables[t] +
+                                  " join Phoneme on phonemeID == id" + where +
+                                  " order by wordID, syllNum, ind");
+
+    segmentSupras[t] = QSqlQuery (db);
+    ok = ok && exec (segmentSupras[t], "select wordID, syllNum, ind, name from " + tables[t] +
+                                       "Supra join Suprasegmental on supraID == id" + where +
+                                       " order by wordID, syllNum, ind, supraID");
+  }
+
+  syllableSupras = QSqlQuery (db);
+  ok = ok && exec (syllableSupras, "select wordID, syllNum, name from SyllableSupra " +
+                                   (QString)"join Suprasegmental on supraID == id" + where +
+                                   " order by wordID, syllNum, supraID");
+}
+
+bool PhonologyIterator::exec (QSqlQuery &query, QString statement)  {
+  query.setForwardOnly (true);
+
+  if (!QueryProfiler::exec (query, statement))  {
+    CDICDatabase::reportError (query.executedQuery () + "\n" + query.lastError ().text ());
+    QueryProfiler::finish (query);
+    return false;
+  }
+
+  // the segment queries are kept one row ahead of the word being read
+  if (&query != &words)
+    QueryProfiler::next (query);
+
+  return true;
+}
+
+// Moves to the next word; false once every word has been read
+bool PhonologyIterator::next ()  {
+  current.clear ();
+
+  if (!ok || !QueryProfiler::next (words))  {
+    currentID = -1;
+    return false;
+  }
+
+  currentID = words.value (0).toInt ();
+
+  for (int t = 0; t < 3; t++)  {
+    // phonemes first, so that their supras have somewhere to go
+    while (segments[t].isValid () && segments[t].value (0).toInt () <= currentID)  {
+      if (segments[t].value (0).toInt () == currentID)
+        phonemeAt (current, segments[t].value (1).toInt (), t,
+                   segments[t].value (2).toInt ()).name = segments[t].value (3).toString ();
+
+      QueryProfiler::next (segments[t]);
+    }
+
+    while (segmentSupras[t].isValid () && segmentSupras[t].value (0).toInt () <= currentID)  {
+      if (segmentSupras[t].value (0).toInt () == currentID)
+        phonemeAt (current, segmentSupras[t].value (1).toInt (), t,
+                   segmentSupras[t].value (2).toInt ())
+          .supras.append (segmentSupras[t].value (3).toString ());
+
+      QueryProfiler::next (segmentSupras[t]);
+    }
+  }
+
+  while (syllableSupras.isValid () && syllableSupras.value (0).toInt () <= currentID)  {
+    if (syllableSupras.value (0).toInt () == currentID)  {
+      int syllNum = syllableSupras.value (1).toInt ();
+
+      while (current.size () <= syllNum)
+        current.append (Syllable ());
+
+      current[syllNum].supras.append (syllableSupras.value (2).toString ());
+    }
+
+    QueryProfiler::next (syllableSupras);
+  }
+
+  return true;
+}
+
+int PhonologyIterator::wordID ()  {
+  return currentID;
+}
+
+QList<Syllable> PhonologyIterator::phonology ()  {
+  return current;
+}
+
+// Pads the syllable list and the onset, peak or coda out to the position
+Phoneme &PhonologyIterator::phonemeAt (QList<Syllable> &syllList, int syllNum,
+                                       int part, int ind)  {
+  while (syllList.size () <= syllNum)
+    syllList.append (Syllable ());
+
+  QList<Phoneme> &phonemes = (part == 0 ? syllList[syllNum].onset :
+                              (part == 1 ? syllList[syllNum].peak :
+                                           syllList[syllNum].coda));
+
+  while (phonemes.size () <= ind)
+    phonemes.append (Phoneme ());
+
+  return phonemes[ind];
+}
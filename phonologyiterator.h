@@ -0,0 +1,35 @@
+#ifndef PHONOLOGYITERATOR_H
+#define PHONOLOGYITERATOR_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QList>
+
+#include "const.h"
+
+// Walks the phonologies of many words in order of id.  There is one ordered
+// query per segment table, and each call to next () merges in the rows of a
+// single word, so only that word's phonology is held in memory.
+class PhonologyIterator  {
+  public:
+    PhonologyIterator (QSqlDatabase, QString wordIDs = QString ());
+
+    bool next ();
+    int wordID ();
+    QList<Syllable> phonology ();
+
+  private:
+    bool exec (QSqlQuery&, QString);
+    static Phoneme &phonemeAt (QList<Syllable>&, int, int, int);
+
+    QSqlQuery words;
+    QSqlQuery segments[3];
+    QSqlQuery segmentSupras[3];
+    QSqlQuery syllableSupras;
+
+    bool ok;
+    int currentID;
+    QList<Syllable> current;
+};
+
+#endif
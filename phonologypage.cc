@@ -368,17 +368,27 @@ void PhonologyPage::submitChanges ()  {
   if (!mapper) return;
   
   QModelIndex index = phonemeListView->selectionModel ()->currentIndex ();
+  QString oldName = displayModel->record (mapper->currentIndex ()).value ("name").toString ();
+  QString name = phonemeNameEdit->text ();
+  QStringList oldSpellings = db.getSpellingText (oldName).split (' ', QString::SkipEmptyParts);
+  QStringList newSpellings = phonemeSpellingEdit->text ().split (' ', QString::SkipEmptyParts);
   
   mapper->submit ();
   displayModel->submitAll ();
-  db.setSpellings (phonemeNameEdit->text (), phonemeSpellingEdit->text ());
+  db.setSpellings (name, phonemeSpellingEdit->text ());
+  db.fillRepresentations ();
   
   updateModels ();
   
   if (index.isValid ())
     phonemeListView->selectionModel ()->setCurrentIndex (index, QItemSelectionModel::Select);
   
-  emit spellingsChanged ();
+  // renaming also changes the natural class rules, so only a spelling
+  // change can be patched into the grammar; other edits leave it alone
+  if (name != oldName)
+    emit spellingsChanged ();
+  else if (oldSpellings != newSpellings)
+    emit phonemeChanged (name, oldSpellings + newSpellings);
 }
 
 void PhonologyPage::launchFeaturesDialog ()  {
@@ -37,6 +37,7 @@ class PhonologyPage : public QWidget {
   signals:
     void naturalClassListUpdated ();
     void spellingsChanged ();
+    void phonemeChanged (QString, QStringList);
 
   private slots:
     void setChanged ();
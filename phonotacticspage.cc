@@ -5,6 +5,7 @@
 #include <QPushButton>
 #include <QComboBox>
 #include <QProgressBar>
+#include <QMessageBox>
 
 #include <QHBoxLayout>
 #include <QVBoxLayout>
@@ -122,6 +123,13 @@ PhonotacticsPage::PhonotacticsPage ()  {
   addRemoveClassLayout->addStretch (1);
   
   reanalyzeButton = new QPushButton ("Reanalyze Lexicon");
+  cancelButton = new QPushButton ("Cancel");
+  cancelButton->setEnabled (false);
+  reanalyzeLayout = new QHBoxLayout;
+  reanalyzeLayout->addStretch (1);
+  reanalyzeLayout->addWidget (reanalyzeButton);
+  reanalyzeLayout->addWidget (cancelButton);
+  reanalyzeLayout->addStretch (1);
   progressBar = new QProgressBar;
   progressBar->setMinimum (0);
   progressBar->setMaximum (1);
@@ -136,8 +144,7 @@ PhonotacticsPage::PhonotacticsPage ()  {
   mainLayout->addWidget (displayLabel);
   mainLayout->addLayout (addRemoveClassLayout);
   mainLayout->addStretch (1);
-  mainLayout->addWidget (reanalyzeButton);
-  mainLayout->setAlignment (reanalyzeButton, Qt::AlignCenter);
+  mainLayout->addLayout (reanalyzeLayout);
   mainLayout->addWidget (progressBar);
   mainLayout->setAlignment (progressBar, Qt::AlignCenter);
   
@@ -164,6 +171,7 @@ PhonotacticsPage::PhonotacticsPage ()  {
   connect (deleteCodaButton, SIGNAL (clicked ()), this, SLOT (deleteCoda ()));
   
   connect (reanalyzeButton, SIGNAL (clicked ()), this, SLOT (startReanalyze ()));
+  connect (cancelButton, SIGNAL (clicked ()), this, SIGNAL (cancelReanalyze ()));
 }
 
 void PhonotacticsPage::clearDB ()  {
@@ -183,9 +191,9 @@ void PhonotacticsPage::clearDB ()  {
 void PhonotacticsPage::setDB (CDICDatabase data)  {
   db = data;
   
-  onsetRequiredBox->setChecked (db.getValue (ONSET_REQUIRED) == "true");
+  onsetRequiredBox->setChecked (db.getFlag (ONSET_REQUIRED));
   ignoreEdit->setText (db.getValue (IGNORED_CHARACTERS));
-  usePhonotacticsBox->setChecked (db.getValue (USE_PHONOTACTICS) != "false");
+  usePhonotacticsBox->setChecked (db.getFlag (USE_PHONOTACTICS, true));
   addClassBox->addItems (db.getClassList (PHONEME));
   
   onsetModel->setStringList (db.getSequenceList (ONSET));
@@ -207,12 +215,26 @@ void PhonotacticsPage::updateClassList ()  {
   addClassBox->addItems (db.getClassList (PHONEME));
 }
 
+void PhonotacticsPage::startProgressBar (int words)  {
+  progressBar->setMaximum (words);
+  progressBar->setValue (0);
+  reanalyzeButton->setEnabled (false);
+  cancelButton->setEnabled (true);
+}
+
 void PhonotacticsPage::incrementProgressBar ()  {
   progressBar->setValue (progressBar->value () + 1);
 }
 
-void PhonotacticsPage::resetProgressBar ()  {
+// Words the reanalysis could not save keep their old phonology
+void PhonotacticsPage::resetProgressBar (int failed)  {
   progressBar->setValue (0);
+  reanalyzeButton->setEnabled (true);
+  cancelButton->setEnabled (false);
+  
+  if (failed > 0)
+    QMessageBox::warning (this, "Reanalysis", QString ("%1 words could not be saved and "
+                          "keep their old phonology.").arg (failed));
 }
 
 void PhonotacticsPage::setOnsetRequired (bool o)  {
@@ -221,7 +243,7 @@ void PhonotacticsPage::setOnsetRequired (bool o)  {
 }
 
 void PhonotacticsPage::setIgnored (QString i)  {
-  db.setValue (IGNORED_CHARACTERS, i);
+  db.setIgnoredCharacters (i);
 }
 
 void PhonotacticsPage::setUsePhonotactics (bool u)  {
@@ -328,8 +350,6 @@ void PhonotacticsPage::deleteCoda ()  {
 }
 
 void PhonotacticsPage::startReanalyze ()  {
-  cout << db.getNumberOfWords ();
-  progressBar->setMaximum (db.getNumberOfWords ());
   emit reanalyze ();
 }
 
@@ -30,11 +30,13 @@ class PhonotacticsPage : public QWidget  {
   signals:
     void phonotacticsChanged ();
     void reanalyze ();
+    void cancelReanalyze ();
 
   public slots:
     void updateClassList ();
+    void startProgressBar (int);
     void incrementProgressBar ();
-    void resetProgressBar ();
+    void resetProgressBar (int);
     
   private slots:
     void setOnsetRequired (bool);
@@ -91,6 +93,7 @@ class PhonotacticsPage : public QWidget  {
     QComboBox *removeClassBox;
     
     QPushButton *reanalyzeButton;
+    QPushButton *cancelButton;
     QProgressBar *progressBar;
     
     QHBoxLayout *topLayout;
@@ -105,6 +108,7 @@ class PhonotacticsPage : public QWidget  {
     
     QHBoxLayout *arrowLayout;
     QHBoxLayout *addRemoveClassLayout;
+    QHBoxLayout *reanalyzeLayout;
     
     QVBoxLayout *mainLayout;
 };
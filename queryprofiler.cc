@@ -0,0 +1,314 @@
+#include <QSqlQuery>
+#include <QSqlDriver>
+#include <QSqlResult>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QPair>
+#include <QtAlgorithms>
+
+#include <cmath>
+
+#include "queryprofiler.h"
+
+QMutex QueryProfiler::mutex;
+bool QueryProfiler::profiling = false;
+bool QueryProfiler::explaining = false;
+QHash<QString, StatementProfile> QueryProfiler::profiles;
+QHash<const QSqlQuery*, ActiveStatement> QueryProfiler::active;
+QSet<QString> QueryProfiler::explained;
+
+void QueryProfiler::setEnabled (bool on)  {
+  QMutexLocker locker (&mutex);
+
+  profiling = on;
+  active.clear ();
+}
+
+bool QueryProfiler::enabled ()  {
+  return profiling;
+}
+
+void QueryProfiler::setExplainScans (bool on)  {
+  QMutexLocker locker (&mutex);
+
+  explaining = on;
+  explained.clear ();
+}
+
+bool QueryProfiler::explainScans ()  {
+  return explaining;
+}
+
+void QueryProfiler::reset ()  {
+  QMutexLocker locker (&mutex);
+
+  profiles.clear ();
+  active.clear ();
+  explained.clear ();
+}
+
+// One line per statement, the slowest in total first: calls, total, mean
+// and 99th percentile milliseconds, rows returned or changed, and the
+// statement, followed by its plan if it scans a whole table.  The 99th
+// percentile is the upper end of its bucket, so it can be up to a fifth high.
+QString QueryProfiler::report ()  {
+  QMutexLocker locker (&mutex);
+
+  // statements whose queries were never finished count as they stand
+  QList<const QSqlQuery*> unfinished = active.keys ();
+  for (int x = 0; x < unfinished.size (); x++)
+    close (unfinished[x]);
+
+  QList< QPair<qint64, QString> > order;
+  for (QHash<QString, StatementProfile>::iterator p = profiles.begin ();
+       p != profiles.end (); p++)
+    order.append (qMakePair (p->total, p.key ()));
+
+  qSort (order.begin (), order.end (), qGreater< QPair<qint64, QString> > ());
+
+  QString text;
+  QTextStream out (&text);
+
+  out << "calls\ttotal ms\tmean ms\tp99 ms\trows\tstatement" << endl;
+
+  for (int x = 0; x < order.size (); x++)  {
+    StatementProfile &profile = profiles[order[x].second];
+
+    double p99 = 0;
+    int rank = (int) ceil (profile.calls * 0.99), count = 0;
+
+    for (int b = 0; b < profile.times.size () && rank > 0; b++)  {
+      count += profile.times[b];
+
+      if (count >= rank)  {
+        p99 = pow (2.0, (b + 1) / 4.0);
+        break;
+      }
+    }
+
+    out << profile.calls << '\t'
+        << QString::number (profile.total / 1e6, 'f', 3) << '\t'
+        << QString::number (profile.calls ? profile.total / 1e6 / profile.calls : 0, 'f', 3) << '\t'
+        << QString::number (p99 / 1e6, 'f', 3) << '\t'
+        << profile.rows << '\t' << order[x].second.simplified () << endl;
+
+    for (int y = 0; y < profile.scans.size (); y++)
+      out << "\t\t\t\t\t  " << profile.scans[y] << endl;
+  }
+
+  out.flush ();
+  return text;
+}
+
+bool QueryProfiler::exec (QSqlQuery &query)  {
+  if (!profiling) return query.exec ();
+
+  {
+    QMutexLocker locker (&mutex);
+    close (&query);
+  }
+
+  explain (query, query.lastQuery (), true);
+
+  QElapsedTimer timer;
+  timer.start ();
+
+  bool ok = query.exec ();
+  started (query, ok, timer.nsecsElapsed ());
+
+  return ok;
+}
+
+bool QueryProfiler::exec (QSqlQuery &query, QString statement)  {
+  if (!profiling) return query.exec (statement);
+
+  {
+    QMutexLocker locker (&mutex);
+    close (&query);
+  }
+
+  explain (query, statement, false);
+
+  QElapsedTimer timer;
+  timer.start ();
+
+  bool ok = query.exec (statement);
+  started (query, ok, timer.nsecsElapsed ());
+
+  return ok;
+}
+
+// A batch counts as one call, changing one row per set of values
+bool QueryProfiler::execBatch (QSqlQuery &query)  {
+  if (!profiling) return query.execBatch ();
+
+  {
+    QMutexLocker locker (&mutex);
+    close (&query);
+  }
+
+  explain (query, query.lastQuery (), true);
+
+  QElapsedTimer timer;
+  timer.start ();
+
+  bool ok = query.execBatch ();
+  qint64 elapsed = timer.nsecsElapsed ();
+
+  QMutexLocker locker (&mutex);
+
+  ActiveStatement statement;
+  statement.statement = query.lastQuery ();
+  statement.elapsed = elapsed;
+  statement.rows = (ok ? query.boundValue (0).toList ().size () : 0);
+
+  active[&query] = statement;
+  close (&query);
+
+  return ok;
+}
+
+// The last row read closes the statement
+bool QueryProfiler::next (QSqlQuery &query)  {
+  if (!profiling) return query.next ();
+
+  QElapsedTimer timer;
+  timer.start ();
+
+  bool row = query.next ();
+  qint64 elapsed = timer.nsecsElapsed ();
+
+  QMutexLocker locker (&mutex);
+
+  QHash<const QSqlQuery*, ActiveStatement>::iterator a = active.find (&query);
+  if (a == active.end ()) return row;
+
+  a->elapsed += elapsed;
+
+  if (row)
+    a->rows++;
+  else close (&query);
+
+  return row;
+}
+
+void QueryProfiler::finish (QSqlQuery &query)  {
+  if (profiling)  {
+    QMutexLocker locker (&mutex);
+    close (&query);
+  }
+
+  query.finish ();
+}
+
+// Statements that return no rows are done with as soon as they run
+void QueryProfiler::started (QSqlQuery &query, bool ok, qint64 elapsed)  {
+  QMutexLocker locker (&mutex);
+
+  ActiveStatement statement;
+  statement.statement = query.lastQuery ();
+  statement.elapsed = elapsed;
+  statement.rows = 0;
+
+  if (ok && !query.isSelect ())
+    statement.rows = qMax (query.numRowsAffected (), 0);
+
+  active[&query] = statement;
+
+  if (!ok || !query.isSelect ())
+    close (&query);
+}
+
+// Called with the mutex held
+void QueryProfiler::close (const QSqlQuery *query)  {
+  if (!active.contains (query)) return;
+
+  ActiveStatement statement = active.take (query);
+  StatementProfile &profile = profileOf (statement.statement);
+
+  profile.calls++;
+  profile.rows += statement.rows;
+  profile.total += statement.elapsed;
+
+  int bucket = 0;
+  if (statement.elapsed > 0)
+    bucket = qBound (0, (int) (4 * log ((double) statement.elapsed) / log (2.0)),
+                     PROFILE_BUCKETS - 1);
+
+  profile.times[bucket]++;
+}
+
+// The plan is read on a query of its own, on the same connection and with the
+// same values bound
+void QueryProfiler::explain (QSqlQuery &query, QString statement, bool bound)  {
+  if (!explaining) return;
+
+  QString verb = statement.trimmed ().section (' ', 0, 0).toLower ();
+  if (verb != "select" && verb != "insert" && verb != "update" && verb != "delete")
+    return;
+
+  {
+    QMutexLocker locker (&mutex);
+
+    if (explained.contains (statement)) return;
+    explained.insert (statement);
+  }
+
+  QSqlQuery plan (query.driver ()->createResult ());
+  plan.setForwardOnly (true);
+
+  if (!plan.prepare ("explain query plan " + statement)) return;
+
+  // a batch is explained with its first set of values
+  if (bound)
+    for (int x = 0; x < query.boundValues ().size (); x++)  {
+      QVariant value = query.boundValue (x);
+
+      if (value.type () == QVariant::List)
+        value = value.toList ().value (0);
+
+      plan.bindValue (x, value);
+    }
+
+  if (!plan.exec ()) return;
+
+  QStringList lines;
+  bool scan = false;
+
+  while (plan.next ())  {
+    QString detail = plan.value (3).toString ();
+    lines.append (detail);
+
+    // searches of a table or an index are fine, as are subqueries
+    if (detail.startsWith ("SCAN") && !detail.contains ("INDEX") &&
+        !detail.contains ("SUBQUERY") && !detail.contains ("CONSTANT ROW"))
+      scan = true;
+  }
+
+  plan.finish ();
+
+  if (!scan) return;
+
+  qDebug ("full table scan: %s\n  %s", qPrintable (statement.simplified ()),
+          qPrintable (lines.join ("\n  ")));
+
+  QMutexLocker locker (&mutex);
+  profileOf (statement).scans = lines;
+}
+
+// Called with the mutex held
+StatementProfile &QueryProfiler::profileOf (QString statement)  {
+  if (!profiles.contains (statement))  {
+    StatementProfile profile;
+    profile.calls = 0;
+    profile.rows = 0;
+    profile.total = 0;
+    profile.times.fill (0, PROFILE_BUCKETS);
+
+    profiles.insert (statement, profile);
+  }
+
+  return profiles[statement];
+}
@@ -0,0 +1,71 @@
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+
+class QSqlQuery;
+
+// Execution times are counted in buckets a quarter of a power of two wide,
+// which covers everything a qint64 of nanoseconds can hold
+#define PROFILE_BUCKETS 256
+
+// Everything recorded for one statement text
+typedef struct StatementProfile_s  {
+  int calls;
+  qint64 rows;
+  qint64 total;
+  // executions by the bucket of their time, for the percentiles
+  QVector<int> times;
+  // the plan, when it scans a whole table
+  QStringList scans;
+} StatementProfile;
+
+// A statement between its exec and its last row
+typedef struct ActiveStatement_s  {
+  QString statement;
+  qint64 elapsed;
+  qint64 rows;
+} ActiveStatement;
+
+// Counts and times every statement that goes through exec, next and finish
+// when profiling is on, by statement text, from any thread.  The time of a
+// statement is the time spent in exec and next, not in the caller between
+// rows.  With full scans explained, the first execution of each statement is
+// preceded by an EXPLAIN QUERY PLAN, and plans that scan a whole table are
+// logged and kept for the report.  When profiling is off, the functions just
+// pass through to QSqlQuery.
+class QueryProfiler  {
+  public:
+    static void setEnabled (bool);
+    static bool enabled ();
+    static void setExplainScans (bool);
+    static bool explainScans ();
+    static void reset ();
+    static QString report ();
+
+    static bool exec (QSqlQuery&);
+    static bool exec (QSqlQuery&, QString);
+    static bool execBatch (QSqlQuery&);
+    static bool next (QSqlQuery&);
+    static void finish (QSqlQuery&);
+
+  private:
+    static void started (QSqlQuery&, bool, qint64);
+    static void close (const QSqlQuery*);
+    static void explain (QSqlQuery&, QString, bool);
+    static StatementProfile &profileOf (QString);
+
+    static QMutex mutex;
+    static bool profiling;
+    static bool explaining;
+    static QHash<QString, StatementProfile> profiles;
+    static QHash<const QSqlQuery*, ActiveStatement> active;
+    static QSet<QString> explained;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include <QMutexLocker>
+#include <QSqlDatabase>
+
+#include "reanalyzer.h"
+#include "cdicdatabase.h"
+
+// Results saved per transaction, so progress keeps moving on big lexicons
+#define WRITE_BATCH_SIZE 200
+
+Reanalyzer::Reanalyzer (QString filename, PhonologyAnalyzer analyzer,
+                        QMap<int, QString> words)  {
+  queue.ids = words.keys ();
+  queue.words = words;
+  queue.next = 0;
+  queue.cancelled = false;
+
+  int threads = QThread::idealThreadCount ();
+  if (threads < 1) threads = 1;
+
+  queue.workersLeft = threads;
+
+  for (int x = 0; x < threads; x++)
+    workers.append (new ReanalyzeWorker (&queue, analyzer));
+
+  writer = new ReanalyzeWriter (&queue, filename);
+
+  connect (writer, SIGNAL (wordWritten ()), this, SIGNAL (wordParsed ()));
+  connect (writer, SIGNAL (finished ()), this, SIGNAL (finished ()));
+}
+
+Reanalyzer::~Reanalyzer ()  {
+  cancel ();
+  wait ();
+
+  for (int x = 0; x < workers.size (); x++)
+    delete workers[x];
+
+  delete writer;
+}
+
+void Reanalyzer::start ()  {
+  writer->start ();
+
+  for (int x = 0; x < workers.size (); x++)
+    workers[x]->start ();
+}
+
+void Reanalyzer::wait ()  {
+  for (int x = 0; x < workers.size (); x++)
+    workers[x]->wait ();
+
+  writer->wait ();
+}
+
+// Words whose results could not be saved; only known once finished
+int Reanalyzer::failures ()  {
+  return writer->failures ();
+}
+
+void Reanalyzer::cancel ()  {
+  QMutexLocker locker (&queue.mutex);
+
+  queue.cancelled = true;
+  queue.resultsReady.wakeAll ();
+}
+
+ReanalyzeWorker::ReanalyzeWorker (ReanalyzeQueue *q, PhonologyAnalyzer a)  {
+  queue = q;
+  analyzer = a;
+}
+
+void ReanalyzeWorker::run ()  {
+  while (true)  {
+    queue->mutex.lock ();
+
+    if (queue->cancelled || queue->next >= queue->ids.size ())  {
+      queue->workersLeft--;
+      queue->resultsReady.wakeAll ();
+      queue->mutex.unlock ();
+      return;
+    }
+
+    int id = queue->ids[queue->next++];
+    queue->mutex.unlock ();
+
+    QList<Syllable> phonology = analyzer.analyze (queue->words.value (id));
+
+    queue->mutex.lock ();
+    queue->results.append (qMakePair (id, phonology));
+    queue->resultsReady.wakeAll ();
+    queue->mutex.unlock ();
+  }
+}
+
+ReanalyzeWriter::ReanalyzeWriter (ReanalyzeQueue *q, QString f)  {
+  queue = q;
+  filename = f;
+  failed = 0;
+}
+
+int ReanalyzeWriter::failures ()  {
+  return failed;
+}
+
+void ReanalyzeWriter::run ()  {
+  QString connection = QString ("reanalyze%1").arg ((quintptr)this);
+
+  {
+    CDICDatabase db;
+
+    // the dictionary is live, so its own profile is kept; a crash must not
+    // lose the user's edits along with the reparsed words
+    if (!db.open (filename, connection))  {
+      QMutexLocker locker (&queue->mutex);
+      queue->cancelled = true;
+      failed = queue->ids.size ();
+    }
+
+    // the reparse does not touch the phonemes or supras, so their names are
+    // looked up and the statements prepared once for every batch
+    PhonologyStatements statements;
+    statements.ready = false;
+
+    while (true)  {
+      QList< QPair<int, QList<Syllable> > > batch;
+      bool done = false;
+
+      queue->mutex.lock ();
+
+      while (queue->results.isEmpty () && queue->workersLeft > 0 &&
+             !queue->cancelled)
+        queue->resultsReady.wait (&queue->mutex);
+
+      while (!queue->results.isEmpty () && batch.size () < WRITE_BATCH_SIZE)
+        batch.append (queue->results.takeFirst ());
+
+      done = queue->cancelled ||
+             (queue->results.isEmpty () && queue->workersLeft == 0);
+
+      queue->mutex.unlock ();
+
+      if (!batch.isEmpty ())  {
+        db.transaction ();
+
+        // words with unknown names are skipped; a failed write undoes the
+        // whole batch
+        int written = db.setPhonologyBatch (batch, &statements);
+
+        if (written < 0)  {
+          db.rollback ();
+          failed += batch.size ();
+          written = 0;
+        }
+
+        else if (!db.commit ())  {
+          failed += batch.size ();
+          written = 0;
+        }
+
+        for (int x = 0; x < written; x++)
+          emit wordWritten ();
+      }
+
+      if (done) break;
+    }
+
+    db.close ();
+  }
+
+  QSqlDatabase::removeDatabase (connection);
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef REANALYZER_H
+#define REANALYZER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QMap>
+#include <QList>
+#include <QPair>
+
+#include "const.h"
+#include "phonologyanalyzer.h"
+
+class ReanalyzeWorker;
+class ReanalyzeWriter;
+
+// State shared between the threads of one reanalysis.  Everything but the
+// word list is guarded by mutex.
+typedef struct ReanalyzeQueue_s  {
+  QMutex mutex;
+  QWaitCondition resultsReady;
+  QList<int> ids;
+  QMap<int, QString> words;
+  int next;
+  QList< QPair<int, QList<Syllable> > > results;
+  int workersLeft;
+  bool cancelled;
+} ReanalyzeQueue;
+
+// Reparses a list of words in the background.  Each worker thread parses
+// with its own copy of the analyzer; a single writer thread, on its own
+// connection to the dictionary, saves the results in batched transactions.
+class Reanalyzer : public QObject  {
+  Q_OBJECT
+
+  public:
+    Reanalyzer (QString, PhonologyAnalyzer, QMap<int, QString>);
+    ~Reanalyzer ();
+
+    void start ();
+    void wait ();
+    int failures ();
+
+  signals:
+    void wordParsed ();
+    void finished ();
+
+  public slots:
+    void cancel ();
+
+  private:
+    ReanalyzeQueue queue;
+
+    QList<ReanalyzeWorker*> workers;
+    ReanalyzeWriter *writer;
+};
+
+class ReanalyzeWorker : public QThread  {
+  Q_OBJECT
+
+  public:
+    ReanalyzeWorker (ReanalyzeQueue*, PhonologyAnalyzer);
+
+  protected:
+    void run ();
+
+  private:
+    ReanalyzeQueue *queue;
+    PhonologyAnalyzer analyzer;
+};
+
+class ReanalyzeWriter : public QThread  {
+  Q_OBJECT
+
+  public:
+    ReanalyzeWriter (ReanalyzeQueue*, QString);
+    
+    int failures ();
+
+  signals:
+    void wordWritten ();
+
+  protected:
+    void run ();
+
+  private:
+    ReanalyzeQueue *queue;
+    QString filename;
+    int failed;
+};
+
+#endif
\ No newline at end of file
@@ -8,7 +8,7 @@ create table Settings
   (name text primary key not null,
    value text not null);
    
-insert into Settings values ("VersionNumber", "0.4");
+insert into Settings values ("VersionNumber", "0.5");
 
 -- Phonemes
 create table Phoneme
@@ -122,15 +122,103 @@ create trigger DeleteObsoleteFeatureBundlesGodFuckingDammit
     delete from FeatureBundlePhon where id == old.bundleID;
   end;
 
+-- Which phonemes are of which classes, kept up to date by the triggers below
+create table ClassMemberPhon
+  (phonemeID int not null,
+   bundleID int not null,
+   primary key (phonemeID, bundleID) on conflict ignore,
+   foreign key (phonemeID) references Phoneme(id) on delete cascade,
+   foreign key (bundleID) references NaturalClassPhon(bundleID) on delete cascade);
+
+create index ClassMemberPhonIndex on ClassMemberPhon(bundleID);
+
+-- A new phoneme has no features, so it is only in classes that ask for none
+create trigger ClassMemberPhonAdd
+  after insert on Phoneme for each row
+  begin
+    insert into ClassMemberPhon
+      select new.id, bundleID from NaturalClassPhon
+      where not exists (select * from FeatureBundlePhon where id == bundleID);
+  end;
+
+create trigger ClassMemberPhonClassAdd
+  after insert on NaturalClassPhon for each row
+  begin
+    insert into ClassMemberPhon select id, new.bundleID from Phoneme;
+  end;
+
+-- Gaining a feature can only add the classes that ask for it...
+create trigger ClassMemberPhonFeatureInsert
+  after insert on PhonemeFeatureSet for each row
+  begin
+    insert into ClassMemberPhon
+      select new.phonemeID, b.id from FeatureBundlePhon as b
+      where b.feature == new.feature and b.value == new.value and
+        not exists (select feature, value from FeatureBundlePhon where id == b.id
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == new.phonemeID);
+  end;
+
+-- ...and losing one can only remove them
+create trigger ClassMemberPhonFeatureDelete
+  after delete on PhonemeFeatureSet for each row
+  begin
+    delete from ClassMemberPhon
+      where phonemeID == old.phonemeID and
+        bundleID in (select id from FeatureBundlePhon where feature == old.feature and value == old.value);
+  end;
+
+create trigger ClassMemberPhonFeatureUpdate
+  after update on PhonemeFeatureSet for each row
+  begin
+    delete from ClassMemberPhon where phonemeID in (old.phonemeID, new.phonemeID);
+    insert into ClassMemberPhon
+      select Phoneme.id, bundleID from Phoneme, NaturalClassPhon
+      where Phoneme.id in (old.phonemeID, new.phonemeID) and
+        not exists (select feature, value from FeatureBundlePhon where id == bundleID
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+  end;
+
+-- Likewise, a class asking for another feature can only lose members...
+create trigger ClassMemberPhonBundleInsert
+  after insert on FeatureBundlePhon for each row
+  begin
+    delete from ClassMemberPhon
+      where bundleID == new.id and
+        not exists (select * from PhonemeFeatureSet
+                    where phonemeID == ClassMemberPhon.phonemeID and feature == new.feature and value == new.value);
+  end;
+
+-- ...and asking for one fewer can only gain them
+create trigger ClassMemberPhonBundleDelete
+  after delete on FeatureBundlePhon for each row
+  begin
+    insert into ClassMemberPhon
+      select Phoneme.id, old.id from Phoneme
+      where exists (select * from NaturalClassPhon where bundleID == old.id) and
+        not exists (select feature, value from FeatureBundlePhon where id == old.id
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+  end;
+
+create trigger ClassMemberPhonBundleUpdate
+  after update on FeatureBundlePhon for each row
+  begin
+    delete from ClassMemberPhon where bundleID in (old.id, new.id);
+    insert into ClassMemberPhon
+      select Phoneme.id, bundleID from Phoneme, NaturalClassPhon
+      where bundleID in (old.id, new.id) and
+        not exists (select feature, value from FeatureBundlePhon where id == bundleID
+                    except
+                    select feature, value from PhonemeFeatureSet where phonemeID == Phoneme.id);
+  end;
+
 -- A view showing which phonemes are of which classes
 create view PhonClassList as
-  select id, NaturalClassPhon.name as class
-  from Phoneme, NaturalClassPhon
-  where not exists (select feature, value from FeatureBundlePhon 
-                    where FeatureBundlePhon.id == bundleID
-                    except
-                    select feature, value from PhonemeFeatureSet 
-                    where phonemeID == Phoneme.id);
+  select phonemeID as id, name as class
+  from ClassMemberPhon, NaturalClassPhon
+  where ClassMemberPhon.bundleID == NaturalClassPhon.bundleID;
 
 -- Suprasegmentals
 create table Suprasegmental
@@ -206,6 +294,44 @@ create table Word
    name text not null,
    definition text not null);
 
+-- For searching on the start of a name and sorting by it.
+create index WordNameIndex on Word(name);
+
+-- Index of the substrings of up to three characters starting at each position
+-- of a word's name, as the parser reads it without spaces or ignored
+-- characters, for finding the words a spelling change affects.  It is filled
+-- in by CDICDatabase::indexWords whenever a name is written.
+create table WordGram
+  (wordID int not null,
+   pos int not null,
+   gram text not null,
+   primary key (wordID, pos),
+   foreign key (wordID) references Word(id) on delete cascade);
+
+create index WordGramIndex on WordGram(gram);
+
+-- Full text index of the definitions, for searching in English.  Each row's
+-- docid is the id of its word.
+create virtual table WordText using fts4(definition);
+
+create trigger WordTextInsert
+  after insert on Word for each row
+  begin
+    insert into WordText (docid, definition) values (new.id, new.definition);
+  end;
+
+create trigger WordTextUpdate
+  after update of definition on Word for each row
+  begin
+    update WordText set definition = new.definition where docid == new.id;
+  end;
+
+create trigger WordTextDelete
+  after delete on Word for each row
+  begin
+    delete from WordText where docid == old.id;
+  end;
+
 -- Every syllable has a unique syllNum.  
 -- There is no syllable table; they are just the collection of stuff with the same syllNum.
 create table SyllableSupra
@@ -273,6 +399,52 @@ create table CodaSupra
    foreign key (wordID, syllNum, ind) references Coda on delete cascade,
    foreign key (supraID) references Suprasegmental(id) on delete cascade);
 
+-- Cached phonological representation of each word.  setPhonology rewrites a
+-- word's row; renaming or deleting a phoneme, or changing how a supra is
+-- written, drops the rows of every word using it, to be rebuilt on demand.
+create table WordRepresentation
+  (wordID integer primary key not null,
+   representation text not null,
+   foreign key (wordID) references Word(id) on delete cascade);
+
+create trigger RepresentationPhonemeUpdate
+  after update of name on Phoneme for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from Onset where phonemeID == new.id
+                       union select wordID from Peak where phonemeID == new.id
+                       union select wordID from Coda where phonemeID == new.id);
+  end;
+
+create trigger RepresentationPhonemeDelete
+  before delete on Phoneme for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from Onset where phonemeID == old.id
+                       union select wordID from Peak where phonemeID == old.id
+                       union select wordID from Coda where phonemeID == old.id);
+  end;
+
+create trigger RepresentationSupraUpdate
+  after update of repType, repText on Suprasegmental for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from SyllableSupra where supraID == new.id
+                       union select wordID from OnsetSupra where supraID == new.id
+                       union select wordID from PeakSupra where supraID == new.id
+                       union select wordID from CodaSupra where supraID == new.id);
+  end;
+
+create trigger RepresentationSupraDelete
+  before delete on Suprasegmental for each row
+  begin
+    delete from WordRepresentation
+      where wordID in (select wordID from SyllableSupra where supraID == old.id
+                       union select wordID from OnsetSupra where supraID == old.id
+                       union select wordID from PeakSupra where supraID == old.id
+                       union select wordID from CodaSupra where supraID == old.id);
+  end;
+
 -- Word Features
 -- These all work the same way as the phoneme features tables/triggers/views.
 create table WordFeatureDef
@@ -338,14 +510,102 @@ create table FeatureBundleWord
    foreign key (feature, value) references WordSubfeature(name, value)
      on update cascade on delete cascade);
 
-create view WordClassList as
-  select id, NaturalClassWord.name as class
-  from Word, NaturalClassWord
-  where not exists (select feature, value from FeatureBundleWord 
-                    where FeatureBundleWord.id == bundleID
+-- Which words are of which classes, kept up to date by the triggers below
+create table ClassMemberWord
+  (wordID int not null,
+   bundleID int not null,
+   primary key (wordID, bundleID) on conflict ignore,
+   foreign key (wordID) references Word(id) on delete cascade,
+   foreign key (bundleID) references NaturalClassWord(bundleID) on delete cascade);
+
+create index ClassMemberWordIndex on ClassMemberWord(bundleID);
+
+-- A new word has no features, so it is only in classes that ask for none
+create trigger ClassMemberWordAdd
+  after insert on Word for each row
+  begin
+    insert into ClassMemberWord
+      select new.id, bundleID from NaturalClassWord
+      where not exists (select * from FeatureBundleWord where id == bundleID);
+  end;
+
+create trigger ClassMemberWordClassAdd
+  after insert on NaturalClassWord for each row
+  begin
+    insert into ClassMemberWord select id, new.bundleID from Word;
+  end;
+
+-- Gaining a feature can only add the classes that ask for it...
+create trigger ClassMemberWordFeatureInsert
+  after insert on WordFeatureSet for each row
+  begin
+    insert into ClassMemberWord
+      select new.wordID, b.id from FeatureBundleWord as b
+      where b.feature == new.feature and b.value == new.value and
+        not exists (select feature, value from FeatureBundleWord where id == b.id
                     except
-                    select feature, value from WordFeatureSet 
-                    where wordID == Word.id);
+                    select feature, value from WordFeatureSet where wordID == new.wordID);
+  end;
+
+-- ...and losing one can only remove them
+create trigger ClassMemberWordFeatureDelete
+  after delete on WordFeatureSet for each row
+  begin
+    delete from ClassMemberWord
+      where wordID == old.wordID and
+        bundleID in (select id from FeatureBundleWord where feature == old.feature and value == old.value);
+  end;
+
+create trigger ClassMemberWordFeatureUpdate
+  after update on WordFeatureSet for each row
+  begin
+    delete from ClassMemberWord where wordID in (old.wordID, new.wordID);
+    insert into ClassMemberWord
+      select Word.id, bundleID from Word, NaturalClassWord
+      where Word.id in (old.wordID, new.wordID) and
+        not exists (select feature, value from FeatureBundleWord where id == bundleID
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+  end;
+
+-- Likewise, a class asking for another feature can only lose members...
+create trigger ClassMemberWordBundleInsert
+  after insert on FeatureBundleWord for each row
+  begin
+    delete from ClassMemberWord
+      where bundleID == new.id and
+        not exists (select * from WordFeatureSet
+                    where wordID == ClassMemberWord.wordID and feature == new.feature and value == new.value);
+  end;
+
+-- ...and asking for one fewer can only gain them
+create trigger ClassMemberWordBundleDelete
+  after delete on FeatureBundleWord for each row
+  begin
+    insert into ClassMemberWord
+      select Word.id, old.id from Word
+      where exists (select * from NaturalClassWord where bundleID == old.id) and
+        not exists (select feature, value from FeatureBundleWord where id == old.id
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+  end;
+
+create trigger ClassMemberWordBundleUpdate
+  after update on FeatureBundleWord for each row
+  begin
+    delete from ClassMemberWord where bundleID in (old.id, new.id);
+    insert into ClassMemberWord
+      select Word.id, bundleID from Word, NaturalClassWord
+      where bundleID in (old.id, new.id) and
+        not exists (select feature, value from FeatureBundleWord where id == bundleID
+                    except
+                    select feature, value from WordFeatureSet where wordID == Word.id);
+  end;
+
+create view WordClassList as
+  select wordID as id, name as class
+  from ClassMemberWord, NaturalClassWord
+  where ClassMemberWord.bundleID == NaturalClassWord.bundleID;
 
 -- So that the model for the word page can be populated using "select * from WordPageTable".
 -- Five lines of SQL to save me a headache later, when I inevitably forget how 
@@ -610,4 +870,13 @@ create table RuleReference
    refNum int not null,
    location int not null,
    primary key (ruleID, refNum) on conflict replace,
-   foreign key (ruleID) references InflectionalRule(id) on delete cascade);
\ No newline at end of file
+   foreign key (ruleID) references InflectionalRule(id) on delete cascade);
+
+-- Cached parsing grammar, rebuilt whenever the hash in the GrammarHash setting
+-- no longer matches the phoneme, suprasegmental and phonotactics tables.
+-- The right-hand side symbols are separated by the character 0x1f.
+create table GrammarRule
+  (id integer primary key not null,
+   lhs text not null,
+   rhs text not null,
+   context text not null default "");
\ No newline at end of file
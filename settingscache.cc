@@ -0,0 +1,30 @@
+#include "settingscache.h"
+
+SettingsCache::SettingsCache ()  {
+
+}
+
+// Replaces every setting without notice, as when a dictionary is opened
+void SettingsCache::load (QHash<QString, QString> settings)  {
+  values = settings;
+}
+
+void SettingsCache::clear ()  {
+  values.clear ();
+}
+
+bool SettingsCache::contains (QString name)  {
+  return values.contains (name);
+}
+
+// "" for a setting that is not defined
+QString SettingsCache::value (QString name)  {
+  return values.value (name, "");
+}
+
+void SettingsCache::setValue (QString name, QString value)  {
+  if (values.contains (name) && values[name] == value) return;
+
+  values[name] = value;
+  emit valueChanged (name, value);
+}
@@ -0,0 +1,34 @@
+#ifndef SETTINGSCACHE_H
+#define SETTINGSCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+// The Settings table of an open dictionary, read once when it is opened and
+// shared by every copy of its CDICDatabase, which writes changes through to
+// the table before making them here.  valueChanged is emitted for each
+// setting that actually changes, so pages can follow settings instead of
+// reading them again.  Like the connection it belongs to, it is used from
+// one thread.
+class SettingsCache : public QObject  {
+  Q_OBJECT
+
+  public:
+    SettingsCache ();
+
+    void load (QHash<QString, QString>);
+    void clear ();
+
+    bool contains (QString);
+    QString value (QString);
+    void setValue (QString, QString);
+
+  signals:
+    void valueChanged (QString, QString);
+
+  private:
+    QHash<QString, QString> values;
+};
+
+#endif
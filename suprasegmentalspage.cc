@@ -12,6 +12,7 @@
 
 #include <QSqlQueryModel>
 #include <QSqlTableModel>
+#include <QSqlRecord>
 #include <QListView>
 #include <QDataWidgetMapper>
 
@@ -246,14 +247,19 @@ void SuprasegmentalsPage::submitChanges ()  {
   if (!mapper) return;
   
   QModelIndex index = suprasegmentalListView->currentIndex ();
+  int oldDomain = displayModel->record (mapper->currentIndex ()).value ("domain").toInt ();
   
   mapper->submit ();
   displayModel->submitAll ();
+  db.fillRepresentations ();
   
   updateModels ();
   
   if (index.isValid ())
     suprasegmentalListView->selectionModel ()->setCurrentIndex (index, QItemSelectionModel::Select);
   
-  emit suprasChanged ();
+  // syllable supras apply to every phoneme and to the syllable rules
+  if (oldDomain == SUPRA_DOMAIN_PHON && domainBox->currentIndex () == SUPRA_DOMAIN_PHON)
+    emit supraChanged (nameEdit->text ());
+  else emit suprasChanged ();
 }
\ No newline at end of file
@@ -34,6 +34,7 @@ class SuprasegmentalsPage : public QWidget {
     
   signals:
     void suprasChanged ();
+    void supraChanged (QString);
 
   private slots:
     void addSuprasegmental ();
@@ -0,0 +1,64 @@
+#include <QMutexLocker>
+#include <QSqlDatabase>
+
+#include "textimport.h"
+#include "cdicdatabase.h"
+
+TextImport::TextImport (QString f, QString t, QString p)  {
+  filename = f;
+  textFile = t;
+  pattern = p;
+
+  cancelled = false;
+  loaded = false;
+}
+
+// Called by the import between batches
+bool TextImport::progress (int percent)  {
+  emit progressed (percent);
+
+  QMutexLocker locker (&mutex);
+  return !cancelled;
+}
+
+bool TextImport::succeeded ()  {
+  QMutexLocker locker (&mutex);
+  return loaded;
+}
+
+bool TextImport::wasCancelled ()  {
+  QMutexLocker locker (&mutex);
+  return cancelled;
+}
+
+ListErrorSink *TextImport::errors ()  {
+  return &errorList;
+}
+
+void TextImport::cancel ()  {
+  QMutexLocker locker (&mutex);
+  cancelled = true;
+}
+
+void TextImport::run ()  {
+  QString connection = QString ("import%1").arg ((quintptr)this);
+
+  CDICDatabase::setThreadErrorSink (&errorList);
+
+  {
+    CDICDatabase db;
+    bool ok = false;
+
+    // the import sets up its own bulk load, so the journal is left alone
+    if (db.open (filename, connection, PROFILE_BULK_LOAD))
+      ok = db.loadFromText (textFile, pattern, this);
+
+    db.close ();
+
+    QMutexLocker locker (&mutex);
+    loaded = ok;
+  }
+
+  QSqlDatabase::removeDatabase (connection);
+  CDICDatabase::setThreadErrorSink (NULL);
+}
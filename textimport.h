@@ -0,0 +1,47 @@
+#ifndef TEXTIMPORT_H
+#define TEXTIMPORT_H
+
+#include <QThread>
+#include <QMutex>
+
+#include "textmatcher.h"
+#include "errorsink.h"
+
+// Runs a text import on a thread of its own, with its own connection to the
+// dictionary, so that the window is not left waiting inside the import's
+// transaction.  Progress comes back as a percentage of the file read, and
+// cancelling rolls the import back after the batch being written.  Errors
+// are kept for the window to show once the import is done.
+class TextImport : public QThread, public ImportProgress  {
+  Q_OBJECT
+
+  public:
+    TextImport (QString, QString, QString);
+
+    bool progress (int);
+    bool succeeded ();
+    bool wasCancelled ();
+    ListErrorSink *errors ();
+
+  signals:
+    void progressed (int);
+
+  public slots:
+    void cancel ();
+
+  protected:
+    void run ();
+
+  private:
+    QString filename;
+    QString textFile;
+    QString pattern;
+
+    QMutex mutex;
+    bool cancelled;
+    bool loaded;
+
+    ListErrorSink errorList;
+};
+
+#endif
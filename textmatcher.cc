@@ -0,0 +1,116 @@
+#include <QFile>
+#include <QTextStream>
+#include <QMutexLocker>
+
+#include "textmatcher.h"
+
+// Lines matched ahead of the writer before the matcher waits for it
+#define MAX_PENDING_MATCHES 2000
+
+ImportProgress::~ImportProgress ()  {
+
+}
+
+TextMatcher::TextMatcher (QString f, QRegExp r, int w, int c, int d, bool u)  {
+  filename = f;
+  regExp = r;
+  wordLoc = w;
+  classLoc = c;
+  definitionLoc = d;
+  unicode = u;
+
+  fileSize = 0;
+  position = 0;
+  done = false;
+  cancelled = false;
+  openFailed = false;
+}
+
+// Blocks until there are matches to write; an empty list means the file is
+// done with
+QList<TextMatch> TextMatcher::takeMatches ()  {
+  QMutexLocker locker (&mutex);
+
+  while (matches.isEmpty () && !done)
+    matchesReady.wait (&mutex);
+
+  QList<TextMatch> taken = matches;
+  matches.clear ();
+  matchesTaken.wakeAll ();
+
+  return taken;
+}
+
+bool TextMatcher::failed ()  {
+  QMutexLocker locker (&mutex);
+  return openFailed;
+}
+
+// Counts the lines matched so far, whether or not they have been taken
+int TextMatcher::percentRead ()  {
+  QMutexLocker locker (&mutex);
+
+  if (done) return 100;
+  if (fileSize <= 0) return 0;
+
+  return (int) (position * 100 / fileSize);
+}
+
+void TextMatcher::cancel ()  {
+  QMutexLocker locker (&mutex);
+
+  cancelled = true;
+  matchesTaken.wakeAll ();
+}
+
+void TextMatcher::run ()  {
+  QFile file (filename);
+
+  if (!file.open (QIODevice::ReadOnly | QIODevice::Text))  {
+    QMutexLocker locker (&mutex);
+    openFailed = true;
+    done = true;
+    matchesReady.wakeAll ();
+    return;
+  }
+
+  {
+    QMutexLocker locker (&mutex);
+    fileSize = file.size ();
+  }
+
+  QTextStream in (&file);
+  if (unicode)
+    in.setCodec ("UTF-8");
+
+  while (!in.atEnd ())  {
+    QString line = in.readLine ();
+
+    if (line == "") continue;
+
+    if (!regExp.exactMatch (line))
+      continue;
+
+    TextMatch match;
+    match.word = regExp.cap (wordLoc);
+    match.className = regExp.cap (classLoc);
+    match.definition = regExp.cap (definitionLoc);
+
+    QMutexLocker locker (&mutex);
+
+    while (matches.size () >= MAX_PENDING_MATCHES && !cancelled)
+      matchesTaken.wait (&mutex);
+
+    if (cancelled) break;
+
+    matches.append (match);
+    position = file.pos ();
+    matchesReady.wakeAll ();
+  }
+
+  file.close ();
+
+  QMutexLocker locker (&mutex);
+  done = true;
+  matchesReady.wakeAll ();
+}
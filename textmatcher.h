@@ -0,0 +1,62 @@
+#ifndef TEXTMATCHER_H
+#define TEXTMATCHER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QRegExp>
+#include <QList>
+
+// One line of a text import, split up by the pattern
+typedef struct TextMatch_s  {
+  QString word;
+  QString className;
+  QString definition;
+} TextMatch;
+
+// Told how far a text import has got, as a percentage of the file read;
+// returning false cancels the import
+class ImportProgress  {
+  public:
+    virtual ~ImportProgress ();
+
+    virtual bool progress (int) = 0;
+};
+
+// Reads a text file and matches each line against the import pattern on its
+// own thread, while the caller takes the matches off in batches and writes
+// them.  Only a bounded number of matches are kept waiting.
+class TextMatcher : public QThread  {
+  Q_OBJECT
+
+  public:
+    TextMatcher (QString, QRegExp, int, int, int, bool);
+
+    QList<TextMatch> takeMatches ();
+    bool failed ();
+    int percentRead ();
+    void cancel ();
+
+  protected:
+    void run ();
+
+  private:
+    QString filename;
+    QRegExp regExp;
+    int wordLoc;
+    int classLoc;
+    int definitionLoc;
+    bool unicode;
+
+    QMutex mutex;
+    QWaitCondition matchesReady;
+    QWaitCondition matchesTaken;
+    QList<TextMatch> matches;
+    qint64 fileSize;
+    qint64 position;
+    bool done;
+    bool cancelled;
+    bool openFailed;
+};
+
+#endif
@@ -0,0 +1,307 @@
+#include <QSqlError>
+#include <QStringList>
+#include <QVariant>
+#include <QHash>
+#include <QSet>
+#include <QtAlgorithms>
+
+#include "wordlistmodel.h"
+#include "cdicdatabase.h"
+#include "queryprofiler.h"
+
+// Words read from the database at a time
+#define PAGE_SIZE 256
+
+// The class list is only worked out for the words read
+#define WORD_LIST_SELECT "select id, name, (select group_concat(class) from WordClassList " \
+                         "where WordClassList.id == Word.id) from Word "
+
+WordListModel::WordListModel (QSqlDatabase database, QObject *parent)
+ : QAbstractTableModel (parent)
+{
+  db = database;
+  all = true;
+  atEnd = false;
+}
+
+int WordListModel::rowCount (const QModelIndex &parent) const  {
+  return (parent.isValid () ? 0 : rows.size ());
+}
+
+int WordListModel::columnCount (const QModelIndex &parent) const  {
+  return (parent.isValid () ? 0 : 3);
+}
+
+QVariant WordListModel::data (const QModelIndex &index, int role) const  {
+  if (!index.isValid () || index.row () >= rows.size () || role != Qt::DisplayRole)
+    return QVariant ();
+
+  const WordListRow &row = rows[index.row ()];
+
+  switch (index.column ())  {
+    case 0: return row.id;
+    case 1: return row.name;
+    case 2: return row.classList;
+  }
+
+  return QVariant ();
+}
+
+bool WordListModel::canFetchMore (const QModelIndex &parent) const  {
+  if (parent.isValid ()) return false;
+
+  return (all ? !atEnd : rows.size () < results.size ());
+}
+
+void WordListModel::fetchMore (const QModelIndex &parent)  {
+  if (!canFetchMore (parent)) return;
+
+  QList<WordListRow> page;
+
+  if (all)  {
+    QSqlQuery query (db);
+
+    // each page starts after the last word read, in the order of the index
+    if (rows.isEmpty ())
+      query.prepare (WORD_LIST_SELECT "order by name, id limit :limit");
+    else  {
+      query.prepare (WORD_LIST_SELECT "where name >= :name and not (name == :same and id <= :id) "
+                     "order by name, id limit :limit");
+      query.bindValue (":name", rows.last ().name);
+      query.bindValue (":same", rows.last ().name);
+      query.bindValue (":id", rows.last ().id);
+    }
+
+    query.bindValue (":limit", PAGE_SIZE);
+
+    if (!readRows (query, page))  {
+      atEnd = true;
+      return;
+    }
+
+    atEnd = (page.size () < PAGE_SIZE);
+  }
+
+  else  {
+    QList<int> ids = results.mid (rows.size (), PAGE_SIZE);
+    page = readWords (ids);
+
+    // words deleted since the search are dropped from the results
+    if (page.size () < ids.size ())  {
+      QSet<int> found;
+      for (int x = 0; x < page.size (); x++)
+        found.insert (page[x].id);
+
+      for (int x = 0; x < ids.size (); x++)
+        if (!found.contains (ids[x]))
+          results.removeOne (ids[x]);
+    }
+  }
+
+  if (page.isEmpty ()) return;
+
+  beginInsertRows (QModelIndex (), rows.size (), rows.size () + page.size () - 1);
+  rows += page;
+  endInsertRows ();
+}
+
+// Pages through every word in order of name
+void WordListModel::showAll ()  {
+  beginResetModel ();
+  rows.clear ();
+  results.clear ();
+  all = true;
+  atEnd = false;
+  endResetModel ();
+
+  fetchMore ();
+}
+
+// Pages through the given words in the order given
+void WordListModel::showResults (QList<int> ids)  {
+  beginResetModel ();
+  rows.clear ();
+  results = ids;
+  all = false;
+  atEnd = false;
+  endResetModel ();
+
+  fetchMore ();
+}
+
+// Adds to the end of the search results, for searches that come back in
+// batches
+void WordListModel::appendResults (QList<int> ids)  {
+  if (all) return;
+
+  // a view that has every result so far has no reason to ask for more
+  bool caughtUp = (rows.size () == results.size ());
+
+  results += ids;
+
+  if (caughtUp)
+    fetchMore ();
+}
+
+void WordListModel::clear ()  {
+  beginResetModel ();
+  rows.clear ();
+  results.clear ();
+  all = false;
+  atEnd = true;
+  endResetModel ();
+}
+
+bool WordListModel::showingAll ()  {
+  return all;
+}
+
+// 0 for a row that has not been read
+int WordListModel::wordID (int row)  {
+  if (row < 0 || row >= rows.size ()) return 0;
+
+  return rows[row].id;
+}
+
+// -1 for a word that has not been read
+int WordListModel::rowOf (int id)  {
+  for (int x = 0; x < rows.size (); x++)
+    if (rows[x].id == id)
+      return x;
+
+  return -1;
+}
+
+// Puts a new word in its place among the words read so far.  When listing
+// search results, the caller searches again instead.  A word after the last
+// one read turns up with the next page anyway.
+void WordListModel::insertWord (int id)  {
+  if (!all) return;
+
+  QList<WordListRow> found = readWords (QList<int> () << id);
+  if (found.isEmpty ()) return;
+
+  int row = qLowerBound (rows.begin (), rows.end (), found[0], before) - rows.begin ();
+  if (row == rows.size () && !atEnd) return;
+
+  beginInsertRows (QModelIndex (), row, row);
+  rows.insert (row, found[0]);
+  endInsertRows ();
+}
+
+// Rereads a word whose name or classes have changed; in the full list, a new
+// name can move it
+void WordListModel::updateWord (int id)  {
+  if (all)  {
+    removeWord (id);
+    insertWord (id);
+    return;
+  }
+
+  int row = rowOf (id);
+  if (row < 0) return;
+
+  QList<WordListRow> found = readWords (QList<int> () << id);
+
+  if (found.isEmpty ())  {
+    removeWord (id);
+    return;
+  }
+
+  rows[row] = found[0];
+  emit dataChanged (index (row, 0), index (row, 2));
+}
+
+void WordListModel::removeWord (int id)  {
+  results.removeAll (id);
+
+  int row = rowOf (id);
+  if (row < 0) return;
+
+  beginRemoveRows (QModelIndex (), row, row);
+  rows.removeAt (row);
+  endRemoveRows ();
+}
+
+// Rereads the classes of the words read so far, a page at a time
+void WordListModel::refresh ()  {
+  for (int start = 0; start < rows.size (); start += PAGE_SIZE)  {
+    int end = qMin (start + PAGE_SIZE, rows.size ());
+
+    QList<int> ids;
+    for (int x = start; x < end; x++)
+      ids.append (rows[x].id);
+
+    QList<WordListRow> found = readWords (ids);
+
+    QHash<int, QString> classes;
+    for (int x = 0; x < found.size (); x++)
+      classes[found[x].id] = found[x].classList;
+
+    for (int x = start; x < end; x++)
+      rows[x].classList = classes.value (rows[x].id);
+  }
+
+  if (!rows.isEmpty ())
+    emit dataChanged (index (0, 2), index (rows.size () - 1, 2));
+}
+
+bool WordListModel::readRows (QSqlQuery &query, QList<WordListRow> &list)  {
+  query.setForwardOnly (true);
+
+  if (!QueryProfiler::exec (query))  {
+    CDICDatabase::reportError (query.executedQuery () + "\n" + query.lastError ().text ());
+    QueryProfiler::finish (query);
+    return false;
+  }
+
+  while (QueryProfiler::next (query))  {
+    WordListRow row;
+    row.id = query.value (0).toInt ();
+    row.name = query.value (1).toString ();
+    row.classList = query.value (2).toString ();
+
+    list.append (row);
+  }
+
+  QueryProfiler::finish (query);
+
+  return true;
+}
+
+// The given words in the order given, leaving out any that no longer exist
+QList<WordListRow> WordListModel::readWords (QList<int> ids)  {
+  QList<WordListRow> ordered;
+  if (ids.isEmpty ()) return ordered;
+
+  QStringList idList;
+  for (int x = 0; x < ids.size (); x++)
+    idList.append (QString::number (ids[x]));
+
+  QSqlQuery query (db);
+  query.prepare (WORD_LIST_SELECT "where id in (" + idList.join (", ") + ")");
+
+  QList<WordListRow> found;
+  if (!readRows (query, found)) return ordered;
+
+  QHash<int, int> rowOfID;
+  for (int x = 0; x < found.size (); x++)
+    rowOfID[found[x].id] = x;
+
+  for (int x = 0; x < ids.size (); x++)
+    if (rowOfID.contains (ids[x]))
+      ordered.append (found[rowOfID[ids[x]]]);
+
+  return ordered;
+}
+
+// The order of the name index: names compared byte by byte as UTF-8, then ids
+bool WordListModel::before (const WordListRow &a, const WordListRow &b)  {
+  QByteArray aName = a.name.toUtf8 ();
+  QByteArray bName = b.name.toUtf8 ();
+
+  if (aName != bName)
+    return aName < bName;
+
+  return a.id < b.id;
+}
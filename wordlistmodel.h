@@ -0,0 +1,60 @@
+#ifndef WORDLISTMODEL_H
+#define WORDLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QList>
+
+typedef struct WordListRow_s  {
+  int id;
+  QString name;
+  QString classList;
+} WordListRow;
+
+// The word page's list of words, with columns id, name and classlist, read a
+// page at a time as the view scrolls.  With no search, words are paged
+// through in order of name from the index on Word(name), each page starting
+// after the last word read; search results are a list of ids whose names and
+// classes are read a page at a time.  Single words can be added, changed or
+// removed without reading the list again.
+class WordListModel : public QAbstractTableModel  {
+  Q_OBJECT
+
+  public:
+    WordListModel (QSqlDatabase, QObject* = 0);
+
+    int rowCount (const QModelIndex& = QModelIndex ()) const;
+    int columnCount (const QModelIndex& = QModelIndex ()) const;
+    QVariant data (const QModelIndex&, int = Qt::DisplayRole) const;
+    bool canFetchMore (const QModelIndex& = QModelIndex ()) const;
+    void fetchMore (const QModelIndex& = QModelIndex ());
+
+    void showAll ();
+    void showResults (QList<int>);
+    void appendResults (QList<int>);
+    void clear ();
+    bool showingAll ();
+
+    int wordID (int);
+    int rowOf (int);
+
+    void insertWord (int);
+    void updateWord (int);
+    void removeWord (int);
+    void refresh ();
+
+  private:
+    bool readRows (QSqlQuery&, QList<WordListRow>&);
+    QList<WordListRow> readWords (QList<int>);
+    static bool before (const WordListRow&, const WordListRow&);
+
+    QSqlDatabase db;
+
+    QList<WordListRow> rows;
+    bool all;
+    bool atEnd;
+    QList<int> results;
+};
+
+#endif
@@ -5,9 +5,7 @@
 #include <QLabel>
 #include <QTextEdit>
 
-#include <QSqlQueryModel>
 #include <QSqlTableModel>
-#include <QSqlRecord>
 #include <QDataWidgetMapper>
 
 #include <QHBoxLayout>
@@ -26,6 +24,9 @@ using namespace std;
 #include "managefeaturesdialog.h"
 #include "featurebundlesdialog.h"
 #include "editphonologydialog.h"
+#include "reanalyzer.h"
+#include "wordlistmodel.h"
+#include "wordsearcher.h"
 
 WordPage::WordPage ()  {
   featuresDialog = NULL;
@@ -37,6 +38,9 @@ WordPage::WordPage ()  {
   mapper = NULL;
   
   dirty = false;
+  reanalyzer = NULL;
+  searcher = NULL;
+  searchRequest = 0;
   
   addWordButton = new QPushButton ("Add Word");
   addWordEdit = new QLineEdit;
@@ -48,6 +52,10 @@ WordPage::WordPage ()  {
   
   searchButton = new QPushButton ("Search");
   searchEdit = new QLineEdit;
+  searchModeBox = new QComboBox;
+  searchModeBox->setSizeAdjustPolicy (QComboBox::AdjustToContents);
+  searchModeBox->addItem ("Contains", SEARCH_SUBSTRING);
+  searchModeBox->addItem ("Starts With", SEARCH_PREFIX);
   naturalClassBox = new QComboBox;
   naturalClassBox->setSizeAdjustPolicy (QComboBox::AdjustToContents);
   naturalClassBox->addItem ("Any Word Type");
@@ -57,6 +65,7 @@ WordPage::WordPage ()  {
   searchLayout = new QHBoxLayout;
   searchLayout->addWidget (searchButton);
   searchLayout->addWidget (searchEdit);
+  searchLayout->addWidget (searchModeBox);
   searchLayout->addWidget (naturalClassBox);
   searchLayout->addWidget (languageBox);
   
@@ -130,6 +139,10 @@ WordPage::WordPage ()  {
   connect (addWordButton, SIGNAL (clicked ()),  this, SLOT (addWord ()));
   connect (deleteWordButton, SIGNAL (clicked ()), this, SLOT (deleteWord ()));
   connect (searchButton, SIGNAL (clicked ()), this, SLOT (search ()));
+  connect (searchEdit, SIGNAL (textEdited (QString)), this, SLOT (search ()));
+  connect (searchModeBox, SIGNAL (activated (int)), this, SLOT (search ()));
+  connect (naturalClassBox, SIGNAL (activated (int)), this, SLOT (search ()));
+  connect (languageBox, SIGNAL (activated (int)), this, SLOT (search ()));
   
   connect (manageFeaturesButton, SIGNAL (clicked ()), this, 
            SLOT (launchFeaturesDialog ()));
@@ -150,7 +163,29 @@ WordPage::WordPage ()  {
   connect (submitButton, SIGNAL (clicked ()), this, SLOT (submitChanges ()));
 }
 
+// The searcher and any reanalysis are stopped before the window goes, so
+// that no thread outlives its connection or the page it reports to
+WordPage::~WordPage ()  {
+  stopSearching ();
+  
+  if (reanalyzer)  {
+    reanalyzer->cancel ();
+    reanalyzer->wait ();
+    delete reanalyzer;
+    reanalyzer = NULL;
+  }
+}
+
 void WordPage::clearDB ()  {
+  pendingWords.clear ();
+  stopSearching ();
+  
+  if (reanalyzer)  {
+    reanalyzer->cancel ();
+    reanalyzer->wait ();
+    finishParsing ();
+  }
+  
   if (wordModel)
     wordModel->clear ();
   
@@ -171,10 +206,20 @@ void WordPage::clearDB ()  {
 }
 
 void WordPage::setDB (CDICDatabase database)  {
-  QSqlQueryModel *wModel = wordModel;
+  WordListModel *wModel = wordModel;
 
   db = database;
   wordModel = db.getWordListModel ();
+  
+  connect (db.getSettings (), SIGNAL (valueChanged (QString, QString)), this,
+           SLOT (updateSetting (QString, QString)), Qt::UniqueConnection);
+  
+  stopSearching ();
+  searcher = new WordSearcher (db.currentDB ());
+  connect (searcher, SIGNAL (allFound (int)), this, SLOT (showAllWords (int)));
+  connect (searcher, SIGNAL (found (int, QList<int>, bool)),
+           this, SLOT (showSearchResults (int, QList<int>, bool)));
+  searcher->start ();
   wordView->setModel (wordModel);
   wordView->setColumnHidden (0, true);
   wordView->setHeaderHidden (true);
@@ -223,9 +268,12 @@ void WordPage::updateModels ()  {
   
   if (!displayModel) return;
   
+  // searches still running are superseded by this one
+  searchRequest = 0;
   db.searchWordList (wordModel, searchEdit->text (), naturalClassBox->currentText (),
-                     languageBox->currentText ());
+                     languageBox->currentText (), searchMode ());
   displayModel->select ();
+  CDICDatabase::fetchAll (displayModel);
   naturalClassBox->clear ();
   naturalClassBox->addItem ("Any Word Type");
   naturalClassBox->addItems (db.getClassList (WORD));
@@ -239,17 +287,76 @@ void WordPage::setDirty ()  {
   dirty = true;
 }
 
+// A pending full reload would pick these grammar changes up anyway.  Only
+// the words spelled with the old or new spellings need reparsing.
+void WordPage::updatePhoneme (QString phoneme, QStringList spellings)  {
+  if (!dirty)
+    analyzer.updatePhoneme (db, phoneme);
+  
+  parseWords (db.getWordsContaining (spellings));
+}
+
+void WordPage::updateSupra (QString supra)  {
+  if (!dirty)
+    analyzer.updateSupra (db, supra);
+}
+
+// Reparses every word in the background; see Reanalyzer.  Words added or
+// edited while this runs are parsed on the spot as usual.
 void WordPage::parseWordlist ()  {
-  QList<int> idList = db.getAllWordIDs ();
+  if (reanalyzer) return;
   
-  db.transaction ();
-  for (int x = 0; x < idList.size (); x++)  {
-    parseWord (idList[x]);
-    emit wordParsed ();
+  parseWords (db.getWordNames ());
+}
+
+// Reparses the given words in the background, or once the reanalysis
+// already running has finished.
+void WordPage::parseWords (QMap<int, QString> words)  {
+  if (reanalyzer)  {
+    // unite would keep a second copy of a word queued twice
+    for (QMap<int, QString>::iterator w = words.begin (); w != words.end (); w++)
+      pendingWords.insert (w.key (), w.value ());
+    
+    return;
   }
-  db.commit ();
   
-  emit parsingFinished ();
+  if (words.isEmpty ()) return;
+  
+  loadAnalyzer ();
+  
+  emit parsingStarted (words.size ());
+  
+  reanalyzer = new Reanalyzer (db.currentDB (), analyzer, words);
+  connect (reanalyzer, SIGNAL (wordParsed ()), this, SIGNAL (wordParsed ()));
+  connect (reanalyzer, SIGNAL (finished ()), this, SLOT (finishParsing ()));
+  reanalyzer->start ();
+}
+
+void WordPage::cancelParsing ()  {
+  pendingWords.clear ();
+  
+  if (reanalyzer)
+    reanalyzer->cancel ();
+}
+
+void WordPage::finishParsing ()  {
+  if (!reanalyzer) return;
+  
+  reanalyzer->wait ();
+  int failed = reanalyzer->failures ();
+  reanalyzer->deleteLater ();
+  reanalyzer = NULL;
+  
+  if (displayModel)
+    displayWord ();
+  
+  emit parsingFinished (failed);
+  
+  if (!pendingWords.isEmpty ())  {
+    QMap<int, QString> words = pendingWords;
+    pendingWords.clear ();
+    parseWords (words);
+  }
 }
 
 void WordPage::setLanguageName (QString language)  {
@@ -260,38 +367,96 @@ void WordPage::setLanguageName (QString language)  {
   languageBox->addItem ("English");
 }
 
+// Settings that change how words are parsed need the analyzer loaded again
+void WordPage::updateSetting (QString name, QString value)  {
+  if (name == LANGUAGE_NAME)
+    setLanguageName (value);
+  else if (name == ONSET_REQUIRED || name == IGNORED_CHARACTERS)
+    setDirty ();
+}
+
 void WordPage::setChanged ()  {
   submitButton->setEnabled (true);
 }
 
 void WordPage::addWord ()  {
+  if (!wordModel) return;
+  
   if (addWordEdit->text () != "")  {
     int wordID = db.addWord (addWordEdit->text ());
     parseWord (wordID);
+    
+    displayModel->select ();
+    CDICDatabase::fetchAll (displayModel);
+    
+    // a search has to be run again to know whether the word belongs in it
+    if (wordModel->showingAll ())
+      wordModel->insertWord (wordID);
+    else search ();
   }
   
-  updateModels ();
-  
   addWordEdit->setText ("");
 }
 
 void WordPage::deleteWord ()  {
+  if (!wordModel) return;
+  
   QModelIndexList indexList = wordView->selectionModel ()->selectedRows ();
   
-  for (int x = 0; x < indexList.size (); x++)  {
-    int id = wordModel->record (indexList[x].row ()).value ("id").toInt ();
-    db.deleteWord (id);
+  QList<int> ids;
+  for (int x = 0; x < indexList.size (); x++)
+    ids.append (wordModel->wordID (indexList[x].row ()));
+  
+  for (int x = 0; x < ids.size (); x++)  {
+    db.deleteWord (ids[x]);
+    wordModel->removeWord (ids[x]);
   }
-
-  updateModels ();
+  
+  displayModel->select ();
+  CDICDatabase::fetchAll (displayModel);
 }
 
+// Hands the search to the searcher; the results turn up in showSearchResults
 void WordPage::search ()  {
+  if (!searcher) return;
+  
+  QString ignored = db.getValue (IGNORED_CHARACTERS);
+  
   if (naturalClassBox->currentIndex () == 0)
-    db.searchWordList (wordModel, searchEdit->text (), "", languageBox->currentText ());
-  else db.searchWordList (wordModel, searchEdit->text (), 
-                          naturalClassBox->currentText (),
-                          languageBox->currentText ());
+    searchRequest = searcher->search (searchEdit->text (), "", languageBox->currentText (),
+                                      ignored, searchMode ());
+  else searchRequest = searcher->search (searchEdit->text (), 
+                                         naturalClassBox->currentText (),
+                                         languageBox->currentText (), ignored,
+                                         searchMode ());
+}
+
+void WordPage::showAllWords (int request)  {
+  if (request != searchRequest || !wordModel) return;
+  
+  wordModel->showAll ();
+}
+
+// Results of anything but the latest search are dropped
+void WordPage::showSearchResults (int request, QList<int> ids, bool first)  {
+  if (request != searchRequest || !wordModel) return;
+  
+  if (first)
+    wordModel->showResults (ids);
+  else wordModel->appendResults (ids);
+}
+
+int WordPage::searchMode ()  {
+  return searchModeBox->itemData (searchModeBox->currentIndex ()).toInt ();
+}
+
+void WordPage::stopSearching ()  {
+  if (!searcher) return;
+  
+  searcher->stop ();
+  searcher->wait ();
+  delete searcher;
+  searcher = NULL;
 }
 
 void WordPage::displayWord ()  {
@@ -299,7 +464,7 @@ void WordPage::displayWord ()  {
     return;
   
   int row = wordView->selectionModel ()->currentIndex ().row ();
-  int currentID = wordModel->record (row).value ("id").toInt ();
+  int currentID = wordModel->wordID (row);
 
   mapper->setCurrentIndex (currentID - 1);
   
@@ -313,7 +478,10 @@ void WordPage::displayWord ()  {
 void WordPage::updateAfterFeatureChange ()  {
   QModelIndex index = wordView->selectionModel ()->currentIndex ();
   
-  updateModels ();
+  // a class search has to be run again, since words can join or leave it
+  if (wordModel->showingAll ())
+    wordModel->refresh ();
+  else search ();
   
   if (index.isValid ())
     wordView->selectionModel ()->setCurrentIndex (index, QItemSelectionModel::SelectCurrent |
@@ -324,7 +492,7 @@ void WordPage::applyNaturalClass ()  {
   QModelIndexList rowList = wordView->selectionModel ()->selectedRows ();
   
   for (int x = 0; x < rowList.size (); x++)  {
-    int id = wordModel->record (rowList[x].row ()).value ("id").toInt ();
+    int id = wordModel->wordID (rowList[x].row ());
     
     db.assignNaturalClass (assignNaturalClassBox->currentText (), id);
   }
@@ -347,21 +515,21 @@ void WordPage::submitChanges ()  {
   QModelIndex index = wordView->selectionModel ()->currentIndex ();
   int currentID = 1;
   if (index.isValid ())
-    currentID = wordModel->record (index.row ()).value ("id").toInt ();
+    currentID = wordModel->wordID (index.row ());
   
   mapper->submit ();
   displayModel->submitAll ();
+  CDICDatabase::fetchAll (displayModel);
   db.setDefinition (definitionEdit->toPlainText (), currentID);
   
-  updateModels ();
+  // the name may have changed behind the word index
+  QMap<int, QString> word;
+  word[currentID] = db.getWordName (currentID);
+  db.indexWords (word);
   
-  QModelIndex newIndex = wordModel->index (0, 0);
-  while (newIndex.isValid ())  {
-    if (wordModel->record (newIndex.row ()).value ("id").toInt () == currentID)
-      break;
-    
-    newIndex = wordModel->index (newIndex.row () + 1, 0);
-  }
+  wordModel->updateWord (currentID);
+  
+  QModelIndex newIndex = wordModel->index (wordModel->rowOf (currentID), 0);
   
   if (newIndex.isValid ())
     wordView->selectionModel ()->setCurrentIndex (newIndex, QItemSelectionModel::SelectCurrent |
@@ -423,7 +591,7 @@ void WordPage::launchEditFeaturesDialog ()  {
   }
   
   int row = wordView->selectionModel ()->currentIndex ().row ();
-  int currentID = wordModel->record (row).value ("id").toInt ();
+  int currentID = wordModel->wordID (row);
   
   featureBundlesDialog = new FeatureBundlesDialog (WORD, currentID, db);
   
@@ -446,7 +614,7 @@ void WordPage::launchEditPhonologyDialog ()  {
   }
   
   int row = wordView->selectionModel ()->currentIndex ().row ();
-  int currentID = wordModel->record (row).value ("id").toInt ();
+  int currentID = wordModel->wordID (row);
   
   editPhonologyDialog = new EditPhonologyDialog (db, currentID);
   
@@ -461,220 +629,27 @@ void WordPage::parseWord ()  {
   
   QModelIndex index = wordView->selectionModel ()->currentIndex ();
   int row = index.row ();
-  int currentID = wordModel->record (row).value ("id").toInt ();
+  int currentID = wordModel->wordID (row);
   submitChanges ();
   
   parseWord (currentID);
   displayWord ();
 }
 
-void WordPage::parseWord (int id)  {
-  if (dirty)  {
-    phonemes = db.getPhonemesAndSpellings ();
-    diacriticSupras = db.getDiacriticSupras ();
-    beforeSupras = db.getBeforeSupras ();
-    afterSupras = db.getAfterSupras ();
-    doubledSupras = db.getDoubledSupras ();
-
-    QList<Rule> ruleList = db.getParsingGrammar ();
-    parser.setRules (ruleList);
-    parser.setIgnored (db.getValue (IGNORED_CHARACTERS));
-    
-    dirty = false;
-  }
+// Loads the analyzer again if the grammar has changed.  Only callers about
+// to write phonologies get here, so the grammar cache is updated on the way.
+void WordPage::loadAnalyzer ()  {
+  if (!dirty) return;
   
-  QString word = db.getWordName (id);
-
-  db.setPhonology (id, convertTree (parser.parse (word)));
+  db.cacheParsingGrammar ();
+  analyzer.load (db);
+  dirty = false;
 }
 
-QList<Syllable> WordPage::convertTree (TreeNode node)  {
-  QList<Syllable> syllList;
-  QList<TreeNode> treeList;
-  
-  TreeNode currentS;
-  
-  for (int x = 0; x < node.children.size (); x++)
-    if (node.children[x].label == "S")  {
-      currentS = node.children[x];
-      break;
-    }
-  
-  QTextStream terminal (stdout);
-  
-  // break into syllables
-  while (true)  {
-    int x = 0;
-    int children = currentS.children.size ();
-    
-    for (; x < children; x++)
-      if (currentS.children[x].label == "Syll")  {
-        treeList.append (currentS.children[x]);
-        break;
-      }
-      
-    for (x = 0; x < children; x++)
-      if (currentS.children[x].label == "S")  {
-        currentS = currentS.children[x];
-        break;
-      }
-      
-    if (x == children)
-      break;
-  }
-  
-  // for each syllable
-  for (int x = 0; x < treeList.size (); x++)  {
-    Syllable s;
-    syllList.append (s);
-    
-    TreeNode syll = treeList[x];
-    
-    // deal with before and after supras
-    while (true)  {
-      QString beforeText = "";
-      QString afterText = "";
-      bool subSyllFound = false;
-      
-      for (int c = 0; c < syll.children.size (); c++)  {
-        if (syll.children[c].label == "Syll")  {
-          subSyllFound = true;
-          continue;
-        }
-        
-        if (subSyllFound && syll.children[c].label.startsWith ("Char"))
-          afterText.append (syll.children[c].payload);
-        else if (syll.children[c].label.startsWith ("Char"))
-          beforeText.append (syll.children[c].payload);
-      }
-               
-      if (!subSyllFound) break;
-      
-      if (beforeText != "")
-        for (int s = 0; s < beforeSupras.size (); s++)  {    
-          if (beforeSupras[s].domain == SUPRA_DOMAIN_SYLL &&
-              beforeSupras[s].text == beforeText)  {
-            syllList[x].supras.append (beforeSupras[s].name);
-            break;
-          }
-        }
-          
-      if (afterText != "")
-        for (int s = 0; s < afterSupras.size (); s++)
-          if (afterSupras[s].domain == SUPRA_DOMAIN_SYLL &&
-              afterSupras[s].text == afterText)  {
-            syllList[x].supras.append (afterSupras[s].name);
-          }
-          
-      for (int c = 0; c < syll.children.size (); c++)
-        if (syll.children[c].label == "Syll")
-          syll = syll.children[c];
-    }
-    
-    // for each segment
-    for (int loc = ONSET; loc <= CODA; loc++)  {
-      QString label;
-      if (loc == ONSET) label = "Onset";
-      else if (loc == PEAK) label = "Peak";
-      else label = "Coda";
-      
-      TreeNode segment;
-      for (int c = 0; c < syll.children.size (); c++)
-        if (syll.children[c].label == label)
-          segment = syll.children[c];
-        
-      // for each phoneme
-      for (int c = 0; c < segment.children.size (); c++)  {
-        if (segment.children[c].children.size () == 0) 
-          continue;
-        
-        TreeNode phonNode = segment.children[c].children[0];
-        if (!phonNode.label.startsWith ("Phon"))
-          continue;
-        
-        Phoneme p;
-        p.name = phonNode.label.remove (0, 4);
-        
-        // deal with before and after supras
-        while (true)  {
-          QString beforeText = "";
-          QString afterText = "";
-          bool subPhonFound = false;
-          
-          for (int c = 0; c < phonNode.children.size (); c++)  { 
-            if (phonNode.children[c].label.startsWith ("Phon"))  {
-              subPhonFound = true;
-              continue;
-            }
-        
-            if (subPhonFound) afterText.append (phonNode.children[c].payload);
-            else beforeText.append (phonNode.children[c].payload);
-          }
-          
-          if (!subPhonFound) break;
-      
-          if (beforeText != "")
-            for (int s = 0; s < beforeSupras.size (); s++)  {
-              if (beforeSupras[s].domain == SUPRA_DOMAIN_PHON &&
-                  beforeSupras[s].text == beforeText)  {
-                p.supras.append (beforeSupras[s].name);
-                break;
-              }
-            }
-          
-          if (afterText != "")
-            for (int s = 0; s < afterSupras.size (); s++)
-              if (afterSupras[s].domain == SUPRA_DOMAIN_PHON &&
-                  afterSupras[s].text == afterText)  {
-                p.supras.append (afterSupras[s].name);
-              }
-              
-          for (int c = 0; c < phonNode.children.size (); c++)
-            if (phonNode.children[c].label.startsWith ("Phon"))
-              phonNode = phonNode.children[c];
-        }
-        
-        QString spelling = "";
-        for (int c = 0; c < phonNode.children.size (); c++)
-          spelling.append (phonNode.children[c].payload);
-        
-        if (!phonemes[p.name].contains (spelling))  {
-          for (int sp = 0; sp < phonemes[p.name].size (); sp++)
-            if (spelling == phonemes[p.name][sp] + phonemes[p.name][sp])
-              for (int s = 0; s < doubledSupras.size (); s++)  {
-                if (doubledSupras[s].domain == SUPRA_DOMAIN_PHON)  {
-                  p.supras.append (doubledSupras[s].name);
-                  break;
-                }
-                
-                else if (loc == PEAK)  {
-                  syllList[x].supras.append (doubledSupras[s].name);
-                  break;
-                }
-              }
-              
-          for (int sp = 0; sp < phonemes[p.name].size (); sp++)
-            for (int s = 0; s < diacriticSupras.size (); s++)  {
-              if (spelling == db.applyDiacritic (diacriticSupras[s].type, phonemes[p.name][sp]))  {
-                if (diacriticSupras[s].domain == SUPRA_DOMAIN_PHON)  {
-                  p.supras.append (diacriticSupras[s].name);
-                  break;
-                }
-                
-                else if (loc == PEAK)  {
-                  syllList[x].supras.append (diacriticSupras[s].name);
-                  break;
-                }
-              }
-            }
-        }
-        
-        if (loc == ONSET) syllList[x].onset.append (p);
-        else if (loc == PEAK) syllList[x].peak.append (p);
-        else syllList[x].coda.append (p);
-      }
-    }
-  }
+void WordPage::parseWord (int id)  {
+  loadAnalyzer ();
   
-  return syllList;
+  QString word = db.getWordName (id);
+
+  db.setPhonology (id, analyzer.analyze (word));
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include <QWidget>
 
 #include "cdicdatabase.h"
-#include "earleyparser.h"
+#include "phonologyanalyzer.h"
 
 class QPushButton;
 class QLineEdit;
@@ -12,7 +12,6 @@ class QTreeView;
 class QComboBox;
 class QLabel;
 class QTextEdit;
-class QSqlQueryModel;
 class QSqlTableModel;
 class QDataWidgetMapper;
 class QHBoxLayout;
@@ -21,25 +20,34 @@ class QVBoxLayout;
 class ManageFeaturesDialog;
 class FeatureBundlesDialog;
 class EditPhonologyDialog;
+class Reanalyzer;
+class WordListModel;
+class WordSearcher;
 
 class WordPage : public QWidget  {
   Q_OBJECT
   
   public:
     WordPage ();
+    ~WordPage ();
     
     void clearDB ();
     void setDB (CDICDatabase);
     void updateModels ();
     
   signals:
+    void parsingStarted (int);
     void wordParsed ();
-    void parsingFinished ();
+    void parsingFinished (int);
     
   public slots:
     void setDirty ();
+    void updatePhoneme (QString, QStringList);
+    void updateSupra (QString);
     void parseWordlist ();
+    void cancelParsing ();
     void setLanguageName (QString);
+    void updateSetting (QString, QString);
     
   private slots:
     void setChanged ();
@@ -47,6 +55,8 @@ class WordPage : public QWidget  {
     void addWord ();
     void deleteWord ();
     void search ();
+    void showAllWords (int);
+    void showSearchResults (int, QList<int>, bool);
     void displayWord ();
     void applyNaturalClass ();
     void updateNCModel ();
@@ -60,20 +70,24 @@ class WordPage : public QWidget  {
     void launchEditPhonologyDialog ();
     
     void parseWord ();
+    void finishParsing ();
     
   private:
+    void loadAnalyzer ();
     void parseWord (int);
-    
-    QList<Syllable> convertTree (TreeNode);
+    void parseWords (QMap<int, QString>);
+    int searchMode ();
+    void stopSearching ();
     
     // used for word parsing
     bool dirty;
-    EarleyParser parser;
-    QMap<QString, QStringList> phonemes;
-    QList<Suprasegmental> diacriticSupras;
-    QList<Suprasegmental> beforeSupras;
-    QList<Suprasegmental> afterSupras;
-    QList<Suprasegmental> doubledSupras;
+    PhonologyAnalyzer analyzer;
+    Reanalyzer *reanalyzer;
+    QMap<int, QString> pendingWords;
+    
+    // used for searching
+    WordSearcher *searcher;
+    int searchRequest;
     
     CDICDatabase db;
     
@@ -81,7 +95,7 @@ class WordPage : public QWidget  {
     FeatureBundlesDialog *featureBundlesDialog;
     EditPhonologyDialog *editPhonologyDialog;
     
-    QSqlQueryModel *wordModel;
+    WordListModel *wordModel;
     QSqlTableModel *displayModel;
     QDataWidgetMapper *mapper;
     
@@ -90,6 +104,7 @@ class WordPage : public QWidget  {
     QPushButton *deleteWordButton;
     QPushButton *searchButton;
     QLineEdit *searchEdit;
+    QComboBox *searchModeBox;
     QComboBox *naturalClassBox;
     QComboBox *languageBox;
     QTreeView *wordView;
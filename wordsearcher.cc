@@ -0,0 +1,140 @@
+#include <QMutexLocker>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QMetaType>
+
+#include "wordsearcher.h"
+#include "cdicdatabase.h"
+#include "queryprofiler.h"
+
+// Milliseconds without a newer search before a search starts
+#define SEARCH_DELAY 250
+
+// Word ids sent back to the word page at a time
+#define RESULT_BATCH_SIZE 1000
+
+WordSearcher::WordSearcher (QString f)  {
+  filename = f;
+
+  latest = 0;
+  ran = 0;
+  stopped = false;
+
+  qRegisterMetaType< QList<int> > ("QList<int>");
+}
+
+// Asks for a search, replacing any that has not finished; returns the number
+// its results will come back with
+int WordSearcher::search (QString search, QString className, QString languageName,
+                          QString ignored, int mode)  {
+  QMutexLocker locker (&mutex);
+
+  pending.search = search;
+  pending.className = className;
+  pending.languageName = languageName;
+  pending.ignored = ignored;
+  pending.mode = mode;
+
+  requested.wakeAll ();
+
+  return ++latest;
+}
+
+void WordSearcher::stop ()  {
+  QMutexLocker locker (&mutex);
+
+  stopped = true;
+  requested.wakeAll ();
+}
+
+bool WordSearcher::outdated (int request)  {
+  QMutexLocker locker (&mutex);
+  return (stopped || request != latest);
+}
+
+void WordSearcher::run ()  {
+  QString connection = QString ("search%1").arg ((quintptr)this);
+
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase ("QSQLITE", connection);
+    db.setDatabaseName (filename);
+    db.setConnectOptions ("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=1000");
+
+    if (!db.open ())  {
+      CDICDatabase::reportError (db.lastError ().text ());
+      QMutexLocker locker (&mutex);
+      stopped = true;
+    }
+
+    else  {
+      // searches match names the same way as on the main connection
+      QSqlQuery pragma (db);
+      if (!pragma.exec ("pragma case_sensitive_like = ON"))
+        CDICDatabase::reportError (pragma.lastError ().text ());
+      pragma.finish ();
+    }
+
+    while (true)  {
+      mutex.lock ();
+
+      while (ran == latest && !stopped)
+        requested.wait (&mutex);
+
+      // until the search has stayed the same for a moment
+      while (!stopped && requested.wait (&mutex, SEARCH_DELAY))
+        ;
+
+      if (stopped)  {
+        mutex.unlock ();
+        break;
+      }
+
+      int request = latest;
+      WordSearch current = pending;
+      ran = request;
+
+      mutex.unlock ();
+
+      QSqlQuery query (db);
+      query.setForwardOnly (true);
+
+      if (!CDICDatabase::prepareWordSearch (query, current.search, current.className,
+                                            current.languageName, current.ignored,
+                                            current.mode))  {
+        emit allFound (request);
+        continue;
+      }
+
+      if (!QueryProfiler::exec (query))  {
+        CDICDatabase::reportError (query.executedQuery () + "\n" + query.lastError ().text ());
+        QueryProfiler::finish (query);
+        continue;
+      }
+
+      QList<int> batch;
+      bool first = true;
+
+      while (!outdated (request) && QueryProfiler::next (query))  {
+        batch.append (query.value (0).toInt ());
+
+        if (batch.size () == RESULT_BATCH_SIZE)  {
+          emit found (request, batch, first);
+          batch.clear ();
+          first = false;
+        }
+      }
+
+      // the first batch goes out even when empty, to clear the last results
+      if (!outdated (request) && (first || !batch.isEmpty ()))
+        emit found (request, batch, first);
+
+      QueryProfiler::finish (query);
+    }
+
+    db.close ();
+  }
+
+  QSqlDatabase::removeDatabase (connection);
+}
@@ -0,0 +1,53 @@
+#ifndef WORDSEARCHER_H
+#define WORDSEARCHER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+
+// A search as set up on the word page
+typedef struct WordSearch_s  {
+  QString search;
+  QString className;
+  QString languageName;
+  QString ignored;
+  int mode;
+} WordSearch;
+
+// Runs the word page's searches on a thread of its own, with its own
+// read-only connection to the dictionary.  A search only starts once no newer
+// one has been asked for for a moment, so typing does not set off a search
+// per keystroke, and it stops reading results as soon as a newer one is asked
+// for.  Searches are numbered, and their results come back in batches tagged
+// with the number.
+class WordSearcher : public QThread  {
+  Q_OBJECT
+
+  public:
+    WordSearcher (QString);
+
+    int search (QString, QString, QString, QString, int);
+    void stop ();
+
+  signals:
+    void allFound (int);
+    void found (int, QList<int>, bool);
+
+  protected:
+    void run ();
+
+  private:
+    bool outdated (int);
+
+    QString filename;
+
+    QMutex mutex;
+    QWaitCondition requested;
+    WordSearch pending;
+    int latest;
+    int ran;
+    bool stopped;
+};
+
+#endif
@@ -0,0 +1,540 @@
+#include <QIODevice>
+#include <QSqlError>
+#include <QVariant>
+
+#include "xmlimporter.h"
+#include "cdicdatabase.h"
+#include "queryprofiler.h"
+
+XMLImporter::XMLImporter (QSqlDatabase d)  {
+  db = d;
+  brackets = false;
+  inventoryWritten = false;
+  bundleID = 1;
+}
+
+QString XMLImporter::languageName ()  {
+  return language;
+}
+
+bool XMLImporter::squareBrackets ()  {
+  return brackets;
+}
+
+// XML errors only; database errors are reported as they happen
+QString XMLImporter::errorString ()  {
+  if (!xml.hasError ())
+    return "";
+
+  return QString ("Line %1: %2").arg (xml.lineNumber ()).arg (xml.errorString ());
+}
+
+bool XMLImporter::import (QIODevice *device)  {
+  xml.setDevice (device);
+
+  QStringList tables;
+  tables << "Onset" << "Peak" << "Coda";
+
+  if (!prepare (wordQuery, "insert into Word values (?, ?, ?)") ||
+      !prepare (featureQuery, "insert into WordFeatureSet values (?, ?, ?)") ||
+      !prepare (syllableSupraQuery, "insert into SyllableSupra values (?, ?, ?)"))
+    return false;
+
+  for (int t = 0; t < 3; t++)
+    if (!prepare (segmentQueries[t], "insert into " + tables[t] + " values (?, ?, ?, ?)") ||
+        !prepare (segmentSupraQueries[t], "insert into " + tables[t] + "Supra values (?, ?, ?, ?)"))
+      return false;
+
+  if (!xml.readNextStartElement ())
+    return false;
+
+  language = xml.attributes ().value ("name").toString ();
+
+  while (xml.readNextStartElement ())  {
+    if (xml.name () == "squareBrackets")  {
+      brackets = true;
+      xml.skipCurrentElement ();
+    }
+
+    // the words written so far could not have used anything read now
+    else if (inventoryWritten && (xml.name () == "inventory" ||
+                                  xml.name () == "suprasegmentals"))  {
+      xml.raiseError ("<" + xml.name ().toString () + "> must come before <wordList>.");
+      return false;
+    }
+
+    else if (xml.name () == "inventory")
+      readInventory ();
+
+    else if (xml.name () == "suprasegmentals")
+      readSupras ();
+
+    else if (xml.name () == "wordList")  {
+      if (!writeInventory () || !readWordList ())
+        return false;
+    }
+
+    else xml.skipCurrentElement ();
+  }
+
+  if (xml.hasError ())
+    return false;
+
+  return writeInventory ();
+}
+
+void XMLImporter::readInventory ()  {
+  while (xml.readNextStartElement ())  {
+    if (xml.name () == "alphabet")
+      alphabet = xml.readElementText ().split (" ");
+
+    else if (xml.name () == "phonemeDef")  {
+      XMLPhoneme phoneme;
+      phoneme.name = xml.attributes ().value ("name").toString ();
+
+      while (xml.readNextStartElement ())  {
+        if (xml.name () == "orthography")
+          phoneme.spellings = xml.readElementText ().split (' ');
+        else if (xml.name () == "notes")
+          phoneme.notes = xml.readElementText ();
+        else xml.skipCurrentElement ();
+      }
+
+      phonemes.append (phoneme);
+    }
+
+    else xml.skipCurrentElement ();
+  }
+}
+
+void XMLImporter::readSupras ()  {
+  while (xml.readNextStartElement ())  {
+    if (xml.name () != "supraDef")  {
+      xml.skipCurrentElement ();
+      continue;
+    }
+
+    XMLSupra supra;
+    supra.name = xml.attributes ().value ("name").toString ();
+    supra.domain = xml.attributes ().value ("domain").toString ().toInt ();
+    supra.repType = 0;
+    supra.spellType = 0;
+
+    while (xml.readNextStartElement ())  {
+      if (xml.name () == "applies")
+        supra.applies = xml.readElementText ().split (' ');
+
+      else if (xml.name () == "notes")
+        supra.notes = xml.readElementText ();
+
+      else if (xml.name () == "spelling")  {
+        supra.spellType = xml.attributes ().value ("type").toString ().toInt ();
+        supra.spellText = xml.readElementText ();
+      }
+
+      else if (xml.name () == "representation")  {
+        supra.repType = xml.attributes ().value ("type").toString ().toInt ();
+        supra.repText = xml.readElementText ();
+      }
+
+      else xml.skipCurrentElement ();
+    }
+
+    convertType (supra.spellType, supra.spellText);
+    convertType (supra.repType, supra.repText);
+
+    supras.append (supra);
+  }
+}
+
+// ConlangML numbers supra types differently and names the diacritics
+void XMLImporter::convertType (int &type, QString &text)  {
+  switch (type)  {
+    case 0:
+      if (text == "Acute Accent")
+        type = TYPE_ACUTE;
+      else if (text == "Grave Accent")
+        type = TYPE_GRAVE;
+      else if (text == "Circumflex")
+        type = TYPE_CIRCUMFLEX;
+      else if (text == "Diaresis/Umlaut")
+        type = TYPE_DIARESIS;
+      else if (text == "Macron")
+        type = TYPE_MACRON;
+      text = "";
+      break;
+    case 1:
+      type = TYPE_BEFORE;
+      break;
+    case 2:
+      type = TYPE_AFTER;
+      break;
+    case 3:
+      type = TYPE_DOUBLED;
+      text = "";
+      break;
+    default:
+      type = 0;
+      text = "";
+  }
+}
+
+// Words refer to phonemes and supras, so these go in before the first word
+bool XMLImporter::writeInventory ()  {
+  if (inventoryWritten) return true;
+  inventoryWritten = true;
+
+  QSqlQuery query (db);
+
+  if (!prepare (query, "insert into Phoneme values (?, ?, ?, ?)"))
+    return false;
+
+  for (int x = 0; x < phonemes.size (); x++)  {
+    query.bindValue (0, x);
+    query.bindValue (1, alphabet.indexOf (phonemes[x].name));
+    query.bindValue (2, phonemes[x].name);
+    query.bindValue (3, phonemes[x].notes);
+
+    if (!exec (query))
+      return false;
+
+    phonemeIDs[phonemes[x].name] = x;
+  }
+
+  if (!prepare (query, "insert into PhonemeSpelling values (?, ?)"))
+    return false;
+
+  for (int x = 0; x < phonemes.size (); x++)
+    for (int s = 0; s < phonemes[x].spellings.size (); s++)  {
+      query.bindValue (0, x);
+      query.bindValue (1, phonemes[x].spellings[s]);
+
+      if (!exec (query))
+        return false;
+    }
+
+  if (!prepare (query, "insert into Suprasegmental values (?, ?, ?, ?, ?, ?, ?, ?)"))
+    return false;
+
+  for (int x = 0; x < supras.size (); x++)  {
+    query.bindValue (0, x);
+    query.bindValue (1, supras[x].name);
+    query.bindValue (2, supras[x].domain);
+    query.bindValue (3, supras[x].repType);
+    query.bindValue (4, supras[x].repText);
+    query.bindValue (5, supras[x].spellType);
+    query.bindValue (6, supras[x].spellText);
+    query.bindValue (7, supras[x].notes);
+
+    if (!exec (query))
+      return false;
+
+    supraIDs[supras[x].name] = x;
+  }
+
+  if (!prepare (query, "insert into SupraApplies values (?, ?)"))
+    return false;
+
+  for (int x = 0; x < supras.size (); x++)
+    for (int a = 0; a < supras[x].applies.size (); a++)  {
+      if (!phonemeIDs.contains (supras[x].applies[a])) continue;
+
+      query.bindValue (0, x);
+      query.bindValue (1, phonemeIDs[supras[x].applies[a]]);
+
+      if (!exec (query))
+        return false;
+    }
+
+  query.finish ();
+
+  phonemes.clear ();
+  supras.clear ();
+
+  return true;
+}
+
+bool XMLImporter::readWordList ()  {
+  QSqlQuery query (db);
+
+  if (!prepare (query, "insert into WordFeatureDef values (?, null, null, ?)"))
+    return false;
+
+  query.bindValue (0, "Type");
+  query.bindValue (1, displayType[DISPLAY_COLON]);
+
+  if (!exec (query))
+    return false;
+
+  query.finish ();
+
+  int wordID = 1;
+
+  while (xml.readNextStartElement ())  {
+    if (xml.name () != "wordDef")  {
+      xml.skipCurrentElement ();
+      continue;
+    }
+
+    if (!readWord (wordID))
+      return false;
+
+    wordID++;
+  }
+
+  return !xml.hasError ();
+}
+
+bool XMLImporter::readWord (int wordID)  {
+  QXmlStreamAttributes attributes = xml.attributes ();
+  QString name = attributes.value ("name").toString ();
+  QString type = attributes.value ("type").toString ();
+  QString subtype = attributes.value ("subtype").toString ();
+  QString definition = "";
+  QList<Syllable> phonology;
+
+  while (xml.readNextStartElement ())  {
+    if (xml.name () == "definition")
+      definition = xml.readElementText ();
+
+    else if (xml.name () == "phonology")  {
+      while (xml.readNextStartElement ())  {
+        if (xml.name () != "syllable")  {
+          xml.skipCurrentElement ();
+          continue;
+        }
+
+        Syllable syllable;
+        QStringList supraAttributes;
+        supraAttributes << "bSupra" << "fSupra" << "pSupra";
+
+        for (int s = 0; s < supraAttributes.size (); s++)  {
+          QString supra = xml.attributes ().value (supraAttributes[s]).toString ();
+
+          if (supra != "" && !syllable.supras.contains (supra))
+            syllable.supras.append (supra);
+        }
+
+        while (xml.readNextStartElement ())  {
+          if (xml.name () == "onset")
+            syllable.onset += readSequence ();
+          else if (xml.name () == "peak")
+            syllable.peak += readSequence ();
+          else if (xml.name () == "coda")
+            syllable.coda += readSequence ();
+          else xml.skipCurrentElement ();
+        }
+
+        phonology.append (syllable);
+      }
+    }
+
+    else xml.skipCurrentElement ();
+  }
+
+  if (xml.hasError ())
+    return false;
+
+  return writeWord (wordID, name, definition, type, subtype, phonology);
+}
+
+QList<Phoneme> XMLImporter::readSequence ()  {
+  QList<Phoneme> sequence;
+
+  while (xml.readNextStartElement ())  {
+    if (xml.name () != "phoneme")  {
+      xml.skipCurrentElement ();
+      continue;
+    }
+
+    Phoneme phoneme;
+    phoneme.name = xml.attributes ().value ("name").toString ();
+
+    while (xml.readNextStartElement ())  {
+      if (xml.name () == "supra")
+        phoneme.supras.append (xml.readElementText ());
+      else xml.skipCurrentElement ();
+    }
+
+    sequence.append (phoneme);
+  }
+
+  return sequence;
+}
+
+bool XMLImporter::writeWord (int wordID, QString name, QString definition,
+                             QString type, QString subtype,
+                             QList<Syllable> &phonology)  {
+  wordQuery.bindValue (0, wordID);
+  wordQuery.bindValue (1, name);
+  wordQuery.bindValue (2, definition);
+
+  if (!exec (wordQuery))
+    return false;
+
+  if (type != "")  {
+    if (!writeWordType (type, subtype))
+      return false;
+
+    featureQuery.bindValue (0, wordID);
+    featureQuery.bindValue (1, "Type");
+    featureQuery.bindValue (2, type);
+
+    if (!exec (featureQuery))
+      return false;
+
+    if (subtype != "")  {
+      featureQuery.bindValue (0, wordID);
+      featureQuery.bindValue (1, type);
+      featureQuery.bindValue (2, subtype);
+
+      if (!exec (featureQuery))
+        return false;
+    }
+  }
+
+  for (int syllNum = 0; syllNum < phonology.size (); syllNum++)  {
+    const QStringList &syllSupras = phonology[syllNum].supras;
+
+    for (int s = 0; s < syllSupras.size (); s++)  {
+      if (!supraIDs.contains (syllSupras[s]))  {
+        CDICDatabase::reportError ("Could not find suprasegmental: " + syllSupras[s]);
+        continue;
+      }
+
+      syllableSupraQuery.bindValue (0, wordID);
+      syllableSupraQuery.bindValue (1, syllNum);
+      syllableSupraQuery.bindValue (2, supraIDs[syllSupras[s]]);
+
+      if (!exec (syllableSupraQuery))
+        return false;
+    }
+
+    if (!writeSequence (ONSET, wordID, syllNum, phonology[syllNum].onset) ||
+        !writeSequence (PEAK, wordID, syllNum, phonology[syllNum].peak) ||
+        !writeSequence (CODA, wordID, syllNum, phonology[syllNum].coda))
+      return false;
+  }
+
+  return true;
+}
+
+// Word types become features the first time they are seen, so that the
+// word's feature set has something to refer to
+bool XMLImporter::writeWordType (QString type, QString subtype)  {
+  QSqlQuery query (db);
+
+  if (!wordTypes.contains (type))  {
+    wordTypes.insert (type);
+
+    query.prepare ("insert into WordSubfeature values (?, ?)");
+    query.bindValue (0, "Type");
+    query.bindValue (1, type);
+
+    if (!exec (query))
+      return false;
+
+    query.prepare ("insert into NaturalClassWord values (?, ?)");
+    query.bindValue (0, bundleID);
+    query.bindValue (1, type);
+
+    if (!exec (query))
+      return false;
+
+    query.prepare ("insert into FeatureBundleWord values (?, ?, ?)");
+    query.bindValue (0, bundleID);
+    query.bindValue (1, "Type");
+    query.bindValue (2, type);
+
+    if (!exec (query))
+      return false;
+
+    bundleID++;
+  }
+
+  if (subtype == "" || wordSubtypes.contains (type + "/" + subtype))
+    return true;
+
+  wordSubtypes.insert (type + "/" + subtype);
+
+  if (!typesWithSubtypes.contains (type))  {
+    typesWithSubtypes.insert (type);
+
+    query.prepare ("insert into WordFeatureDef values (?, ?, ?, ?)");
+    query.bindValue (0, type);
+    query.bindValue (1, "Type");
+    query.bindValue (2, type);
+    query.bindValue (3, displayType[DISPLAY_COLON]);
+
+    if (!exec (query))
+      return false;
+  }
+
+  query.prepare ("insert into WordSubfeature values (?, ?)");
+  query.bindValue (0, type);
+  query.bindValue (1, subtype);
+
+  return exec (query);
+}
+
+// Unknown phonemes and supras are reported and left out
+bool XMLImporter::writeSequence (int loc, int wordID, int syllNum,
+                                 QList<Phoneme> &sequence)  {
+  int t = (loc == ONSET ? 0 : (loc == PEAK ? 1 : 2));
+  int ind = 0;
+
+  for (int p = 0; p < sequence.size (); p++)  {
+    if (!phonemeIDs.contains (sequence[p].name))  {
+      CDICDatabase::reportError ("Could not find phoneme: " + sequence[p].name);
+      continue;
+    }
+
+    segmentQueries[t].bindValue (0, wordID);
+    segmentQueries[t].bindValue (1, syllNum);
+    segmentQueries[t].bindValue (2, ind);
+    segmentQueries[t].bindValue (3, phonemeIDs[sequence[p].name]);
+
+    if (!exec (segmentQueries[t]))
+      return false;
+
+    for (int s = 0; s < sequence[p].supras.size (); s++)  {
+      if (!supraIDs.contains (sequence[p].supras[s]))  {
+        CDICDatabase::reportError ("Could not find suprasegmental: " + sequence[p].supras[s]);
+        continue;
+      }
+
+      segmentSupraQueries[t].bindValue (0, wordID);
+      segmentSupraQueries[t].bindValue (1, syllNum);
+      segmentSupraQueries[t].bindValue (2, ind);
+      segmentSupraQueries[t].bindValue (3, supraIDs[sequence[p].supras[s]]);
+
+      if (!exec (segmentSupraQueries[t]))
+        return false;
+    }
+
+    ind++;
+  }
+
+  return true;
+}
+
+bool XMLImporter::prepare (QSqlQuery &query, QString statement)  {
+  query = QSqlQuery (db);
+
+  if (!query.prepare (statement))  {
+    CDICDatabase::reportError (statement + "\n" + query.lastError ().text ());
+    return false;
+  }
+
+  return true;
+}
+
+bool XMLImporter::exec (QSqlQuery &query)  {
+  if (!QueryProfiler::exec (query))  {
+    CDICDatabase::reportError (query.executedQuery () + "\n" + query.lastError ().text ());
+    query.finish ();
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,87 @@
+#ifndef XMLIMPORTER_H
+#define XMLIMPORTER_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QXmlStreamReader>
+#include <QHash>
+#include <QSet>
+#include <QList>
+
+#include "const.h"
+
+class QIODevice;
+
+typedef struct XMLPhoneme_s  {
+  QString name;
+  QStringList spellings;
+  QString notes;
+} XMLPhoneme;
+
+typedef struct XMLSupra_s  {
+  QString name;
+  int domain;
+  QStringList applies;
+  QString notes;
+  int repType;
+  QString repText;
+  int spellType;
+  QString spellText;
+} XMLSupra;
+
+// Reads a ConlangML file into an empty dictionary as it goes.  The inventory
+// and suprasegmentals are small and are written once both have been read,
+// so they must come before the word list; each wordDef is written as soon
+// as it ends, with statements prepared once for the whole file.  The caller
+// owns the transaction.
+class XMLImporter  {
+  public:
+    XMLImporter (QSqlDatabase);
+
+    bool import (QIODevice*);
+
+    QString languageName ();
+    bool squareBrackets ();
+    QString errorString ();
+
+  private:
+    void readInventory ();
+    void readSupras ();
+    bool writeInventory ();
+    bool readWordList ();
+    bool readWord (int);
+    QList<Phoneme> readSequence ();
+    bool writeWord (int, QString, QString, QString, QString, QList<Syllable>&);
+    bool writeWordType (QString, QString);
+    bool writeSequence (int, int, int, QList<Phoneme>&);
+
+    bool prepare (QSqlQuery&, QString);
+    bool exec (QSqlQuery&);
+    static void convertType (int&, QString&);
+
+    QXmlStreamReader xml;
+    QSqlDatabase db;
+
+    QString language;
+    bool brackets;
+    bool inventoryWritten;
+
+    QStringList alphabet;
+    QList<XMLPhoneme> phonemes;
+    QList<XMLSupra> supras;
+
+    QHash<QString, int> phonemeIDs;
+    QHash<QString, int> supraIDs;
+    QSet<QString> wordTypes;
+    QSet<QString> wordSubtypes;
+    QSet<QString> typesWithSubtypes;
+    int bundleID;
+
+    QSqlQuery wordQuery;
+    QSqlQuery featureQuery;
+    QSqlQuery syllableSupraQuery;
+    QSqlQuery segmentQueries[3];
+    QSqlQuery segmentSupraQueries[3];
+};
+
+#endif